@@ -0,0 +1,178 @@
+#ifndef ABSORBING_BOUNDARY_HH
+#define ABSORBING_BOUNDARY_HH
+
+#include "mesh.hh"
+#include "aka_common.hh"
+
+#include <array>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <stdexcept>
+
+namespace absorb
+{
+    // P and S wave speeds of an isotropic elastic solid (units of E / rho)
+    struct WaveSpeeds
+    {
+        akantu::Real cp{0.}, cs{0.};
+
+        static WaveSpeeds of(akantu::Real rho, akantu::Real E, akantu::Real nu)
+        {
+            return {std::sqrt(E * (1. - nu) / (rho * (1. + nu) * (1. - 2. * nu))), std::sqrt(E / (2. * rho * (1. + nu)))};
+        }
+    };
+
+    // Volume a `<block>-<face>` physical surface of Gmsh/Functions.py belongs to
+    inline std::string volume_of(const std::string &surface)
+    {
+        const auto dash = surface.rfind('-');
+        return dash == std::string::npos ? surface : surface.substr(0, dash);
+    }
+
+    // Lysmer-Kuhlemeyer viscous boundary on physical surfaces of the mesh:
+    // every face node gets dashpots
+    //   f = -A rho (cp (v.n) n + cs (v - (v.n) n))
+    // with A its lumped share of the face area and n the face normal, which
+    // absorbs normally incident P and S waves (and most of the energy of
+    // oblique ones). Faces are kept separately, so edge and corner nodes get
+    // one dashpot set per face. The forces are explicit, from the velocity of
+    // the last step; rho and the wave speeds must be in the mesh's unit
+    // system (mm-MPa-t gives N).
+    class LysmerBoundary
+    {
+    public:
+        explicit LysmerBoundary(const akantu::Mesh &mesh) : mesh(mesh), dim(mesh.getSpatialDimension()) {}
+
+        // Dashpots on one physical surface with the given material
+        void add(const std::string &surface, akantu::Real rho, const WaveSpeeds &speeds)
+        {
+            if (!mesh.elementGroupExists(surface))
+                throw std::runtime_error("absorbing boundary: no physical group '" + surface + "'");
+            const auto &nodes = mesh.getNodes();
+            const auto &group = mesh.getElementGroup(surface);
+            for (auto type : group.elementTypes(dim - 1))
+            {
+                const auto &connectivity = mesh.getConnectivity(type, akantu::_not_ghost);
+                const akantu::Int corners = corner_count(type);
+                if (corners == 0)
+                    throw std::runtime_error("absorbing boundary: unsupported face type in '" + surface + "'");
+                for (auto e : group.getElements(type, akantu::_not_ghost))
+                {
+                    std::array<std::array<akantu::Real, 3>, 4> x{};
+                    for (akantu::Int k = 0; k < corners; ++k)
+                        for (akantu::Int d = 0; d < dim; ++d)
+                            x[k][d] = nodes(connectivity(e, k), d);
+                    const auto a = area_vector(x, corners);
+                    const akantu::Real area = std::sqrt(a[0] * a[0] + a[1] * a[1] + a[2] * a[2]);
+                    if (area == 0.)
+                        continue;
+                    const akantu::Real share = area / corners;
+                    for (akantu::Int k = 0; k < corners; ++k)
+                        dashpots.push_back({connectivity(e, k), share * rho * speeds.cp, share * rho * speeds.cs,
+                                            {a[0] / area, a[1] / area, a[2] / area}});
+                    total_area += area;
+                }
+            }
+            last.resize(dashpots.size(), {0., 0., 0.});
+        }
+
+        // Same, with rho, E and nu of the surface's volume material
+        template <class Model>
+        void add(const Model &model, const std::string &surface)
+        {
+            const auto &material = model.getMaterial(volume_of(surface));
+            const akantu::Real rho = material.get("rho");
+            const akantu::Real E = material.get("E");
+            const akantu::Real nu = material.get("nu");
+            add(surface, rho, WaveSpeeds::of(rho, E, nu));
+        }
+
+        // Adds the dashpot forces to an external force that is rebuilt every step
+        void apply(const akantu::Array<akantu::Real> &velocity, akantu::Array<akantu::Real> &f_ext)
+        {
+            for (std::size_t k = 0; k < dashpots.size(); ++k)
+            {
+                last[k] = force(dashpots[k], velocity);
+                for (akantu::Int i = 0; i < dim; ++i)
+                    f_ext(dashpots[k].node, i) += last[k][i];
+            }
+        }
+
+        // For an external force that persists between steps (e.g. tractions
+        // applied once): replaces the previous step's dashpot forces
+        void update(const akantu::Array<akantu::Real> &velocity, akantu::Array<akantu::Real> &f_ext)
+        {
+            for (std::size_t k = 0; k < dashpots.size(); ++k)
+            {
+                const auto f = force(dashpots[k], velocity);
+                for (akantu::Int i = 0; i < dim; ++i)
+                    f_ext(dashpots[k].node, i) += f[i] - last[k][i];
+                last[k] = f;
+            }
+        }
+
+        std::size_t size() const { return dashpots.size(); }
+        akantu::Real area() const { return total_area; }
+
+    private:
+        struct Dashpot
+        {
+            akantu::Idx node;
+            akantu::Real cp, cs; // A rho c of the two dashpots
+            std::array<akantu::Real, 3> normal;
+        };
+
+        std::array<akantu::Real, 3> force(const Dashpot &d, const akantu::Array<akantu::Real> &velocity) const
+        {
+            akantu::Real vn = 0.;
+            for (akantu::Int i = 0; i < dim; ++i)
+                vn += velocity(d.node, i) * d.normal[i];
+            std::array<akantu::Real, 3> f{0., 0., 0.};
+            for (akantu::Int i = 0; i < dim; ++i)
+            {
+                const akantu::Real normal = vn * d.normal[i];
+                f[i] = -(d.cp * normal + d.cs * (velocity(d.node, i) - normal));
+            }
+            return f;
+        }
+
+        static akantu::Int corner_count(akantu::ElementType type)
+        {
+            switch (type)
+            {
+            case akantu::_segment_2:
+            case akantu::_segment_3: return 2;
+            case akantu::_triangle_3:
+            case akantu::_triangle_6: return 3;
+            case akantu::_quadrangle_4: return 4;
+            default: return 0;
+            }
+        }
+
+        // Area-weighted normal (length = area; 2-D: segment length, normal in-plane)
+        static std::array<akantu::Real, 3> area_vector(const std::array<std::array<akantu::Real, 3>, 4> &x, akantu::Int corners)
+        {
+            auto sub = [](const std::array<akantu::Real, 3> &a, const std::array<akantu::Real, 3> &b)
+            { return std::array<akantu::Real, 3>{a[0] - b[0], a[1] - b[1], a[2] - b[2]}; };
+            auto cross = [](const std::array<akantu::Real, 3> &a, const std::array<akantu::Real, 3> &b)
+            { return std::array<akantu::Real, 3>{a[1] * b[2] - a[2] * b[1], a[2] * b[0] - a[0] * b[2], a[0] * b[1] - a[1] * b[0]}; };
+            if (corners == 2)
+            {
+                const auto t = sub(x[1], x[0]);
+                return {t[1], -t[0], 0.};
+            }
+            // Triangle: half the edge cross product; quadrangle: half the diagonal cross product
+            const auto c = corners == 3 ? cross(sub(x[1], x[0]), sub(x[2], x[0])) : cross(sub(x[2], x[0]), sub(x[3], x[1]));
+            return {0.5 * c[0], 0.5 * c[1], 0.5 * c[2]};
+        }
+
+        const akantu::Mesh &mesh;
+        akantu::Int dim;
+        std::vector<Dashpot> dashpots;
+        std::vector<std::array<akantu::Real, 3>> last;
+        akantu::Real total_area{0.};
+    };
+} // namespace absorb
+
+#endif
@@ -0,0 +1,437 @@
+#ifndef ASYNC_DUMPER_HH
+#define ASYNC_DUMPER_HH
+
+#include "mesh.hh"
+#include "aka_common.hh"
+
+#include <map>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <exception>
+#include <stdexcept>
+#include <functional>
+#include <filesystem>
+#include <condition_variable>
+
+namespace dump
+{
+    // VTK cell type of an Akantu element type whose node ordering VTK shares;
+    // -1 otherwise. Wedges (winding) and tet10 (edge nodes 8 and 9) are
+    // numbered differently, so they are rejected rather than written distorted.
+    inline int vtk_cell_type(akantu::ElementType type)
+    {
+        switch (type)
+        {
+        case akantu::_segment_2: return 3;
+        case akantu::_triangle_3: return 5;
+        case akantu::_quadrangle_4: return 9;
+        case akantu::_tetrahedron_4: return 10;
+        case akantu::_hexahedron_8: return 12;
+        case akantu::_segment_3: return 21;
+        case akantu::_triangle_6: return 22;
+        default: return -1;
+        }
+    }
+
+    // One time step of every registered field, copied out of the model
+    struct Snapshot
+    {
+        akantu::Int step{0};
+        akantu::Real time{0.};
+        std::vector<std::vector<akantu::Real>> fields;
+    };
+
+    // ParaView output (one .vtu per dump plus a .pvd time collection) written
+    // by a background thread. dump() only copies the registered fields into a
+    // free staging snapshot and queues it; with `depth` snapshots the solver
+    // runs ahead of the writer by up to depth - 1 dumps and blocks only when
+    // all of them are still waiting to be written. The mesh part of each file
+    // (points, connectivity) is encoded once at construction.
+    class AsyncDumper
+    {
+    public:
+        AsyncDumper(const akantu::Mesh &mesh, std::string directory, std::string base_name, std::size_t depth = 2)
+            : directory(std::move(directory)), base_name(std::move(base_name)), depth(std::max<std::size_t>(depth, 1))
+        {
+            std::filesystem::create_directories(this->directory);
+            encode_geometry(mesh);
+        }
+
+        ~AsyncDumper()
+        {
+            try
+            {
+                close();
+            }
+            catch (const std::exception &e)
+            {
+                std::cerr << "[!] AsyncDumper: " << e.what() << "\n";
+            }
+        }
+
+        AsyncDumper(const AsyncDumper &) = delete;
+        AsyncDumper &operator=(const AsyncDumper &) = delete;
+
+        // Nodal field read from `values` (nb_nodes x components) at every dump
+        void add_nodal(const std::string &name, const akantu::Array<akantu::Real> &values)
+        {
+            const akantu::Array<akantu::Real> *source = &values;
+            add_field({name, static_cast<int>(values.getNbComponent()), static_cast<std::size_t>(nb_points), true,
+                       [source](akantu::Real *out)
+                       { std::memcpy(out, source->data(), source->size() * source->getNbComponent() * sizeof(akantu::Real)); }});
+        }
+
+        // Per-element field; fill(out) writes one row per cell, the elements of
+        // each type starting at row cell_offset(type)
+        void add_elemental(const std::string &name, int components, std::function<void(akantu::Real *)> fill)
+        {
+            add_field({name, components, static_cast<std::size_t>(nb_cells), false, std::move(fill)});
+        }
+
+        // Quadrature-point stress of every material averaged per element
+        // (9 components); works for any model with getMaterial/getNbMaterials.
+        template <class Model>
+        void add_stress(const Model &model)
+        {
+            const akantu::Int dim = spatial_dimension;
+            add_elemental("stress", dim * dim, [this, &model, dim](akantu::Real *out)
+                          {
+                              for (akantu::Idx m = 0; m < static_cast<akantu::Idx>(model.getNbMaterials()); ++m)
+                              {
+                                  const auto &material = model.getMaterial(m);
+                                  for (const auto &entry : offsets)
+                                  {
+                                      const auto &filter = material.getElementFilter(entry.first, akantu::_not_ghost);
+                                      if (filter.size() == 0)
+                                          continue;
+                                      const auto &stress = material.getStress(entry.first, akantu::_not_ghost);
+                                      const akantu::Int nb_quad = stress.size() / filter.size();
+                                      if (nb_quad == 0 || stress.getNbComponent() != dim * dim)
+                                          continue;
+                                      for (akantu::Idx e = 0; e < filter.size(); ++e)
+                                      {
+                                          akantu::Real *cell = out + (entry.second + filter(e)) * dim * dim;
+                                          for (akantu::Int c = 0; c < dim * dim; ++c)
+                                          {
+                                              akantu::Real sum = 0.;
+                                              for (akantu::Int q = 0; q < nb_quad; ++q)
+                                                  sum += stress(e * nb_quad + q, c);
+                                              cell[c] = sum / nb_quad;
+                                          }
+                                      }
+                                  }
+                              } });
+        }
+
+        // First cell of `type` in the elemental fields
+        akantu::Idx cell_offset(akantu::ElementType type) const { return offsets.at(type); }
+
+        // Copies every field now and queues the snapshot for writing
+        void dump(akantu::Int step, akantu::Real time)
+        {
+            rethrow();
+            if (!writer.joinable())
+                start();
+
+            std::unique_ptr<Snapshot> snapshot;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                if (free.empty())
+                {
+                    const auto t0 = std::chrono::steady_clock::now();
+                    ++stalls;
+                    changed.wait(lock, [&] { return !free.empty() || error; });
+                    stall_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+                    if (error)
+                    {
+                        lock.unlock();
+                        rethrow();
+                    }
+                }
+                snapshot = std::move(free.back());
+                free.pop_back();
+            }
+
+            snapshot->step = step;
+            snapshot->time = time;
+            for (std::size_t f = 0; f < fields.size(); ++f)
+                fields[f].fill(snapshot->fields[f].data());
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                ready.push_back(std::move(snapshot));
+            }
+            changed.notify_all();
+        }
+
+        // Waits for every queued snapshot to be on disk and stops the writer
+        void close()
+        {
+            if (writer.joinable())
+            {
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    stopping = true;
+                }
+                changed.notify_all();
+                writer.join();
+            }
+            rethrow();
+        }
+
+        std::uint64_t bytes_written() const { return bytes; }
+        std::size_t nb_stalls() const { return stalls; }
+        double stalled_seconds() const { return stall_seconds; }
+
+    private:
+        struct Field
+        {
+            std::string name;
+            int components;
+            std::size_t rows;
+            bool nodal;
+            std::function<void(akantu::Real *)> fill;
+        };
+
+        void add_field(Field field)
+        {
+            if (writer.joinable())
+                throw std::logic_error("AsyncDumper: fields must be added before the first dump");
+            fields.push_back(std::move(field));
+        }
+
+        void start()
+        {
+            if (stopping)
+                throw std::logic_error("AsyncDumper: dump after close");
+            for (std::size_t k = 0; k < depth; ++k)
+            {
+                auto snapshot = std::make_unique<Snapshot>();
+                for (const auto &f : fields)
+                    snapshot->fields.emplace_back(f.rows * f.components, 0.);
+                free.push_back(std::move(snapshot));
+            }
+            writer = std::thread([this] { run(); });
+        }
+
+        void rethrow()
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (error)
+            {
+                std::exception_ptr e = error;
+                error = nullptr;
+                std::rethrow_exception(e);
+            }
+        }
+
+        void run()
+        {
+            for (;;)
+            {
+                std::unique_ptr<Snapshot> snapshot;
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    changed.wait(lock, [&] { return stopping || !ready.empty(); });
+                    if (ready.empty())
+                        return;
+                    snapshot = std::move(ready.front());
+                    ready.pop_front();
+                }
+                try
+                {
+                    write(*snapshot);
+                }
+                catch (...)
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    if (!error)
+                        error = std::current_exception();
+                }
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    free.push_back(std::move(snapshot));
+                }
+                changed.notify_all();
+            }
+        }
+
+        // Appended raw binary blocks, each prefixed by its UInt64 byte count
+        template <class T>
+        static void append_block(std::string &blob, const T *data, std::size_t count)
+        {
+            const std::uint64_t size = count * sizeof(T);
+            blob.append(reinterpret_cast<const char *>(&size), sizeof(size));
+            blob.append(reinterpret_cast<const char *>(data), size);
+        }
+
+        void encode_geometry(const akantu::Mesh &mesh)
+        {
+            spatial_dimension = mesh.getSpatialDimension();
+            const auto &nodes = mesh.getNodes();
+            nb_points = nodes.size();
+            std::vector<double> points(3 * nb_points, 0.);
+            for (akantu::Idx n = 0; n < nb_points; ++n)
+                for (akantu::Int d = 0; d < spatial_dimension; ++d)
+                    points[3 * n + d] = nodes(n, d);
+
+            std::vector<std::int64_t> connectivity, cell_ends;
+            std::vector<std::uint8_t> types;
+            for (auto type : mesh.elementTypes(spatial_dimension, akantu::_not_ghost, akantu::_ek_regular))
+            {
+                const int vtk = vtk_cell_type(type);
+                if (vtk < 0)
+                {
+                    std::ostringstream name;
+                    name << type;
+                    throw std::runtime_error("AsyncDumper: no VTK cell for element type " + name.str());
+                }
+                const auto &conn = mesh.getConnectivity(type, akantu::_not_ghost);
+                offsets[type] = nb_cells;
+                for (akantu::Idx e = 0; e < conn.size(); ++e)
+                {
+                    for (akantu::Int k = 0; k < conn.getNbComponent(); ++k)
+                        connectivity.push_back(conn(e, k));
+                    cell_ends.push_back(static_cast<std::int64_t>(connectivity.size()));
+                    types.push_back(static_cast<std::uint8_t>(vtk));
+                }
+                nb_cells += conn.size();
+            }
+
+            append_block(geometry, points.data(), points.size());
+            geometry_offsets[0] = 0;
+            geometry_offsets[1] = geometry.size();
+            append_block(geometry, connectivity.data(), connectivity.size());
+            geometry_offsets[2] = geometry.size();
+            append_block(geometry, cell_ends.data(), cell_ends.size());
+            geometry_offsets[3] = geometry.size();
+            append_block(geometry, types.data(), types.size());
+        }
+
+        void write(const Snapshot &snapshot)
+        {
+            char index[32];
+            std::snprintf(index, sizeof(index), "%06lld", static_cast<long long>(snapshot.step));
+            const std::string file = base_name + "_" + index + ".vtu";
+
+            std::ostringstream xml;
+            std::size_t offset = geometry.size();
+            auto array = [&](const Field &f)
+            {
+                xml << "        <DataArray type=\"Float64\" Name=\"" << f.name << "\" NumberOfComponents=\""
+                    << f.components << "\" format=\"appended\" offset=\"" << offset << "\"/>\n";
+                offset += sizeof(std::uint64_t) + f.rows * f.components * sizeof(double);
+            };
+
+            xml << "<?xml version=\"1.0\"?>\n"
+                << "<VTKFile type=\"UnstructuredGrid\" version=\"1.0\" byte_order=\"LittleEndian\" header_type=\"UInt64\">\n"
+                << "  <UnstructuredGrid>\n"
+                << "    <Piece NumberOfPoints=\"" << nb_points << "\" NumberOfCells=\"" << nb_cells << "\">\n"
+                << "      <Points>\n"
+                << "        <DataArray type=\"Float64\" NumberOfComponents=\"3\" format=\"appended\" offset=\"0\"/>\n"
+                << "      </Points>\n"
+                << "      <Cells>\n"
+                << "        <DataArray type=\"Int64\" Name=\"connectivity\" format=\"appended\" offset=\"" << geometry_offsets[1] << "\"/>\n"
+                << "        <DataArray type=\"Int64\" Name=\"offsets\" format=\"appended\" offset=\"" << geometry_offsets[2] << "\"/>\n"
+                << "        <DataArray type=\"UInt8\" Name=\"types\" format=\"appended\" offset=\"" << geometry_offsets[3] << "\"/>\n"
+                << "      </Cells>\n"
+                << "      <PointData>\n";
+            for (const auto &f : fields)
+                if (f.nodal)
+                    array(f);
+            xml << "      </PointData>\n"
+                << "      <CellData>\n";
+            for (const auto &f : fields)
+                if (!f.nodal)
+                    array(f);
+            xml << "      </CellData>\n"
+                << "    </Piece>\n"
+                << "  </UnstructuredGrid>\n"
+                << "  <AppendedData encoding=\"raw\">\n_";
+
+            const std::string path = directory + "/" + file;
+            std::ofstream out(path, std::ios::binary);
+            if (!out)
+                throw std::runtime_error("AsyncDumper: cannot open " + path);
+            const std::string header = xml.str();
+            out.write(header.data(), header.size());
+            out.write(geometry.data(), geometry.size());
+            std::uint64_t written = header.size() + geometry.size();
+            for (const auto &order : {true, false})
+                for (std::size_t f = 0; f < fields.size(); ++f)
+                {
+                    if (fields[f].nodal != order)
+                        continue;
+                    const auto &values = snapshot.fields[f];
+                    const std::uint64_t size = values.size() * sizeof(double);
+                    out.write(reinterpret_cast<const char *>(&size), sizeof(size));
+                    out.write(reinterpret_cast<const char *>(values.data()), size);
+                    written += sizeof(size) + size;
+                }
+            static const char tail[] = "\n  </AppendedData>\n</VTKFile>\n";
+            out.write(tail, sizeof(tail) - 1);
+            if (!out)
+                throw std::runtime_error("AsyncDumper: write failed for " + path);
+            bytes += written + sizeof(tail) - 1;
+
+            collection.emplace_back(snapshot.time, file);
+            write_collection();
+        }
+
+        // Rewritten after every file so an interrupted run still opens in ParaView
+        void write_collection()
+        {
+            const std::string path = directory + "/" + base_name + ".pvd";
+            std::ofstream out(path + ".tmp");
+            out << "<?xml version=\"1.0\"?>\n"
+                << "<VTKFile type=\"Collection\" version=\"0.1\" byte_order=\"LittleEndian\">\n"
+                << "  <Collection>\n";
+            out.precision(17);
+            for (const auto &entry : collection)
+                out << "    <DataSet timestep=\"" << entry.first << "\" group=\"\" part=\"0\" file=\"" << entry.second << "\"/>\n";
+            out << "  </Collection>\n"
+                << "</VTKFile>\n";
+            out.close();
+            if (!out)
+                throw std::runtime_error("AsyncDumper: cannot write " + path);
+            std::filesystem::rename(path + ".tmp", path);
+        }
+
+        std::string directory, base_name;
+        std::size_t depth;
+        akantu::Int spatial_dimension{0};
+        akantu::Int nb_points{0}, nb_cells{0};
+        std::map<akantu::ElementType, akantu::Idx> offsets;
+        std::string geometry;
+        std::size_t geometry_offsets[4]{};
+        std::vector<Field> fields;
+        std::vector<std::pair<akantu::Real, std::string>> collection;
+
+        std::mutex mutex;
+        std::condition_variable changed;
+        std::vector<std::unique_ptr<Snapshot>> free;
+        std::deque<std::unique_ptr<Snapshot>> ready;
+        bool stopping{false};
+        std::exception_ptr error;
+        std::thread writer;
+
+        std::atomic<std::uint64_t> bytes{0};
+        std::size_t stalls{0};
+        double stall_seconds{0.};
+    };
+} // namespace dump
+
+#endif
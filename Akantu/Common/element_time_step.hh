@@ -0,0 +1,265 @@
+#ifndef ELEMENT_TIME_STEP_HH
+#define ELEMENT_TIME_STEP_HH
+
+#include "node_locator.hh"
+#include "async_dumper.hh"
+
+#include <map>
+#include <array>
+#include <string>
+#include <ostream>
+#include <iomanip>
+#include <sstream>
+#include <numeric>
+#include <cmath>
+#include <vector>
+#include <limits>
+#include <algorithm>
+#include <stdexcept>
+
+namespace stable
+{
+    // Characteristic length of an element from its corner nodes: the
+    // smallest height, i.e. dim * volume / largest facet for simplices and
+    // volume / largest facet for boxes (the thinnest side of a brick). A
+    // sliver has a tiny height however long its edges are. Other element
+    // types are rejected.
+    inline akantu::Real characteristic_length(akantu::ElementType type, const std::array<locate::Point, 8> &x)
+    {
+        using locate::Point;
+        auto sub = [](const Point &a, const Point &b) { return Point{a[0] - b[0], a[1] - b[1], a[2] - b[2]}; };
+        auto cross = [](const Point &a, const Point &b)
+        { return Point{a[1] * b[2] - a[2] * b[1], a[2] * b[0] - a[0] * b[2], a[0] * b[1] - a[1] * b[0]}; };
+        auto norm = [](const Point &a) { return std::sqrt(a[0] * a[0] + a[1] * a[1] + a[2] * a[2]); };
+        auto dot = [](const Point &a, const Point &b) { return a[0] * b[0] + a[1] * b[1] + a[2] * b[2]; };
+
+        const locate::Shape shape = locate::Shape::of(type);
+        if (shape.geometry == locate::Shape::simplex && shape.dim == 3)
+        {
+            const akantu::Real volume = std::abs(dot(sub(x[1], x[0]), cross(sub(x[2], x[0]), sub(x[3], x[0])))) / 6.;
+            static const int faces[4][3] = {{0, 1, 2}, {0, 1, 3}, {0, 2, 3}, {1, 2, 3}};
+            akantu::Real largest = 0.;
+            for (const auto &f : faces)
+                largest = std::max(largest, 0.5 * norm(cross(sub(x[f[1]], x[f[0]]), sub(x[f[2]], x[f[0]]))));
+            return largest > 0. ? 3. * volume / largest : 0.;
+        }
+        if (shape.geometry == locate::Shape::box && shape.dim == 3)
+        {
+            // Exact trilinear volume from the 2x2x2 Gauss rule
+            akantu::Real volume = 0.;
+            const akantu::Real g = 1. / std::sqrt(3.);
+            std::array<Point, 8> dN;
+            for (int q = 0; q < 8; ++q)
+            {
+                shape.derivatives({q & 1 ? g : -g, q & 2 ? g : -g, q & 4 ? g : -g}, dN);
+                Point J[3] = {};
+                for (int a = 0; a < 8; ++a)
+                    for (int i = 0; i < 3; ++i)
+                        for (int j = 0; j < 3; ++j)
+                            J[j][i] += x[a][i] * dN[a][j];
+                volume += dot(J[0], cross(J[1], J[2]));
+            }
+            static const int faces[6][4] = {{0, 1, 2, 3}, {4, 5, 6, 7}, {0, 1, 5, 4}, {1, 2, 6, 5}, {2, 3, 7, 6}, {3, 0, 4, 7}};
+            akantu::Real largest = 0.;
+            for (const auto &f : faces)
+                largest = std::max(largest, 0.5 * norm(cross(sub(x[f[2]], x[f[0]]), sub(x[f[3]], x[f[1]]))));
+            return largest > 0. ? std::abs(volume) / largest : 0.;
+        }
+        if (shape.dim == 2)
+        {
+            const akantu::Int n = shape.nb_nodes;
+            akantu::Real area = 0., longest = 0.;
+            for (akantu::Int a = 0; a < n; ++a)
+            {
+                const Point &p = x[a], &q = x[(a + 1) % n];
+                area += 0.5 * (p[0] * q[1] - q[0] * p[1]);
+                longest = std::max(longest, norm(sub(q, p)));
+            }
+            const akantu::Real factor = shape.geometry == locate::Shape::simplex ? 2. : 1.;
+            return longest > 0. ? factor * std::abs(area) / longest : 0.;
+        }
+        std::ostringstream name;
+        name << type;
+        throw std::runtime_error("critical time step: unsupported element type " + name.str());
+    }
+
+    // Critical time step h_e / c_p of every regular element of the mesh's
+    // dimension, in elementTypes() / connectivity order (the order of
+    // elemental dump fields). c_p comes from the element's material (rho, E,
+    // nu). With `calibrate`, steps are scaled so that their minimum equals
+    // the model's getStableTimeStep(): the levels and reports then agree with
+    // the dt Akantu would use, whatever its own length measure.
+    struct ElementTimeSteps
+    {
+        std::vector<akantu::Element> elements;
+        std::vector<akantu::Real> dt;
+        akantu::Real scale{1.};
+
+        template <class Model>
+        static ElementTimeSteps of(Model &model, bool calibrate = true)
+        {
+            ElementTimeSteps steps;
+            const auto &mesh = model.getMesh();
+            const auto &nodes = mesh.getNodes();
+            const akantu::Int dim = mesh.getSpatialDimension();
+            std::map<akantu::Idx, akantu::Real> celerity;
+            for (auto type : mesh.elementTypes(dim, akantu::_not_ghost, akantu::_ek_regular))
+            {
+                const auto &connectivity = mesh.getConnectivity(type, akantu::_not_ghost);
+                const auto &material_index = model.getMaterialByElement(type, akantu::_not_ghost);
+                const akantu::Int corners = locate::Shape::of(type).nb_nodes;
+                for (akantu::Idx e = 0; e < connectivity.size(); ++e)
+                {
+                    std::array<locate::Point, 8> x{};
+                    for (akantu::Int k = 0; k < corners; ++k)
+                        for (akantu::Int d = 0; d < dim; ++d)
+                            x[k][d] = nodes(connectivity(e, k), d);
+                    const akantu::Idx m = material_index(e);
+                    auto it = celerity.find(m);
+                    if (it == celerity.end())
+                    {
+                        const auto &material = model.getMaterial(m);
+                        const akantu::Real rho = material.get("rho");
+                        const akantu::Real E = material.get("E");
+                        const akantu::Real nu = material.get("nu");
+                        it = celerity.emplace(m, std::sqrt(E * (1. - nu) / (rho * (1. + nu) * (1. - 2. * nu)))).first;
+                    }
+                    steps.elements.push_back({type, e, akantu::_not_ghost});
+                    steps.dt.push_back(characteristic_length(type, x) / it->second);
+                }
+            }
+            if (calibrate && !steps.dt.empty())
+            {
+                const akantu::Real smallest = *std::min_element(steps.dt.begin(), steps.dt.end());
+                if (smallest > 0.)
+                    steps.scale = model.getStableTimeStep() / smallest;
+                for (auto &dt : steps.dt)
+                    dt *= steps.scale;
+            }
+            return steps;
+        }
+
+        akantu::Real min() const { return dt.empty() ? 0. : *std::min_element(dt.begin(), dt.end()); }
+        akantu::Real max() const { return dt.empty() ? 0. : *std::max_element(dt.begin(), dt.end()); }
+    };
+
+    // The critical steps as elemental fields critical_dt and dt_over_min
+    // (dt / dt_min) of <directory>/<name>.pvd, to find them in ParaView
+    inline void dump_fields(const akantu::Mesh &mesh, const ElementTimeSteps &steps, const std::string &directory,
+                            const std::string &name)
+    {
+        const akantu::Real smallest = steps.min();
+        dump::AsyncDumper dumper(mesh, directory, name, 1);
+        auto field = [&](auto value)
+        {
+            return [&, value](akantu::Real *out)
+            {
+                for (std::size_t k = 0; k < steps.dt.size(); ++k)
+                    out[dumper.cell_offset(steps.elements[k].type) + steps.elements[k].element] = value(steps.dt[k]);
+            };
+        };
+        dumper.add_elemental("critical_dt", 1, field([](akantu::Real dt) { return dt; }));
+        dumper.add_elemental("dt_over_min", 1, field([smallest](akantu::Real dt) { return dt / smallest; }));
+        dumper.dump(0, 0.);
+        dumper.close();
+    }
+
+    // What limits dt: the distribution of element critical steps as
+    // multiples of the smallest, the `worst` smallest with their centroid and
+    // physical group (mesh data physical_names), and the dt the driver would
+    // get without them. dt_factor / dt_max are the driver's own rule.
+    inline void report(std::ostream &out, const akantu::Mesh &mesh, const ElementTimeSteps &steps,
+                       akantu::Real dt_factor, akantu::Real dt_max = std::numeric_limits<akantu::Real>::max(),
+                       std::size_t worst = 10)
+    {
+        const std::size_t n = steps.dt.size();
+        if (n == 0)
+        {
+            out << "[dt-report] no elements\n";
+            return;
+        }
+        std::vector<std::size_t> order(n);
+        std::iota(order.begin(), order.end(), 0);
+        std::sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b) { return steps.dt[a] < steps.dt[b]; });
+        const akantu::Real smallest = steps.dt[order.front()];
+        const akantu::Real median = steps.dt[order[n / 2]];
+        const auto flags = out.flags();
+        const auto precision = out.precision();
+
+        out << "\n[dt-report] " << n << " elements, critical dt min " << std::setprecision(4) << smallest << " s, median "
+            << median << " s, max " << steps.dt[order.back()] << " s\n";
+        if (dt_max < std::numeric_limits<akantu::Real>::max())
+            out << "[dt-report] dt = min(" << dt_factor << " * " << smallest << ", " << dt_max << ") = "
+                << std::min(dt_factor * smallest, dt_max) << " s"
+                << (dt_factor * smallest < dt_max ? " (set by the mesh)" : " (set by dt_max)") << "\n";
+        else
+            out << "[dt-report] dt = " << dt_factor << " * " << smallest << " = " << dt_factor * smallest << " s\n";
+
+        // Histogram of dt / dt_min
+        const akantu::Real edges[] = {1., 1.1, 1.25, 1.5, 2., 3., 5., 10.};
+        const std::size_t nb_bins = sizeof(edges) / sizeof(edges[0]);
+        std::vector<std::size_t> counts(nb_bins, 0);
+        for (auto dt : steps.dt)
+        {
+            std::size_t b = nb_bins - 1;
+            while (b > 0 && dt < edges[b] * smallest)
+                --b;
+            ++counts[b];
+        }
+        out << std::left << std::setw(20) << "  dt / dt_min" << std::right << std::setw(12) << "elements" << std::setw(10)
+            << "share" << "\n";
+        for (std::size_t b = 0; b < nb_bins; ++b)
+        {
+            std::ostringstream range;
+            range << "[" << edges[b] << ", ";
+            if (b + 1 < nb_bins)
+                range << edges[b + 1] << ")";
+            else
+                range << "inf)";
+            out << "  " << std::left << std::setw(18) << range.str() << std::right << std::setw(12) << counts[b]
+                << std::setw(9) << std::fixed << std::setprecision(3) << 100. * counts[b] / n << "%\n";
+            out.unsetf(std::ios::floatfield);
+        }
+
+        // Worst offenders
+        const auto &nodes = mesh.getNodes();
+        const akantu::Int dim = mesh.getSpatialDimension();
+        out << "  worst " << std::min(worst, n) << ":\n";
+        out << std::left << std::setw(6) << "  #" << std::setw(16) << "type" << std::right << std::setw(10) << "element"
+            << std::setw(14) << "dt [s]" << std::setw(12) << "dt/median" << "   " << std::left << std::setw(32)
+            << "centroid" << "group\n";
+        for (std::size_t k = 0; k < std::min(worst, n); ++k)
+        {
+            const auto &element = steps.elements[order[k]];
+            const auto &connectivity = mesh.getConnectivity(element.type, element.ghost_type);
+            const akantu::Int corners = locate::Shape::of(element.type).nb_nodes;
+            locate::Point c{0., 0., 0.};
+            for (akantu::Int a = 0; a < corners; ++a)
+                for (akantu::Int d = 0; d < dim; ++d)
+                    c[d] += nodes(connectivity(element.element, a), d) / corners;
+            std::string group = "-";
+            if (mesh.hasData("physical_names", element.type, element.ghost_type))
+                group = mesh.getData<std::string>("physical_names", element.type, element.ghost_type)(element.element);
+            std::ostringstream type, centroid;
+            type << element.type;
+            centroid << std::setprecision(6) << "(" << c[0] << ", " << c[1] << ", " << c[2] << ")";
+            out << "  " << std::left << std::setw(4) << k + 1 << std::setw(16) << type.str() << std::right << std::setw(10)
+                << element.element << std::setw(14) << std::setprecision(4) << steps.dt[order[k]] << std::setw(12)
+                << std::setprecision(3) << steps.dt[order[k]] / median << "   " << std::left << std::setw(32)
+                << centroid.str() << group << "\n";
+        }
+
+        // Throughput gained by fixing the worst few
+        for (std::size_t fixed : {1, 10, 100})
+            if (fixed < n)
+            {
+                const akantu::Real dt = std::min(dt_factor * steps.dt[order[fixed]], dt_max);
+                out << "  without the worst " << std::setw(4) << std::left << fixed << std::right << ": dt " << std::setprecision(4)
+                    << dt << " s (x" << std::setprecision(3) << dt / std::min(dt_factor * smallest, dt_max) << " throughput)\n";
+            }
+        out.flags(flags);
+        out.precision(precision);
+    }
+} // namespace stable
+
+#endif
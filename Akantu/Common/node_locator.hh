@@ -0,0 +1,561 @@
+#ifndef NODE_LOCATOR_HH
+#define NODE_LOCATOR_HH
+
+#include "mesh.hh"
+#include "aka_common.hh"
+
+#include <array>
+#include <vector>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include <stdexcept>
+
+namespace locate
+{
+    using Point = std::array<akantu::Real, 3>;
+
+    // Axis-aligned box; unused axes of a 2-D mesh stay at 0.
+    struct Box
+    {
+        Point lo{0., 0., 0.};
+        Point hi{0., 0., 0.};
+    };
+
+    // Uniform bucket grid over a point set, built once in O(N). Cells hold about
+    // `per_cell` points on average, so nearest-node and box queries only visit
+    // the cells they overlap instead of scanning every node.
+    class Grid
+    {
+    public:
+        Grid() = default;
+
+        void build(const std::vector<Box> &items, const Box &bounds, akantu::Real per_cell = 2.0)
+        {
+            this->bounds = bounds;
+            std::array<akantu::Real, 3> extent{};
+            int active = 0;
+            for (int d = 0; d < 3; ++d)
+            {
+                extent[d] = bounds.hi[d] - bounds.lo[d];
+                if (extent[d] > 0.)
+                    ++active;
+            }
+            akantu::Real volume = 1.;
+            for (int d = 0; d < 3; ++d)
+                if (extent[d] > 0.)
+                    volume *= extent[d];
+            const akantu::Real target = std::max<akantu::Real>(1., items.size() / per_cell);
+            const akantu::Real h = active ? std::pow(volume / target, 1. / active) : 1.;
+            for (int d = 0; d < 3; ++d)
+            {
+                n[d] = extent[d] > 0. ? std::max(1, std::min(1024, static_cast<int>(std::ceil(extent[d] / h)))) : 1;
+                cell[d] = extent[d] > 0. ? extent[d] / n[d] : 1.;
+            }
+
+            // Counting sort of items into every cell their box touches
+            start.assign(static_cast<std::size_t>(n[0]) * n[1] * n[2] + 1, 0);
+            for (const auto &b : items)
+                visit(b, [&](std::size_t c) { ++start[c + 1]; });
+            for (std::size_t c = 1; c < start.size(); ++c)
+                start[c] += start[c - 1];
+            entries.resize(start.back());
+            std::vector<std::size_t> fill(start.begin(), start.end() - 1);
+            for (std::size_t i = 0; i < items.size(); ++i)
+                visit(items[i], [&](std::size_t c) { entries[fill[c]++] = static_cast<akantu::Int>(i); });
+        }
+
+        int index(akantu::Real x, int d) const
+        {
+            int i = static_cast<int>(std::floor((x - bounds.lo[d]) / cell[d]));
+            return std::max(0, std::min(n[d] - 1, i));
+        }
+
+        // Calls f(cell id) for every cell overlapping the box
+        template <class F>
+        void visit(const Box &b, F &&f) const
+        {
+            const int i0 = index(b.lo[0], 0), i1 = index(b.hi[0], 0);
+            const int j0 = index(b.lo[1], 1), j1 = index(b.hi[1], 1);
+            const int k0 = index(b.lo[2], 2), k1 = index(b.hi[2], 2);
+            for (int k = k0; k <= k1; ++k)
+                for (int j = j0; j <= j1; ++j)
+                    for (int i = i0; i <= i1; ++i)
+                        f((static_cast<std::size_t>(k) * n[1] + j) * n[0] + i);
+        }
+
+        template <class F>
+        void for_each_in_cell(std::size_t c, F &&f) const
+        {
+            for (std::size_t e = start[c]; e < start[c + 1]; ++e)
+                f(entries[e]);
+        }
+
+        Box bounds;
+        std::array<int, 3> n{1, 1, 1};
+        std::array<akantu::Real, 3> cell{1., 1., 1.};
+        std::vector<std::size_t> start;
+        std::vector<akantu::Int> entries;
+    };
+
+    // Node queries on the mesh coordinates (nearest, box, plane) through a
+    // uniform grid. Build it once after mesh.read() and share it between all
+    // boundary conditions and probes.
+    class NodeLocator
+    {
+    public:
+        explicit NodeLocator(const akantu::Mesh &mesh)
+            : NodeLocator(mesh.getNodes(), mesh.getSpatialDimension())
+        {
+        }
+
+        NodeLocator(const akantu::Array<akantu::Real> &nodes, akantu::Int dim)
+        {
+            const akantu::Int nb_nodes = nodes.size();
+            coords.resize(nb_nodes);
+            std::vector<Box> items(nb_nodes);
+            for (int d = 0; d < 3; ++d)
+            {
+                box.lo[d] = std::numeric_limits<akantu::Real>::max();
+                box.hi[d] = std::numeric_limits<akantu::Real>::lowest();
+            }
+            for (akantu::Int node = 0; node < nb_nodes; ++node)
+            {
+                Point p{0., 0., 0.};
+                for (akantu::Int d = 0; d < dim; ++d)
+                    p[d] = nodes(node, d);
+                coords[node] = p;
+                items[node] = {p, p};
+                for (int d = 0; d < 3; ++d)
+                {
+                    box.lo[d] = std::min(box.lo[d], p[d]);
+                    box.hi[d] = std::max(box.hi[d], p[d]);
+                }
+            }
+            if (nb_nodes == 0)
+                box = Box{};
+            grid.build(items, box);
+        }
+
+        const Box &bounds() const { return box; }
+        const Point &position(akantu::Int node) const { return coords[node]; }
+        akantu::Int size() const { return static_cast<akantu::Int>(coords.size()); }
+
+        // Closest node to p among those accepted by keep(node); -1 if none
+        template <class Keep>
+        akantu::Int nearest(const Point &p, Keep &&keep) const
+        {
+            akantu::Int best = -1;
+            akantu::Real best_d2 = std::numeric_limits<akantu::Real>::max();
+            const std::array<int, 3> c{grid.index(p[0], 0), grid.index(p[1], 1), grid.index(p[2], 2)};
+            const int max_ring = std::max({grid.n[0], grid.n[1], grid.n[2]});
+            for (int ring = 0; ring <= max_ring; ++ring)
+            {
+                // Any node outside this ring is at least `reach` away
+                if (best >= 0)
+                {
+                    akantu::Real reach = std::numeric_limits<akantu::Real>::max();
+                    for (int d = 0; d < 3; ++d)
+                    {
+                        // Sides already at the edge of the grid have nothing beyond them
+                        if (c[d] - ring + 1 > 0)
+                            reach = std::min(reach, p[d] - (grid.bounds.lo[d] + (c[d] - ring + 1) * grid.cell[d]));
+                        if (c[d] + ring < grid.n[d])
+                            reach = std::min(reach, grid.bounds.lo[d] + (c[d] + ring) * grid.cell[d] - p[d]);
+                    }
+                    if (reach > 0. && reach * reach > best_d2)
+                        break;
+                }
+                for (int k = c[2] - ring; k <= c[2] + ring; ++k)
+                    for (int j = c[1] - ring; j <= c[1] + ring; ++j)
+                        for (int i = c[0] - ring; i <= c[0] + ring; ++i)
+                        {
+                            if (i < 0 || j < 0 || k < 0 || i >= grid.n[0] || j >= grid.n[1] || k >= grid.n[2])
+                                continue;
+                            if (std::max({std::abs(i - c[0]), std::abs(j - c[1]), std::abs(k - c[2])}) != ring)
+                                continue;
+                            grid.for_each_in_cell((static_cast<std::size_t>(k) * grid.n[1] + j) * grid.n[0] + i,
+                                                  [&](akantu::Int node)
+                                                  {
+                                                      if (!keep(node))
+                                                          return;
+                                                      const akantu::Real d2 = distance2(coords[node], p);
+                                                      if (d2 < best_d2 || (d2 == best_d2 && node < best))
+                                                      {
+                                                          best_d2 = d2;
+                                                          best = node;
+                                                      }
+                                                  });
+                        }
+            }
+            return best;
+        }
+
+        akantu::Int nearest(const Point &p) const
+        {
+            return nearest(p, [](akantu::Int) { return true; });
+        }
+
+        // Nodes with lo <= x <= hi on every axis, in increasing node order
+        std::vector<akantu::Int> in_box(const Box &b) const
+        {
+            std::vector<akantu::Int> found;
+            grid.visit(b, [&](std::size_t c)
+                       { grid.for_each_in_cell(c, [&](akantu::Int node)
+                                               {
+                                                   const Point &x = coords[node];
+                                                   for (int d = 0; d < 3; ++d)
+                                                       if (x[d] < b.lo[d] || x[d] > b.hi[d])
+                                                           return;
+                                                   found.push_back(node); }); });
+            std::sort(found.begin(), found.end());
+            return found;
+        }
+
+        // Nodes with |x[axis] - value| <= tol
+        std::vector<akantu::Int> on_plane(int axis, akantu::Real value, akantu::Real tol) const
+        {
+            Box b = box;
+            b.lo[axis] = value - tol;
+            b.hi[axis] = value + tol;
+            return in_box(b);
+        }
+
+        // Nodes within tol of a point (e.g. a corner)
+        std::vector<akantu::Int> near(const Point &p, akantu::Real tol) const
+        {
+            Box b;
+            for (int d = 0; d < 3; ++d)
+            {
+                b.lo[d] = p[d] - tol;
+                b.hi[d] = p[d] + tol;
+            }
+            return in_box(b);
+        }
+
+        static akantu::Real distance2(const Point &a, const Point &b)
+        {
+            akantu::Real s = 0.;
+            for (int d = 0; d < 3; ++d)
+                s += (a[d] - b[d]) * (a[d] - b[d]);
+            return s;
+        }
+
+    private:
+        std::vector<Point> coords;
+        Box box;
+        Grid grid;
+    };
+
+    // Interpolation shape of an element type in natural coordinates: simplices
+    // (xi = barycentric weights of nodes 1..dim) and boxes (xi in [-1, 1]^dim,
+    // Akantu/VTK node order). Higher-order types interpolate linearly on their
+    // corner nodes.
+    struct Shape
+    {
+        enum Geometry
+        {
+            none,
+            simplex,
+            box
+        };
+
+        Geometry geometry{none};
+        akantu::Int dim{0};
+        akantu::Int nb_nodes{0};
+
+        static Shape of(akantu::ElementType type)
+        {
+            switch (type)
+            {
+            case akantu::_triangle_3:
+            case akantu::_triangle_6: return {simplex, 2, 3};
+            case akantu::_tetrahedron_4:
+            case akantu::_tetrahedron_10: return {simplex, 3, 4};
+            case akantu::_quadrangle_4: return {box, 2, 4};
+            case akantu::_hexahedron_8: return {box, 3, 8};
+            default: return {};
+            }
+        }
+
+        void functions(const Point &xi, akantu::Real *N) const
+        {
+            if (geometry == simplex)
+            {
+                N[0] = 1.;
+                for (akantu::Int d = 0; d < dim; ++d)
+                {
+                    N[d + 1] = xi[d];
+                    N[0] -= xi[d];
+                }
+                return;
+            }
+            for (akantu::Int a = 0; a < nb_nodes; ++a)
+            {
+                N[a] = 1. / nb_nodes;
+                for (akantu::Int d = 0; d < dim; ++d)
+                    N[a] *= 1. + corner(a, d) * xi[d];
+            }
+        }
+
+        // dN[a][j] = dN_a / dxi_j
+        void derivatives(const Point &xi, std::array<Point, 8> &dN) const
+        {
+            for (auto &row : dN)
+                row = {0., 0., 0.};
+            if (geometry == simplex)
+            {
+                for (akantu::Int d = 0; d < dim; ++d)
+                {
+                    dN[0][d] = -1.;
+                    dN[d + 1][d] = 1.;
+                }
+                return;
+            }
+            for (akantu::Int a = 0; a < nb_nodes; ++a)
+                for (akantu::Int j = 0; j < dim; ++j)
+                {
+                    akantu::Real v = corner(a, j) / nb_nodes;
+                    for (akantu::Int d = 0; d < dim; ++d)
+                        if (d != j)
+                            v *= 1. + corner(a, d) * xi[d];
+                    dN[a][j] = v;
+                }
+        }
+
+        // How far xi lies outside the reference element (<= 0 inside)
+        akantu::Real violation(const Point &xi) const
+        {
+            akantu::Real v = std::numeric_limits<akantu::Real>::lowest();
+            if (geometry == simplex)
+            {
+                akantu::Real sum = 0.;
+                for (akantu::Int d = 0; d < dim; ++d)
+                {
+                    v = std::max(v, -xi[d]);
+                    sum += xi[d];
+                }
+                return std::max(v, sum - 1.);
+            }
+            for (akantu::Int d = 0; d < dim; ++d)
+                v = std::max(v, std::abs(xi[d]) - 1.);
+            return v;
+        }
+
+    private:
+        // Sign of box node a along axis d: 0-1-2-3 counter-clockwise, then 4-7 above
+        static akantu::Real corner(akantu::Int a, akantu::Int d)
+        {
+            static const akantu::Real sign[8][3] = {{-1, -1, -1}, {1, -1, -1}, {1, 1, -1}, {-1, 1, -1},
+                                                    {-1, -1, 1}, {1, -1, 1}, {1, 1, 1}, {-1, 1, 1}};
+            return sign[a][d];
+        }
+    };
+
+    // Containing element of a point: its natural coordinates and the
+    // interpolation weights of its (corner) nodes.
+    struct ElementHit
+    {
+        akantu::Element element{akantu::ElementNull};
+        std::array<akantu::Idx, 8> nodes{};
+        std::array<akantu::Real, 8> weights{};
+        akantu::Int nb_nodes{0};
+        Point xi{0., 0., 0.};
+        akantu::Real violation{std::numeric_limits<akantu::Real>::max()};
+
+        bool found() const { return element != akantu::ElementNull; }
+    };
+
+    // Grid over the bounding boxes of every non-ghost element of the mesh's
+    // spatial dimension; a query tests only the elements of one cell.
+    class ElementLocator
+    {
+    public:
+        explicit ElementLocator(const akantu::Mesh &mesh)
+            : mesh(mesh), dim(mesh.getSpatialDimension())
+        {
+            const auto &nodes = mesh.getNodes();
+            std::vector<Box> items;
+            Box all;
+            for (int d = 0; d < 3; ++d)
+            {
+                all.lo[d] = std::numeric_limits<akantu::Real>::max();
+                all.hi[d] = std::numeric_limits<akantu::Real>::lowest();
+            }
+            for (auto type : mesh.elementTypes(dim))
+            {
+                const Shape shape = Shape::of(type);
+                if (shape.geometry == Shape::none || shape.dim != dim)
+                    continue;
+                const auto &connectivity = mesh.getConnectivity(type, akantu::_not_ghost);
+                for (akantu::Idx e = 0; e < connectivity.size(); ++e)
+                {
+                    Box b;
+                    for (int d = 0; d < 3; ++d)
+                    {
+                        b.lo[d] = dim > d ? std::numeric_limits<akantu::Real>::max() : 0.;
+                        b.hi[d] = dim > d ? std::numeric_limits<akantu::Real>::lowest() : 0.;
+                    }
+                    for (akantu::Int k = 0; k < shape.nb_nodes; ++k)
+                        for (akantu::Int d = 0; d < dim; ++d)
+                        {
+                            const akantu::Real x = nodes(connectivity(e, k), d);
+                            b.lo[d] = std::min(b.lo[d], x);
+                            b.hi[d] = std::max(b.hi[d], x);
+                        }
+                    for (int d = 0; d < 3; ++d)
+                    {
+                        all.lo[d] = std::min(all.lo[d], b.lo[d]);
+                        all.hi[d] = std::max(all.hi[d], b.hi[d]);
+                    }
+                    items.push_back(b);
+                    elements.push_back({type, e, akantu::_not_ghost});
+                }
+            }
+            if (items.empty())
+                all = Box{};
+            grid.build(items, all, 1.0);
+        }
+
+        // tol: how far outside an element (in natural coordinates) still counts
+        ElementHit locate(const Point &p, akantu::Real tol = 1e-10) const
+        {
+            ElementHit best;
+            const std::size_t c = (static_cast<std::size_t>(grid.index(p[2], 2)) * grid.n[1] + grid.index(p[1], 1)) *
+                                      grid.n[0] +
+                                  grid.index(p[0], 0);
+            grid.for_each_in_cell(c, [&](akantu::Int i)
+                                  {
+                                      ElementHit hit = natural(elements[i], p);
+                                      if (hit.violation <= tol && hit.violation < best.violation)
+                                          best = hit; });
+            return best;
+        }
+
+        // Inverse isoparametric map by Newton's method (exact in one step for simplices)
+        ElementHit natural(const akantu::Element &element, const Point &p) const
+        {
+            const Shape shape = Shape::of(element.type);
+            ElementHit hit;
+            hit.element = element;
+            hit.nb_nodes = shape.nb_nodes;
+            const auto x = corners(element, hit.nodes);
+            Point xi{0., 0., 0.};
+            if (shape.geometry == Shape::simplex)
+                xi.fill(1. / (dim + 1));
+            for (int iteration = 0; iteration < 20; ++iteration)
+            {
+                shape.functions(xi, hit.weights.data());
+                std::array<Point, 8> dN;
+                shape.derivatives(xi, dN);
+                Matrix J = jacobian(x, dN, shape.nb_nodes);
+                Point r{0., 0., 0.};
+                for (akantu::Int d = 0; d < dim; ++d)
+                {
+                    r[d] = p[d];
+                    for (akantu::Int a = 0; a < shape.nb_nodes; ++a)
+                        r[d] -= hit.weights[a] * x[a][d];
+                }
+                const Point step = solve(J, r);
+                if (!std::isfinite(step[0]))
+                    return hit;
+                akantu::Real change = 0.;
+                for (akantu::Int d = 0; d < dim; ++d)
+                {
+                    xi[d] += step[d];
+                    change = std::max(change, std::abs(step[d]));
+                }
+                if (change < 1e-13 || std::abs(xi[0]) > 1e3)
+                    break;
+            }
+            shape.functions(xi, hit.weights.data());
+            hit.xi = xi;
+            hit.violation = shape.violation(xi);
+            return hit;
+        }
+
+        // Physical gradients dN_a/dx of the hit element's shape functions at the hit point
+        std::array<Point, 8> gradients(const ElementHit &hit) const
+        {
+            const Shape shape = Shape::of(hit.element.type);
+            std::array<akantu::Idx, 8> nodes;
+            const auto x = corners(hit.element, nodes);
+            std::array<Point, 8> dN, grad;
+            shape.derivatives(hit.xi, dN);
+            const Matrix J = jacobian(x, dN, shape.nb_nodes);
+            for (akantu::Int a = 0; a < 8; ++a)
+                grad[a] = a < shape.nb_nodes ? solve(transpose(J), dN[a]) : Point{0., 0., 0.};
+            return grad;
+        }
+
+    private:
+        using Matrix = std::array<std::array<akantu::Real, 3>, 3>;
+
+        std::array<Point, 8> corners(const akantu::Element &element, std::array<akantu::Idx, 8> &ids) const
+        {
+            const auto &nodes = mesh.getNodes();
+            const auto &connectivity = mesh.getConnectivity(element.type, element.ghost_type);
+            std::array<Point, 8> x{};
+            for (akantu::Int k = 0; k < Shape::of(element.type).nb_nodes; ++k)
+            {
+                ids[k] = connectivity(element.element, k);
+                for (akantu::Int d = 0; d < dim; ++d)
+                    x[k][d] = nodes(ids[k], d);
+            }
+            return x;
+        }
+
+        // J[i][j] = dx_i / dxi_j; unused axes of a 2-D element map to themselves
+        Matrix jacobian(const std::array<Point, 8> &x, const std::array<Point, 8> &dN, akantu::Int nb_nodes) const
+        {
+            Matrix J{};
+            for (akantu::Int i = 0; i < dim; ++i)
+                for (akantu::Int j = 0; j < dim; ++j)
+                    for (akantu::Int a = 0; a < nb_nodes; ++a)
+                        J[i][j] += x[a][i] * dN[a][j];
+            for (akantu::Int d = dim; d < 3; ++d)
+                J[d][d] = 1.;
+            return J;
+        }
+
+        static Matrix transpose(const Matrix &m)
+        {
+            Matrix t;
+            for (int i = 0; i < 3; ++i)
+                for (int j = 0; j < 3; ++j)
+                    t[i][j] = m[j][i];
+            return t;
+        }
+
+        // Cramer's rule; NaN when the matrix is singular
+        static Point solve(const Matrix &a, const Point &r)
+        {
+            const akantu::Real det = determinant(a);
+            if (det == 0.)
+                return {std::numeric_limits<akantu::Real>::quiet_NaN(), 0., 0.};
+            Point x;
+            for (int k = 0; k < 3; ++k)
+            {
+                Matrix m = a;
+                for (int d = 0; d < 3; ++d)
+                    m[d][k] = r[d];
+                x[k] = determinant(m) / det;
+            }
+            return x;
+        }
+
+        static akantu::Real determinant(const Matrix &m)
+        {
+            return m[0][0] * (m[1][1] * m[2][2] - m[1][2] * m[2][1]) -
+                   m[0][1] * (m[1][0] * m[2][2] - m[1][2] * m[2][0]) +
+                   m[0][2] * (m[1][0] * m[2][1] - m[1][1] * m[2][0]);
+        }
+
+        const akantu::Mesh &mesh;
+        akantu::Int dim;
+        std::vector<akantu::Element> elements;
+        Grid grid;
+    };
+} // namespace locate
+
+#endif
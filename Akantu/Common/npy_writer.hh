@@ -0,0 +1,113 @@
+#ifndef NPY_WRITER_HH
+#define NPY_WRITER_HH
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+
+namespace npy
+{
+    template <class T>
+    struct dtype;
+    template <>
+    struct dtype<float>
+    {
+        static constexpr const char *descr = "<f4";
+    };
+    template <>
+    struct dtype<double>
+    {
+        static constexpr const char *descr = "<f8";
+    };
+
+    // Streams rows of a C-order .npy array (rows x columns) without knowing
+    // the row count up front: the header is padded to a fixed size and the
+    // leading dimension is patched on close(). np.load(path, mmap_mode='r')
+    // then maps it without copying.
+    template <class T>
+    class Writer
+    {
+    public:
+        Writer(const std::string &path, std::size_t columns) : path(path), columns(columns), out(path, std::ios::binary | std::ios::trunc)
+        {
+            if (!out)
+                throw std::runtime_error("npy: cannot create " + path);
+            write_header();
+        }
+
+        ~Writer()
+        {
+            try
+            {
+                close();
+            }
+            catch (const std::exception &)
+            {
+            }
+        }
+
+        Writer(const Writer &) = delete;
+        Writer &operator=(const Writer &) = delete;
+
+        void append(const T *row)
+        {
+            out.write(reinterpret_cast<const char *>(row), columns * sizeof(T));
+            ++rows;
+        }
+
+        void close()
+        {
+            if (!out.is_open())
+                return;
+            write_header();
+            out.close();
+            if (!out)
+                throw std::runtime_error("npy: write failed for " + path);
+        }
+
+        std::size_t size() const { return rows; }
+        std::uint64_t bytes() const { return header_size + rows * columns * sizeof(T); }
+
+        // Whole array in one call
+        static void save(const std::string &path, const std::vector<T> &values, std::size_t columns)
+        {
+            Writer w(path, columns);
+            for (std::size_t r = 0; r + columns <= values.size(); r += columns)
+                w.append(values.data() + r);
+        }
+
+    private:
+        static constexpr std::size_t header_size = 128;
+
+        void write_header()
+        {
+            char dict[header_size];
+            const int n = columns == 1
+                              ? std::snprintf(dict, sizeof(dict), "{'descr': '%s', 'fortran_order': False, 'shape': (%zu,), }",
+                                              dtype<T>::descr, rows)
+                              : std::snprintf(dict, sizeof(dict), "{'descr': '%s', 'fortran_order': False, 'shape': (%zu, %zu), }",
+                                              dtype<T>::descr, rows, columns);
+            std::string header("\x93NUMPY\x01\x00", 8);
+            const std::uint16_t length = header_size - 10;
+            header.append(reinterpret_cast<const char *>(&length), 2);
+            header.append(dict, n);
+            header.append(header_size - 1 - header.size(), ' ');
+            header.push_back('\n');
+            const auto position = out.tellp();
+            out.seekp(0);
+            out.write(header.data(), header.size());
+            if (position > static_cast<std::streamoff>(header_size))
+                out.seekp(position);
+        }
+
+        std::string path;
+        std::size_t columns;
+        std::size_t rows{0};
+        std::ofstream out;
+    };
+} // namespace npy
+
+#endif
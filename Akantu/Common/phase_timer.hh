@@ -0,0 +1,180 @@
+#ifndef PHASE_TIMER_HH
+#define PHASE_TIMER_HH
+
+#include <chrono>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <ostream>
+#include <iomanip>
+#include <algorithm>
+#include <stdexcept>
+
+namespace timing
+{
+    using Clock = std::chrono::steady_clock;
+
+    // Wall time per phase of the time loop plus named counters. Phases and
+    // counters are registered once and then addressed by id, so timing a
+    // phase costs two clock reads. With a trace path every timed interval is
+    // also kept (up to max_events) and written as Chrome-trace JSON, viewable
+    // in chrome://tracing or Perfetto.
+    class PhaseTimer
+    {
+    public:
+        explicit PhaseTimer(std::string trace_path = "", std::size_t max_events = 2000000)
+            : trace_path(std::move(trace_path)), max_events(max_events), origin(Clock::now())
+        {
+        }
+
+        // Stops its phase when it goes out of scope
+        class Scope
+        {
+        public:
+            Scope(PhaseTimer &timer, int id) : timer(timer), id(id), start(Clock::now()) {}
+            ~Scope() { timer.stop(id, start); }
+            Scope(const Scope &) = delete;
+            Scope &operator=(const Scope &) = delete;
+
+        private:
+            PhaseTimer &timer;
+            int id;
+            Clock::time_point start;
+        };
+
+        int phase(const std::string &name) { return find_or_add(phases, name); }
+        int counter(const std::string &name) { return find_or_add(counters, name); }
+
+        Scope time(int id) { return Scope(*this, id); }
+
+        void add(int id, std::uint64_t n = 1) { counters[id].value += n; }
+        void set(int id, std::uint64_t value) { counters[id].value = value; }
+        std::uint64_t value(int id) const { return counters[id].value; }
+
+        double elapsed() const { return std::chrono::duration<double>(Clock::now() - origin).count(); }
+
+        // Per-phase calls, total, mean and worst interval and share of the
+        // wall time since construction; the remainder is shown as (untimed).
+        void report(std::ostream &out) const
+        {
+            const double wall = elapsed();
+            double timed = 0.;
+            const auto flags = out.flags();
+            const auto precision = out.precision();
+            // Every row sets its own precision and hands the stream back as
+            // it found it, so no row depends on what the previous one left
+            auto end_row = [&]()
+            {
+                out << "\n";
+                out.flags(flags);
+                out.precision(precision);
+            };
+            out << "\n" << std::left << std::setw(24) << "phase" << std::right << std::setw(12) << "calls"
+                << std::setw(14) << "total [s]" << std::setw(14) << "mean [us]" << std::setw(14) << "max [us]"
+                << std::setw(9) << "share";
+            end_row();
+            for (const auto &p : phases)
+            {
+                timed += p.total;
+                out << std::left << std::setw(24) << p.name << std::right << std::setw(12) << p.calls << std::fixed
+                    << std::setw(14) << std::setprecision(3) << p.total << std::setw(14) << std::setprecision(1)
+                    << (p.calls ? 1e6 * p.total / p.calls : 0.) << std::setw(14) << 1e6 * p.longest << std::setw(8)
+                    << 100. * p.total / wall << "%";
+                end_row();
+            }
+            out << std::left << std::setw(24) << "(untimed)" << std::right << std::setw(12) << "" << std::fixed
+                << std::setw(14) << std::setprecision(3) << wall - timed << std::setw(36) << std::setprecision(1)
+                << 100. * (wall - timed) / wall << "%";
+            end_row();
+            out << std::left << std::setw(24) << "wall" << std::right << std::setw(12) << "" << std::fixed
+                << std::setw(14) << std::setprecision(3) << wall;
+            end_row();
+            for (const auto &c : counters)
+            {
+                out << std::left << std::setw(24) << c.name << std::right << std::setw(12) << c.value;
+                end_row();
+            }
+            if (dropped)
+                out << "[i] trace kept the first " << events.size() << " intervals, dropped " << dropped << "\n";
+        }
+
+        // Chrome-trace JSON of the kept intervals; no-op without a trace path
+        void write_trace() const
+        {
+            if (trace_path.empty())
+                return;
+            std::ofstream out(trace_path);
+            if (!out)
+                throw std::runtime_error("PhaseTimer: cannot write " + trace_path);
+            out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+            char line[256];
+            for (std::size_t k = 0; k < events.size(); ++k)
+            {
+                std::snprintf(line, sizeof(line), "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":0,\"tid\":0,\"ts\":%.3f,\"dur\":%.3f}\n",
+                              k ? "," : "", phases[events[k].phase].name.c_str(), events[k].start, events[k].duration);
+                out << line;
+            }
+            out << "]}\n";
+        }
+
+        const std::string &trace() const { return trace_path; }
+
+    private:
+        struct Phase
+        {
+            std::string name;
+            std::uint64_t calls{0};
+            double total{0.}, longest{0.};
+        };
+
+        struct Counter
+        {
+            std::string name;
+            std::uint64_t value{0};
+        };
+
+        struct Event
+        {
+            int phase;
+            double start, duration; // us since construction
+        };
+
+        template <class T>
+        static int find_or_add(std::vector<T> &items, const std::string &name)
+        {
+            for (std::size_t k = 0; k < items.size(); ++k)
+                if (items[k].name == name)
+                    return static_cast<int>(k);
+            items.push_back(T{name});
+            return static_cast<int>(items.size() - 1);
+        }
+
+        void stop(int id, Clock::time_point start)
+        {
+            const auto end = Clock::now();
+            const double seconds = std::chrono::duration<double>(end - start).count();
+            Phase &p = phases[id];
+            ++p.calls;
+            p.total += seconds;
+            p.longest = std::max(p.longest, seconds);
+            if (trace_path.empty())
+                return;
+            if (events.size() < max_events)
+                events.push_back({id, std::chrono::duration<double, std::micro>(start - origin).count(), 1e6 * seconds});
+            else
+                ++dropped;
+        }
+
+        std::string trace_path;
+        std::size_t max_events;
+        Clock::time_point origin;
+        std::vector<Phase> phases;
+        std::vector<Counter> counters;
+        std::vector<Event> events;
+        std::uint64_t dropped{0};
+    };
+} // namespace timing
+
+#endif
@@ -0,0 +1,336 @@
+#ifndef PROBES_HH
+#define PROBES_HH
+
+#include "node_locator.hh"
+#include "run_spec.hh"
+
+#include <array>
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+namespace probe
+{
+    // Virtual strain gauge: position and gauge axis in mesh units
+    struct Gauge
+    {
+        std::string name;
+        locate::Point position{0., 0., 0.};
+        locate::Point direction{1., 0., 0.};
+    };
+
+    // Per-gauge channels of every record, in this order
+    enum Channel
+    {
+        strain = 0, // n . eps . n
+        stress,     // n . sigma . n
+        vx,
+        vy,
+        vz,
+        nb_channels
+    };
+
+    // Gauges in the material-file block syntax:
+    //   probe G1 [
+    //     position  = [100, 150, 20]
+    //     direction = [1, 0, 0]
+    //   ]
+    // '#' starts a comment; the direction is normalised.
+    inline std::vector<Gauge> read_config(const std::string &path)
+    {
+        std::vector<Gauge> gauges;
+        for (const auto &block : spec::read_blocks(path))
+        {
+            if (block.kind != "probe")
+                continue;
+            block.expect_only({"position", "direction"});
+            Gauge g;
+            g.name = block.name;
+            const auto position = block.reals("position");
+            const auto direction = block.has("direction") ? block.reals("direction") : std::vector<akantu::Real>{1., 0., 0.};
+            for (std::size_t d = 0; d < 3; ++d)
+            {
+                g.position[d] = d < position.size() ? position[d] : 0.;
+                g.direction[d] = d < direction.size() ? direction[d] : 0.;
+            }
+            if (position.empty())
+                throw std::runtime_error("probe " + g.name + ": no position");
+            const akantu::Real norm = std::sqrt(locate::NodeLocator::distance2(g.direction, {0., 0., 0.}));
+            if (norm == 0.)
+                throw std::runtime_error("probe " + g.name + ": zero direction");
+            for (auto &c : g.direction)
+                c /= norm;
+            gauges.push_back(g);
+        }
+        return gauges;
+    }
+
+    // Symmetry planes of a reduced (half / quarter) model. A gauge given in
+    // full-model coordinates is reflected into the modelled part together
+    // with its axis, so strain and stress along the axis are unchanged; the
+    // reflected velocity components change sign.
+    struct Mirror
+    {
+        std::array<bool, 3> active{false, false, false};
+        locate::Point plane{0., 0., 0.};  // coordinate of the plane normal to each axis
+        std::array<int, 3> side{1, 1, 1}; // +1: the model lies at coordinates >= plane
+
+        // -1 on the axes p must be reflected across to lie in the model
+        std::array<akantu::Real, 3> flips(const locate::Point &p) const
+        {
+            std::array<akantu::Real, 3> f{1., 1., 1.};
+            for (int d = 0; d < 3; ++d)
+                if (active[d] && (p[d] - plane[d]) * side[d] < 0.)
+                    f[d] = -1.;
+            return f;
+        }
+
+        locate::Point reflect(const locate::Point &p, const std::array<akantu::Real, 3> &f) const
+        {
+            locate::Point q = p;
+            for (int d = 0; d < 3; ++d)
+                if (f[d] < 0.)
+                    q[d] = 2. * plane[d] - p[d];
+            return q;
+        }
+    };
+
+    // Samples every gauge each call and appends one record to a binary file:
+    //   "CCPROBE1" | u32 gauges | u32 channels | u64 header bytes
+    //   | per gauge: char name[32], f64 position[3], f64 direction[3]
+    //   | records: f64 time, f32 value[gauges][channels]
+    // The record count follows from the file size, so a file cut short by a
+    // crash still reads up to its last complete record. Strain comes from the
+    // displacement gradient at the gauge point, velocity from the nodal
+    // interpolation and stress is the quadrature mean of the containing element.
+    // With a Mirror, positions and values are those of the full model.
+    class ProbeRecorder
+    {
+    public:
+        ProbeRecorder(const akantu::Mesh &mesh, std::vector<Gauge> gauges, const std::string &path,
+                      std::size_t flush_records = 256, const Mirror &mirror = {})
+            : mesh(mesh), gauges(std::move(gauges)), dim(mesh.getSpatialDimension()), flush_records(flush_records),
+              out(path, std::ios::binary | std::ios::trunc)
+        {
+            if (!out)
+                throw std::runtime_error("probe: cannot create " + path);
+            locate::ElementLocator locator(mesh);
+            for (const auto &g : this->gauges)
+            {
+                const auto f = mirror.flips(g.position);
+                flips.push_back(f);
+                directions.push_back({f[0] * g.direction[0], f[1] * g.direction[1], f[2] * g.direction[2]});
+                auto hit = locator.locate(mirror.reflect(g.position, f), 1e-6);
+                if (!hit.found())
+                    throw std::runtime_error("probe " + g.name + ": position is outside the mesh");
+                hits.push_back(hit);
+                gradients.push_back(locator.gradients(hit));
+            }
+            write_header();
+            record.resize(sizeof(double) + this->gauges.size() * nb_channels * sizeof(float));
+        }
+
+        ~ProbeRecorder() { flush(); }
+
+        ProbeRecorder(const ProbeRecorder &) = delete;
+        ProbeRecorder &operator=(const ProbeRecorder &) = delete;
+
+        const std::vector<Gauge> &gauge_list() const { return gauges; }
+        const locate::ElementHit &element(std::size_t g) const { return hits[g]; }
+        std::uint64_t bytes_written() const { return bytes; }
+
+        // Any model with getDisplacement/getVelocity/getMaterialByElement/
+        // getMaterialLocalNumbering/getMaterial (solid mechanics, cohesive).
+        template <class Model>
+        void sample(const Model &model, akantu::Real time)
+        {
+            sample(model, time,
+                   [&](const akantu::Element &element, akantu::Real(&sigma)[3][3])
+                   { material_stress(model, element, sigma); });
+        }
+
+        // Same, with the element stresses from stress_of(element, sigma[3][3])
+        // instead of the materials (e.g. subcycle::Integrator::stress)
+        template <class Model, class StressOf>
+        void sample(const Model &model, akantu::Real time, StressOf &&stress_of)
+        {
+            const auto &u = model.getDisplacement();
+            const auto &v = model.getVelocity();
+            std::memcpy(record.data(), &time, sizeof(double));
+            float *values = reinterpret_cast<float *>(record.data() + sizeof(double));
+
+            for (std::size_t g = 0; g < gauges.size(); ++g)
+            {
+                const auto &hit = hits[g];
+                const auto &n = directions[g];
+                // Connectivity is re-read: cohesive insertion may renumber nodes
+                const auto &connectivity = mesh.getConnectivity(hit.element.type, hit.element.ghost_type);
+
+                akantu::Real grad_u[3][3] = {};
+                akantu::Real velocity[3] = {};
+                for (akantu::Int a = 0; a < hit.nb_nodes; ++a)
+                {
+                    const akantu::Idx node = connectivity(hit.element.element, a);
+                    for (akantu::Int i = 0; i < dim; ++i)
+                    {
+                        velocity[i] += hit.weights[a] * v(node, i);
+                        for (akantu::Int j = 0; j < dim; ++j)
+                            grad_u[i][j] += u(node, i) * gradients[g][a][j];
+                    }
+                }
+
+                akantu::Real eps_nn = 0.;
+                for (akantu::Int i = 0; i < dim; ++i)
+                    for (akantu::Int j = 0; j < dim; ++j)
+                        eps_nn += n[i] * 0.5 * (grad_u[i][j] + grad_u[j][i]) * n[j];
+
+                akantu::Real sigma[3][3] = {};
+                stress_of(hit.element, sigma);
+                akantu::Real sigma_nn = 0.;
+                for (akantu::Int i = 0; i < dim; ++i)
+                    for (akantu::Int j = 0; j < dim; ++j)
+                        sigma_nn += n[i] * sigma[i][j] * n[j];
+
+                float *row = values + g * nb_channels;
+                row[strain] = static_cast<float>(eps_nn);
+                row[stress] = static_cast<float>(sigma_nn);
+                row[vx] = static_cast<float>(flips[g][0] * velocity[0]);
+                row[vy] = static_cast<float>(flips[g][1] * velocity[1]);
+                row[vz] = static_cast<float>(flips[g][2] * velocity[2]);
+            }
+
+            pending.insert(pending.end(), record.begin(), record.end());
+            if (pending.size() >= flush_records * record.size())
+                flush();
+        }
+
+        void flush()
+        {
+            if (pending.empty())
+                return;
+            out.write(pending.data(), pending.size());
+            out.flush();
+            bytes += pending.size();
+            pending.clear();
+        }
+
+    private:
+        // Quadrature mean of the element's stress in its material
+        template <class Model>
+        void material_stress(const Model &model, const akantu::Element &element, akantu::Real (&mean)[3][3]) const
+        {
+            const auto &material =
+                model.getMaterial(model.getMaterialByElement(element.type, element.ghost_type)(element.element));
+            const akantu::Idx local = model.getMaterialLocalNumbering(element.type, element.ghost_type)(element.element);
+            const auto &sigma = material.getStress(element.type, element.ghost_type);
+            const auto &filter = material.getElementFilter(element.type, element.ghost_type);
+            const akantu::Int nb_quad = filter.size() ? sigma.size() / filter.size() : 0;
+            for (akantu::Int q = 0; q < nb_quad; ++q)
+                for (akantu::Int i = 0; i < dim; ++i)
+                    for (akantu::Int j = 0; j < dim; ++j)
+                        mean[i][j] += sigma(local * nb_quad + q, i * dim + j) / nb_quad;
+        }
+
+        void write_header()
+        {
+            std::string header("CCPROBE1", 8);
+            auto put = [&](const void *data, std::size_t size)
+            { header.append(static_cast<const char *>(data), size); };
+            const std::uint32_t count = static_cast<std::uint32_t>(gauges.size()), channels = nb_channels;
+            const std::uint64_t size = 24 + gauges.size() * (32 + 6 * sizeof(double));
+            put(&count, sizeof(count));
+            put(&channels, sizeof(channels));
+            put(&size, sizeof(size));
+            for (const auto &g : gauges)
+            {
+                char name[32] = {};
+                std::strncpy(name, g.name.c_str(), sizeof(name) - 1);
+                put(name, sizeof(name));
+                put(g.position.data(), 3 * sizeof(double));
+                put(g.direction.data(), 3 * sizeof(double));
+            }
+            out.write(header.data(), header.size());
+            bytes += header.size();
+        }
+
+        const akantu::Mesh &mesh;
+        std::vector<Gauge> gauges;
+        akantu::Int dim;
+        std::size_t flush_records;
+        std::ofstream out;
+        std::vector<locate::ElementHit> hits;
+        std::vector<std::array<locate::Point, 8>> gradients;
+        std::vector<std::array<akantu::Real, 3>> flips;
+        std::vector<locate::Point> directions; // gauge axes in the model
+        std::vector<char> record, pending;
+        std::uint64_t bytes{0};
+    };
+
+    // A probes.bin read back: values[record][gauge * channels + channel]
+    struct Series
+    {
+        std::vector<Gauge> gauges;
+        std::uint32_t channels{0};
+        std::vector<double> time;
+        std::vector<std::vector<float>> values;
+
+        // Linear interpolation of one gauge channel at t (clamped to the record range)
+        double at(std::size_t gauge, std::size_t channel, double t) const
+        {
+            const std::size_t column = gauge * channels + channel;
+            if (time.empty())
+                return 0.;
+            if (t <= time.front())
+                return values.front()[column];
+            if (t >= time.back())
+                return values.back()[column];
+            const std::size_t k = std::upper_bound(time.begin(), time.end(), t) - time.begin();
+            const double w = (t - time[k - 1]) / (time[k] - time[k - 1]);
+            return (1. - w) * values[k - 1][column] + w * values[k][column];
+        }
+    };
+
+    inline Series read_series(const std::string &path)
+    {
+        std::ifstream in(path, std::ios::binary);
+        char magic[8];
+        if (!in.read(magic, sizeof(magic)) || std::string(magic, sizeof(magic)) != "CCPROBE1")
+            throw std::runtime_error("probe: " + path + " is not a probe series");
+        Series series;
+        std::uint32_t count = 0;
+        std::uint64_t header = 0;
+        in.read(reinterpret_cast<char *>(&count), sizeof(count));
+        in.read(reinterpret_cast<char *>(&series.channels), sizeof(series.channels));
+        in.read(reinterpret_cast<char *>(&header), sizeof(header));
+        for (std::uint32_t g = 0; g < count; ++g)
+        {
+            char name[32];
+            Gauge gauge;
+            in.read(name, sizeof(name));
+            gauge.name.assign(name, strnlen(name, sizeof(name)));
+            in.read(reinterpret_cast<char *>(gauge.position.data()), 3 * sizeof(double));
+            in.read(reinterpret_cast<char *>(gauge.direction.data()), 3 * sizeof(double));
+            series.gauges.push_back(gauge);
+        }
+        if (!in)
+            throw std::runtime_error("probe: truncated header in " + path);
+        in.seekg(header);
+        std::vector<float> row(count * series.channels);
+        double t;
+        // A partial last record (crash) is dropped
+        while (in.read(reinterpret_cast<char *>(&t), sizeof(t)) &&
+               in.read(reinterpret_cast<char *>(row.data()), row.size() * sizeof(float)))
+        {
+            series.time.push_back(t);
+            series.values.push_back(row);
+        }
+        return series;
+    }
+} // namespace probe
+
+#endif
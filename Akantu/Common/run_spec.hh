@@ -0,0 +1,159 @@
+#ifndef RUN_SPEC_HH
+#define RUN_SPEC_HH
+
+#include "aka_common.hh"
+
+#include <map>
+#include <set>
+#include <cmath>
+#include <limits>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <initializer_list>
+
+namespace spec
+{
+    // One `kind name [ key = value ... ]` block of a parameter file, the
+    // syntax of Akantu's material files. Values are kept as text and parsed
+    // on access; vectors are written [a, b, c].
+    struct Block
+    {
+        std::string kind, name;
+        std::map<std::string, std::string> values;
+
+        bool has(const std::string &key) const { return values.count(key) != 0; }
+
+        std::string text(const std::string &key, const std::string &fallback) const
+        {
+            auto it = values.find(key);
+            return it == values.end() ? fallback : it->second;
+        }
+
+        akantu::Real real(const std::string &key, akantu::Real fallback) const
+        {
+            auto it = values.find(key);
+            if (it == values.end())
+                return fallback;
+            std::istringstream in(it->second);
+            akantu::Real v;
+            if (!(in >> v))
+                throw std::runtime_error(where(key) + ": '" + it->second + "' is not a number");
+            return v;
+        }
+
+        // Whole numbers only (4, 1e3); 4.7 is an error, not 4
+        akantu::Int integer(const std::string &key, akantu::Int fallback) const
+        {
+            const akantu::Real v = real(key, static_cast<akantu::Real>(fallback));
+            const akantu::Real largest = static_cast<akantu::Real>(std::numeric_limits<akantu::Int>::max());
+            if (!(std::abs(v) <= largest) || v != std::trunc(v))
+                throw std::runtime_error(where(key) + ": '" + text(key, "") + "' is not a whole number");
+            return static_cast<akantu::Int>(v);
+        }
+
+        std::vector<akantu::Real> reals(const std::string &key) const
+        {
+            auto it = values.find(key);
+            if (it == values.end())
+                return {};
+            std::string cleaned = it->second;
+            for (char &c : cleaned)
+                if (c == '[' || c == ']' || c == ',')
+                    c = ' ';
+            std::istringstream in(cleaned);
+            std::vector<akantu::Real> v;
+            akantu::Real x;
+            while (in >> x)
+                v.push_back(x);
+            if (v.empty())
+                throw std::runtime_error(where(key) + ": bad vector '" + it->second + "'");
+            return v;
+        }
+
+        // List value `a, b c` or `[a, b, c]` as words
+        std::vector<std::string> words(const std::string &key) const
+        {
+            std::string cleaned = text(key, "");
+            for (char &c : cleaned)
+                if (c == '[' || c == ']' || c == ',')
+                    c = ' ';
+            std::istringstream in(cleaned);
+            std::vector<std::string> v;
+            for (std::string w; in >> w;)
+                v.push_back(w);
+            return v;
+        }
+
+        // Throws on any key outside `known`, so typos do not silently fall back to defaults
+        void expect_only(std::initializer_list<const char *> known) const
+        {
+            std::set<std::string> allowed(known.begin(), known.end());
+            for (const auto &entry : values)
+                if (!allowed.count(entry.first))
+                    throw std::runtime_error(where(entry.first) + ": unknown parameter");
+        }
+
+        // Keys of `base` this block does not set itself
+        void inherit(const Block &base)
+        {
+            for (const auto &entry : base.values)
+                values.emplace(entry.first, entry.second);
+        }
+
+        std::string where(const std::string &key) const { return kind + " " + name + ", " + key; }
+    };
+
+    // All blocks of a file in order; '#' starts a comment, the name is optional.
+    inline std::vector<Block> read_blocks(const std::string &path)
+    {
+        std::ifstream in(path);
+        if (!in)
+            throw std::runtime_error("cannot open " + path);
+        std::string text, line;
+        while (std::getline(in, line))
+            text += line.substr(0, line.find('#')) + "\n";
+
+        std::vector<Block> blocks;
+        std::size_t at = 0;
+        for (;;)
+        {
+            const std::size_t open = text.find('[', at);
+            if (open == std::string::npos)
+                break;
+            Block b;
+            std::istringstream head(text.substr(at, open - at));
+            if (!(head >> b.kind))
+                throw std::runtime_error(path + ": block without a kind");
+            head >> b.name;
+            int depth = 1;
+            std::size_t close = open + 1;
+            for (; close < text.size() && depth > 0; ++close)
+                depth += text[close] == '[' ? 1 : text[close] == ']' ? -1 : 0;
+            if (depth != 0)
+                throw std::runtime_error(path + ": unterminated block " + b.kind + " " + b.name);
+
+            std::istringstream body(text.substr(open + 1, close - open - 2));
+            while (std::getline(body, line))
+            {
+                const std::size_t eq = line.find('=');
+                if (eq == std::string::npos)
+                    continue;
+                std::istringstream key_stream(line.substr(0, eq));
+                std::string key;
+                key_stream >> key;
+                std::string value = line.substr(eq + 1);
+                value.erase(0, value.find_first_not_of(" \t"));
+                value.erase(value.find_last_not_of(" \t\r") + 1);
+                b.values[key] = value;
+            }
+            blocks.push_back(b);
+            at = close;
+        }
+        return blocks;
+    }
+} // namespace spec
+
+#endif
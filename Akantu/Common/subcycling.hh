@@ -0,0 +1,384 @@
+#ifndef SUBCYCLING_HH
+#define SUBCYCLING_HH
+
+#include "element_time_step.hh"
+#include "material_elastic.hh"
+
+#include <map>
+#include <array>
+#include <cmath>
+#include <vector>
+#include <string>
+#include <utility>
+#include <typeinfo>
+#include <algorithm>
+#include <stdexcept>
+
+namespace subcycle
+{
+    // Multi-time-step explicit integration (nodal partition, Belytschko et
+    // al. 1979) for linear elastic models. Elements are sorted into levels by
+    // their critical time step: level L advances with h_L = dt / 2^L, where
+    // dt is the coarse step. A node takes the finest level of its elements;
+    // an element is evaluated at the finest level of its nodes, so every
+    // force a node sums was computed at that node's own time. Where a fine
+    // element needs a coarse node between the coarse node's updates, the
+    // node's displacement is interpolated linearly along its half-step
+    // velocity, which is exact for the central difference drift. At every
+    // coarse step all levels meet and the model's displacement and velocity
+    // arrays hold the state of all nodes at the same time.
+    //
+    // The element forces (small-strain isotropic elasticity, full Gauss
+    // quadrature) are computed here, since Akantu assembles all elements of
+    // a material at once; rho, E, nu come from each element's material,
+    // which must be Akantu's small-strain `elastic` (anything else would be
+    // integrated as if it were). Linear tetrahedra and hexahedra are
+    // supported. Lumped masses, blocked DOFs and the external force (held
+    // over the coarse step) are the model's; the first step starts from the
+    // model's acceleration, as solveStep would.
+    class Integrator
+    {
+    public:
+        // Fine steps are at most dt_factor times the element's critical step
+        // and the coarse step at most dt_max, with at most `levels` levels.
+        template <class Model>
+        Integrator(Model &model, const stable::ElementTimeSteps &steps, akantu::Real dt_factor, akantu::Real dt_max,
+                   akantu::Int levels)
+            : u(model.getDisplacement()), v(model.getVelocity()), model_acceleration(model.getAcceleration()),
+              f_ext(model.getExternalForce()), blocked(model.getBlockedDOFs()), mass(model.getMass())
+        {
+            const auto &mesh = model.getMesh();
+            if (mesh.getSpatialDimension() != 3)
+                throw std::runtime_error("subcycling: 3-D meshes only");
+            const auto &nodes = mesh.getNodes();
+            const akantu::Int nb_nodes = nodes.size();
+            levels = std::max<akantu::Int>(1, levels);
+
+            // Coarse step: the largest the elements allow within dt_max and `levels`
+            const akantu::Real fine = dt_factor * steps.min();
+            coarse = std::min({dt_max, dt_factor * steps.max(), fine * std::pow(2., levels - 1)});
+            if (!(coarse > 0.))
+                throw std::runtime_error("subcycling: no positive time step");
+
+            std::vector<int> element_level(steps.dt.size());
+            for (std::size_t k = 0; k < steps.dt.size(); ++k)
+            {
+                const akantu::Real ratio = coarse / (dt_factor * steps.dt[k]);
+                element_level[k] = ratio > 1. ? static_cast<int>(std::ceil(std::log2(ratio) - 1e-9)) : 0;
+                finest = std::max(finest, element_level[k]);
+            }
+
+            node_level.assign(nb_nodes, 0);
+            std::vector<Element> all;
+            std::map<akantu::Idx, std::pair<akantu::Real, akantu::Real>> lame;
+            for (std::size_t k = 0; k < steps.elements.size(); ++k)
+            {
+                const auto &element = steps.elements[k];
+                const auto &connectivity = mesh.getConnectivity(element.type, element.ghost_type);
+                const locate::Shape shape = locate::Shape::of(element.type);
+                if (shape.dim != 3 || (element.type != akantu::_tetrahedron_4 && element.type != akantu::_hexahedron_8))
+                    throw std::runtime_error("subcycling: only linear tetrahedra and hexahedra are supported");
+                Element el;
+                el.type = element.type;
+                el.element = element.element;
+                el.nb_nodes = shape.nb_nodes;
+                for (akantu::Int a = 0; a < el.nb_nodes; ++a)
+                {
+                    el.nodes[a] = connectivity(element.element, a);
+                    node_level[el.nodes[a]] = std::max(node_level[el.nodes[a]], element_level[k]);
+                }
+                const akantu::Idx m = model.getMaterialByElement(element.type, element.ghost_type)(element.element);
+                auto it = lame.find(m);
+                if (it == lame.end())
+                {
+                    // Exactly the linear elastic law: plastic and damage
+                    // materials derive from MaterialElastic as well
+                    const auto &material = model.getMaterial(m);
+                    if (typeid(material) != typeid(akantu::MaterialElastic<3>) || material.isFiniteDeformation())
+                        throw std::runtime_error("subcycling: material " + material.getName() +
+                                                 " is not a small-strain elastic material");
+                    const akantu::Real E = material.get("E");
+                    const akantu::Real nu = material.get("nu");
+                    it = lame.emplace(m, std::make_pair(E * nu / ((1. + nu) * (1. - 2. * nu)), E / (2. * (1. + nu)))).first;
+                }
+                el.lambda = it->second.first;
+                el.mu = it->second.second;
+                for (akantu::Int a = 0; a < el.nb_nodes; ++a)
+                    for (int d = 0; d < 3; ++d)
+                        el.x[a][d] = nodes(el.nodes[a], d);
+                all.push_back(el);
+            }
+
+            // Elements run at the finest level among their nodes
+            by_level.resize(finest + 1);
+            nodes_by_level.resize(finest + 1);
+            touched_by_level.resize(finest + 1);
+            std::vector<int> touched(nb_nodes, -1);
+            for (auto &el : all)
+            {
+                int level = 0;
+                for (akantu::Int a = 0; a < el.nb_nodes; ++a)
+                    level = std::max(level, node_level[el.nodes[a]]);
+                element_index[{el.type, el.element}] = {level, by_level[level].size()};
+                by_level[level].push_back(el);
+            }
+            for (akantu::Int n = 0; n < nb_nodes; ++n)
+                nodes_by_level[node_level[n]].push_back(n);
+            for (int level = 0; level <= finest; ++level)
+                for (const auto &el : by_level[level])
+                    for (akantu::Int a = 0; a < el.nb_nodes; ++a)
+                        if (touched[el.nodes[a]] != level)
+                        {
+                            touched[el.nodes[a]] = level;
+                            touched_by_level[level].push_back(el.nodes[a]);
+                        }
+
+            force = akantu::Array<akantu::Real>(nb_nodes, 3);
+            acceleration = akantu::Array<akantu::Real>(nb_nodes, 3);
+            start = akantu::Array<akantu::Real>(nb_nodes, 3);
+            node_time.assign(nb_nodes, 0.);
+        }
+
+        akantu::Real coarse_step() const { return coarse; }
+        akantu::Real fine_step() const { return coarse / std::pow(2., finest); }
+        int nb_levels() const { return finest + 1; }
+        std::size_t nb_nodes(int level) const { return nodes_by_level[level].size(); }
+        std::size_t nb_elements(int level) const { return by_level[level].size(); }
+
+        // Element evaluations per coarse step, and as a fraction of advancing
+        // every element with the fine step
+        double evaluations() const
+        {
+            double total = 0.;
+            for (int level = 0; level <= finest; ++level)
+                total += std::pow(2., level) * by_level[level].size();
+            return total;
+        }
+        double work_ratio() const
+        {
+            double elements = 0.;
+            for (const auto &list : by_level)
+                elements += list.size();
+            return elements > 0. ? evaluations() / (elements * std::pow(2., finest)) : 1.;
+        }
+
+        // Advances every node by one coarse step
+        void step()
+        {
+            const int substeps = 1 << finest;
+            const akantu::Real delta = fine_step();
+            if (!initialised)
+            {
+                for (akantu::Idx n = 0; n < static_cast<akantu::Idx>(node_level.size()); ++n)
+                    for (int i = 0; i < 3; ++i)
+                        acceleration(n, i) = blocked(n, i) ? 0. : model_acceleration(n, i);
+                initialised = true;
+            }
+
+            for (int s = 0; s < substeps; ++s)
+            {
+                const akantu::Real now = s * delta;
+                // Levels starting a step: half kick, then drift along v_{n+1/2}
+                for (int level = 0; level <= finest; ++level)
+                {
+                    if (s % (substeps >> level) != 0)
+                        continue;
+                    const akantu::Real h = coarse / (1 << level);
+                    for (auto n : nodes_by_level[level])
+                    {
+                        for (int i = 0; i < 3; ++i)
+                        {
+                            if (!blocked(n, i))
+                                v(n, i) += 0.5 * h * acceleration(n, i);
+                            start(n, i) = u(n, i);
+                        }
+                        node_time[n] = now;
+                    }
+                }
+
+                // Forces at the end of this substep for every level that ends there
+                const akantu::Real next = now + delta;
+                int lowest = finest;
+                while (lowest > 0 && (s + 1) % (substeps >> (lowest - 1)) == 0)
+                    --lowest;
+                evaluate_from(lowest, next);
+
+                // Levels ending here: close the drift and kick with the new forces
+                for (int level = lowest; level <= finest; ++level)
+                {
+                    const akantu::Real h = coarse / (1 << level);
+                    for (auto n : nodes_by_level[level])
+                    {
+                        for (int i = 0; i < 3; ++i)
+                            if (!blocked(n, i))
+                                u(n, i) = start(n, i) + h * v(n, i);
+                        accelerate(n);
+                        for (int i = 0; i < 3; ++i)
+                            if (!blocked(n, i))
+                                v(n, i) += 0.5 * h * acceleration(n, i);
+                    }
+                }
+            }
+            for (akantu::Idx n = 0; n < static_cast<akantu::Idx>(node_level.size()); ++n)
+                for (int i = 0; i < 3; ++i)
+                    model_acceleration(n, i) = acceleration(n, i);
+        }
+
+        // Quadrature mean of the stress of a regular element at the end of
+        // the last coarse step, without going through Akantu's materials
+        void stress(const akantu::Element &element, akantu::Real (&sigma)[3][3]) const
+        {
+            const auto found = element_index.find({element.type, element.element});
+            if (found == element_index.end() || element.ghost_type != akantu::_not_ghost)
+                throw std::runtime_error("subcycling: element is not integrated here");
+            const Element &el = by_level[found->second.first][found->second.second];
+            akantu::Real ue[8][3];
+            for (akantu::Int k = 0; k < el.nb_nodes; ++k)
+                for (int i = 0; i < 3; ++i)
+                    ue[k][i] = u(el.nodes[k], i);
+            for (auto &row : sigma)
+                for (auto &s : row)
+                    s = 0.;
+            int nb_quad = 0;
+            at_quadrature(el, ue,
+                          [&](const akantu::Real(&)[8][3], const akantu::Real(&s)[3][3], akantu::Real)
+                          {
+                              for (int i = 0; i < 3; ++i)
+                                  for (int j = 0; j < 3; ++j)
+                                      sigma[i][j] += s[i][j];
+                              ++nb_quad;
+                          });
+            for (auto &row : sigma)
+                for (auto &s : row)
+                    s /= nb_quad;
+        }
+
+    private:
+        struct Element
+        {
+            akantu::ElementType type;
+            akantu::Idx element;
+            akantu::Int nb_nodes;
+            std::array<akantu::Idx, 8> nodes;
+            std::array<locate::Point, 8> x;
+            akantu::Real lambda, mu;
+        };
+
+        void accelerate(akantu::Idx n)
+        {
+            for (int i = 0; i < 3; ++i)
+                acceleration(n, i) = blocked(n, i) || mass(n, i) == 0. ? 0. : (f_ext(n, i) + force(n, i)) / mass(n, i);
+        }
+
+        // Internal forces of all elements at level >= `lowest`, at time `t`
+        // into the coarse step; the nodes they touch are cleared first
+        void evaluate_from(int lowest, akantu::Real t)
+        {
+            for (int level = lowest; level <= finest; ++level)
+                for (auto n : touched_by_level[level])
+                    for (int i = 0; i < 3; ++i)
+                        force(n, i) = 0.;
+            for (int level = lowest; level <= finest; ++level)
+                for (const auto &el : by_level[level])
+                    internal_force(el, t);
+        }
+
+        // Displacement of node n at time t of the current coarse step
+        akantu::Real displacement(akantu::Idx n, int i, akantu::Real t) const
+        {
+            return initialised ? start(n, i) + (t - node_time[n]) * (blocked(n, i) ? 0. : v(n, i)) : u(n, i);
+        }
+
+        void internal_force(const Element &el, akantu::Real t)
+        {
+            akantu::Real ue[8][3];
+            for (akantu::Int k = 0; k < el.nb_nodes; ++k)
+                for (int i = 0; i < 3; ++i)
+                    ue[k][i] = displacement(el.nodes[k], i, t);
+
+            akantu::Real fe[8][3] = {};
+            at_quadrature(el, ue,
+                          [&](const akantu::Real(&B)[8][3], const akantu::Real(&sigma)[3][3], akantu::Real w)
+                          {
+                              for (akantu::Int k = 0; k < el.nb_nodes; ++k)
+                                  for (int i = 0; i < 3; ++i)
+                                      fe[k][i] -= w * (sigma[i][0] * B[k][0] + sigma[i][1] * B[k][1] + sigma[i][2] * B[k][2]);
+                          });
+            for (akantu::Int k = 0; k < el.nb_nodes; ++k)
+                for (int i = 0; i < 3; ++i)
+                    force(el.nodes[k], i) += fe[k][i];
+        }
+
+        // Calls visit(B, sigma, weight * |det J|) at every Gauss point of the
+        // element with nodal displacements ue, B[a][k] = dN_a / dx_k
+        template <class Visit>
+        static void at_quadrature(const Element &el, const akantu::Real (&ue)[8][3], Visit &&visit)
+        {
+            const locate::Shape shape = locate::Shape::of(el.type);
+            const bool hex = el.type == akantu::_hexahedron_8;
+            const int nb_quad = hex ? 8 : 1;
+            const akantu::Real g = 1. / std::sqrt(3.);
+
+            std::array<locate::Point, 8> dN;
+            for (int q = 0; q < nb_quad; ++q)
+            {
+                const locate::Point xi = hex ? locate::Point{q & 1 ? g : -g, q & 2 ? g : -g, q & 4 ? g : -g}
+                                             : locate::Point{0.25, 0.25, 0.25};
+                const akantu::Real weight = hex ? 1. : 1. / 6.;
+                shape.derivatives(xi, dN);
+
+                // J[i][j] = dx_i / dxi_j and its inverse
+                akantu::Real J[3][3] = {};
+                for (akantu::Int a = 0; a < el.nb_nodes; ++a)
+                    for (int i = 0; i < 3; ++i)
+                        for (int j = 0; j < 3; ++j)
+                            J[i][j] += el.x[a][i] * dN[a][j];
+                const akantu::Real det = J[0][0] * (J[1][1] * J[2][2] - J[1][2] * J[2][1]) -
+                                         J[0][1] * (J[1][0] * J[2][2] - J[1][2] * J[2][0]) +
+                                         J[0][2] * (J[1][0] * J[2][1] - J[1][1] * J[2][0]);
+                akantu::Real inv[3][3];
+                for (int i = 0; i < 3; ++i)
+                    for (int j = 0; j < 3; ++j)
+                    {
+                        const int i1 = (j + 1) % 3, i2 = (j + 2) % 3, j1 = (i + 1) % 3, j2 = (i + 2) % 3;
+                        inv[i][j] = (J[i1][j1] * J[i2][j2] - J[i1][j2] * J[i2][j1]) / det;
+                    }
+
+                // dN_a/dx_k = dN_a/dxi_j inv[j][k]; grad u; stress
+                akantu::Real B[8][3];
+                akantu::Real grad[3][3] = {};
+                for (akantu::Int a = 0; a < el.nb_nodes; ++a)
+                    for (int k = 0; k < 3; ++k)
+                    {
+                        B[a][k] = dN[a][0] * inv[0][k] + dN[a][1] * inv[1][k] + dN[a][2] * inv[2][k];
+                        for (int i = 0; i < 3; ++i)
+                            grad[i][k] += ue[a][i] * B[a][k];
+                    }
+                const akantu::Real trace = grad[0][0] + grad[1][1] + grad[2][2];
+                akantu::Real sigma[3][3];
+                for (int i = 0; i < 3; ++i)
+                    for (int j = 0; j < 3; ++j)
+                        sigma[i][j] = el.mu * (grad[i][j] + grad[j][i]) + (i == j ? el.lambda * trace : 0.);
+
+                visit(B, sigma, weight * std::abs(det));
+            }
+        }
+
+        akantu::Array<akantu::Real> &u, &v, &model_acceleration;
+        const akantu::Array<akantu::Real> &f_ext;
+        const akantu::Array<bool> &blocked;
+        const akantu::Array<akantu::Real> &mass;
+
+        akantu::Real coarse{0.};
+        int finest{0};
+        bool initialised{false};
+        std::vector<int> node_level;
+        std::vector<std::vector<Element>> by_level;
+        std::map<std::pair<akantu::ElementType, akantu::Idx>, std::pair<int, std::size_t>> element_index; // -> by_level
+        std::vector<std::vector<akantu::Idx>> nodes_by_level, touched_by_level;
+        akantu::Array<akantu::Real> force, acceleration, start;
+        std::vector<akantu::Real> node_time;
+    };
+} // namespace subcycle
+
+#endif
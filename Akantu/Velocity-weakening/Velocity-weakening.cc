@@ -1,9 +1,21 @@
 #include "solid_mechanics_model_cohesive.hh"
 #include "mesh.hh"
 #include "aka_common.hh"
+#include "probes.hh"
+#include "phase_timer.hh"
+#include "absorbing_boundary.hh"
+#include "element_time_step.hh"
 #include <iostream>
 #include <iomanip>
 #include <chrono>
+#include <memory>
+#include <filesystem>
+#include <cstdlib>
+#include <sstream>
+#include <algorithm>
+#include <vector>
+#include <string>
+#include <map>
 
 
 int main(int argc, char *argv[])
@@ -14,7 +26,18 @@ int main(int argc, char *argv[])
     const std::string mesh_file = "../../../Models/100mm-PMMA-CZM.msh";
     const std::string mat_file = "../../../Materials/material-mm-MPa.dat";
 
-    akantu::initialize(mat_file, argc, argv);
+    // --dt-report: only report which elements limit dt (see element_time_step.hh)
+    std::vector<char *> args;
+    bool dt_report = false;
+    for (int k = 0; k < argc; ++k)
+        if (std::string(argv[k]) == "--dt-report")
+            dt_report = true;
+        else
+            args.push_back(argv[k]);
+    int nb_args = static_cast<int>(args.size());
+    char **akantu_argv = args.data();
+
+    akantu::initialize(mat_file, nb_args, akantu_argv);
     std::cout << "Initialized" << std::endl;
     akantu::Mesh mesh(sd);
     mesh.read(mesh_file);
@@ -52,6 +75,16 @@ int main(int argc, char *argv[])
     model.setTimeStep(dt);
     std::cout << "dt = " << dt << " s (" << dt / us << " us)\n";
 
+    if (dt_report)
+    {
+        const auto steps = stable::ElementTimeSteps::of(model);
+        stable::report(std::cout, mesh, steps, 0.5);
+        stable::dump_fields(mesh, steps, "paraview", "dt-report");
+        std::cout << "critical_dt / dt_over_min fields: paraview/dt-report.pvd" << std::endl;
+        akantu::finalize();
+        return 0;
+    }
+
     model.setBaseName("50mm-PMMA-CZM-velocity-weakening");
     model.assembleMassLumped();
     model.addDumpFieldVector("displacement");
@@ -83,19 +116,92 @@ int main(int argc, char *argv[])
 
     std::cout << "set B.C. successful." << std::endl;
 
+    // Absorbing surfaces (optional): ABSORBING="stationary-block-front, ..." puts
+    // Lysmer dashpots on those physical surfaces, on top of the tractions above
+    absorb::LysmerBoundary boundary(mesh);
+    if (const char *absorbing = std::getenv("ABSORBING"))
+    {
+        std::string list(absorbing);
+        std::replace(list.begin(), list.end(), ',', ' ');
+        std::istringstream surfaces(list);
+        for (std::string surface; surfaces >> surface;)
+            boundary.add(model, surface);
+        std::cout << "Absorbing boundary: " << boundary.area() << " mm^2 (" << list << ")" << std::endl;
+    }
+
+    // Virtual strain gauges (optional): ../probes.dat -> probes.bin, sampled every step
+    std::unique_ptr<probe::ProbeRecorder> probes;
+    if (std::filesystem::exists("../probes.dat"))
+    {
+        probes = std::make_unique<probe::ProbeRecorder>(mesh, probe::read_config("../probes.dat"), "probes.bin");
+        std::cout << probes->gauge_list().size() << " probes from ../probes.dat" << std::endl;
+    }
+
     const akantu::Real SIMULATION_TIME = 20.0 * ms;           // 20 ms = 0.02 s
     const akantu::Int max_steps = ceil(SIMULATION_TIME / dt); // total number of time steps
     std::cout << "Starting time integration for " << (SIMULATION_TIME / ms) << " ms (" << max_steps << " steps)\n";
     
+    // Per-phase timing; PHASE_TRACE=<file> also writes a Chrome trace
+    const char *trace_env = std::getenv("PHASE_TRACE");
+    timing::PhaseTimer timer(trace_env ? trace_env : "");
+    const int ph_check = timer.phase("checkCohesiveStress");
+    const int ph_absorb = boundary.size() ? timer.phase("absorbing boundary") : -1;
+    const int ph_solve = timer.phase("solveStep");
+    const int ph_probes = timer.phase("probes");
+    const int ph_dump = timer.phase("dump");
+    const int ph_output = timer.phase("console output");
+    const int ct_inserted = timer.counter("cohesive insertions");
+    const int ct_bytes = timer.counter("bytes written");
+    auto nb_cohesive = [&]() { return mesh.getNbElement(sd, akantu::_not_ghost, akantu::_ek_cohesive); };
+    const akantu::Int cohesive_at_start = nb_cohesive();
+
+    // Dumps go through Akantu's ParaView dumper, which does not report what it
+    // writes: list paraview/ before and after the run and count the files that
+    // are new or changed, so leftovers of earlier runs are not counted
+    struct Listed
+    {
+        std::uintmax_t size;
+        std::filesystem::file_time_type modified;
+    };
+    auto list_dumps = []()
+    {
+        std::map<std::string, Listed> files;
+        std::error_code error;
+        if (std::filesystem::is_directory("paraview", error))
+            for (const auto &entry : std::filesystem::recursive_directory_iterator("paraview", error))
+                if (entry.is_regular_file(error))
+                    files[entry.path().string()] = {entry.file_size(error), entry.last_write_time(error)};
+        return files;
+    };
+    const auto dumps_before = list_dumps();
+
     auto start_time = std::chrono::high_resolution_clock::now();
 
     for (akantu::Int s = 0; s < max_steps; ++s)
     {
-        model.checkCohesiveStress();
-        model.solveStep();
+        {
+            auto scope = timer.time(ph_check);
+            model.checkCohesiveStress();
+        }
+        if (boundary.size())
+        {
+            auto scope = timer.time(ph_absorb);
+            boundary.update(vel, model.getExternalForce());
+        }
+        {
+            auto scope = timer.time(ph_solve);
+            model.solveStep();
+        }
+        if (probes)
+        {
+            auto scope = timer.time(ph_probes);
+            probes->sample(model, (s + 1) * dt);
+        }
         if (s % 5 == 0) {
+            auto scope = timer.time(ph_dump);
             model.dump();
         }
+        auto scope = timer.time(ph_output);
         auto current_time = std::chrono::high_resolution_clock::now();
         std::chrono::duration<double> elapsed = current_time - start_time;
 
@@ -112,6 +218,23 @@ int main(int argc, char *argv[])
     std::chrono::duration<double> total_elapsed = end_time - start_time;
     std::cout << "Total elapsed time: " << total_elapsed.count() << " s" << std::endl;
 
+    std::uintmax_t dumped = 0;
+    for (const auto &[path, file] : list_dumps())
+    {
+        const auto before = dumps_before.find(path);
+        if (before == dumps_before.end() || before->second.size != file.size || before->second.modified != file.modified)
+            dumped += file.size;
+    }
+    if (probes)
+    {
+        probes->flush();
+        dumped += probes->bytes_written();
+    }
+    timer.set(ct_inserted, nb_cohesive() - cohesive_at_start);
+    timer.set(ct_bytes, dumped);
+    timer.report(std::cout);
+    timer.write_trace();
+
     akantu::finalize();
     return 0;
 }
\ No newline at end of file
@@ -4,9 +4,18 @@ import Functions
 def main():
 
     PMMA_THICKNESSES = [20]
+    # Plate side lengths (mm), centred on the load point at (150, 150). 300 is the
+    # full plate; smaller domains are meant for absorbing sides
+    # (`absorbing = Sample-back, ...` in Akantu/Ball-Drop/run.dat).
+    DOMAIN_SIZES = [300]
+    # "full", "half" (x <= 150) or "quarter" (x, y <= 150): the drop at the centre
+    # with corner supports is symmetric about x = 150 and y = 150. The cut faces
+    # become the physical groups symmetry-x / symmetry-y, which Ball-Drop.cc
+    # constrains and uses to scale the load and mirror the probes.
+    SYMMETRY = "full"
     mesh_size = 1.0
 
-    for PMMA_thickness in PMMA_THICKNESSES:
+    for PMMA_thickness, domain_size in [(t, d) for t in PMMA_THICKNESSES for d in DOMAIN_SIZES]:
 
         gmsh.initialize()
         gmsh.option.setNumber("Mesh.MshFileVersion", 2.2)
@@ -19,15 +28,27 @@ def main():
 
         gmsh.model.add("ContactModel")
 
-        Sample = Functions.create_block(origin=(0, 0, 0), dimensions=(300, 300, PMMA_thickness), mesh_size=mesh_size, block_name="Sample", tag_prefix=1)
+        origin = (150 - domain_size / 2, 150 - domain_size / 2, 0)
+        dimensions = [domain_size, domain_size, PMMA_thickness]
+        face_names = {}
+        if SYMMETRY in ("half", "quarter"):
+            dimensions[0] = domain_size / 2
+            face_names["front"] = "symmetry-x"
+        if SYMMETRY == "quarter":
+            dimensions[1] = domain_size / 2
+            face_names["left"] = "symmetry-y"
+        Sample = Functions.create_block(origin=origin, dimensions=tuple(dimensions), mesh_size=mesh_size, block_name="Sample", tag_prefix=1, face_names=face_names)
         
 
 
         gmsh.model.occ.synchronize()
 
         gmsh.model.mesh.generate(3)
-        gmsh.write(f"../Models/Ball-Drop.msh")
-        gmsh.write(f"../Models/Ball-Drop.brep")
+        name = "Ball-Drop" if domain_size == 300 else f"Ball-Drop-{domain_size:g}mm"
+        if SYMMETRY != "full":
+            name += f"-{SYMMETRY}"
+        gmsh.write(f"../Models/{name}.msh")
+        gmsh.write(f"../Models/{name}.brep")
         gmsh.fltk.run()
         gmsh.finalize()
 
@@ -1,6 +1,8 @@
 import gmsh
 
-def create_block(origin, dimensions, mesh_size, block_name, tag_prefix=1):
+def create_block(origin, dimensions, mesh_size, block_name, tag_prefix=1, face_names=None):
+    # face_names renames face groups, e.g. {"front": "symmetry-x"} for a symmetry plane
+    face_names = face_names or {}
     x, y, z = origin
     dx, dy, dz = dimensions
     box = gmsh.model.occ.addBox(x, y, z, dx, dy, dz)
@@ -30,26 +32,27 @@ def create_block(origin, dimensions, mesh_size, block_name, tag_prefix=1):
         com = gmsh.model.occ.getCenterOfMass(dim, tag)
 
         if abs(com[0] - x) < tolerance:
-            name = f"{block_name}-back"
+            side = "back"
             tag_val = tag_prefix * 10 + 4
         elif abs(com[0] - (x + dx)) < tolerance:
-            name = f"{block_name}-front"
+            side = "front"
             tag_val = tag_prefix * 10 + 5
         elif abs(com[1] - y) < tolerance:
-            name = f"{block_name}-right"
+            side = "right"
             tag_val = tag_prefix * 10 + 6
         elif abs(com[1] - (y + dy)) < tolerance:
-            name = f"{block_name}-left"
+            side = "left"
             tag_val = tag_prefix * 10 + 7
         elif abs(com[2] - z) < tolerance:
-            name = f"{block_name}-bottom"
+            side = "bottom"
             tag_val = tag_prefix * 10 + 2
         elif abs(com[2] - (z + dz)) < tolerance:
-            name = f"{block_name}-top"
+            side = "top"
             tag_val = tag_prefix * 10 + 3
         else:
             continue
 
+        name = face_names.get(side, f"{block_name}-{side}")
         gmsh.model.addPhysicalGroup(2, [tag], tag=tag_val)
         gmsh.model.setPhysicalName(2, tag_val, name)
         face_tags[name] = tag
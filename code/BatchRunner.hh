@@ -0,0 +1,459 @@
+#ifndef BATCH_RUNNER_HH
+#define BATCH_RUNNER_HH
+
+#include "ExperimentStore.hh"
+#include "EventPicker.hh"
+#include "IIRFilter.hh"
+#include "Fitter.hh"
+#include "TemplateBank.hh"
+#include "TemplateIndex.hh"
+#include "WorkStealingPool.hh"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <cstdio>
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+#include <stdexcept>
+
+// One pipeline for every file of a campaign: load -> scale -> filter -> pick -> fit.
+struct CampaignSettings {
+    std::vector<double> factors;            // per-channel scale (StrainConverter factors); empty: none
+    SecondOrderSections filter;             // zero-phase; no sections: unfiltered
+    PickerSettings picker;
+    std::string member;                     // .npz member; empty for .npy and .ccs
+    int time_axis = -1;
+    std::size_t memory_budget = std::size_t(4) << 30;  // bytes of records held at once
+    unsigned threads = 0;
+
+    const TemplateIndex* index = nullptr;   // with bank: fit every pick
+    const TemplateBank* bank = nullptr;
+    std::size_t neighbours = 3;
+    std::ptrdiff_t fit_offset = 0;          // tip passage relative to the picked onset, samples
+    double min_snr = 0.0;                   // weaker picks are reported but not fitted
+
+    std::string checkpoint;                 // empty: no checkpoint
+    std::string fingerprint;                // extra text that invalidates the checkpoint when changed
+};
+
+struct EventRow {
+    std::size_t file;
+    Pick pick;
+    bool fitted;
+    FitResult fit;
+    double y;
+};
+
+struct FileSummary {
+    std::string path;
+    std::string status;                     // "ok" or the error message
+    std::size_t channels = 0;
+    std::size_t samples = 0;
+    std::size_t events = 0;
+    double seconds = 0.0;
+    bool resumed = false;                   // taken from the checkpoint
+};
+
+struct CampaignResult {
+    std::vector<FileSummary> files;
+    std::vector<EventRow> events;           // ordered by file, then trigger
+};
+
+// Counting semaphore over bytes. A request larger than the whole budget is
+// granted once nothing else is held, so one oversized file still runs.
+class MemoryBudget {
+private:
+    std::mutex mutex;
+    std::condition_variable released;
+    std::size_t budget;
+    std::size_t held = 0;
+
+public:
+    explicit MemoryBudget(std::size_t budget) : budget(std::max<std::size_t>(budget, 1)) {}
+
+    std::size_t acquire(std::size_t bytes) {
+        bytes = std::min(bytes, budget);
+        std::unique_lock<std::mutex> lock(mutex);
+        released.wait(lock, [&] { return held + bytes <= budget; });
+        held += bytes;
+        return bytes;
+    }
+
+    void release(std::size_t bytes) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            held -= bytes;
+        }
+        released.notify_all();
+    }
+};
+
+// Append-only TSV log of finished files. Each file is written as its event
+// lines followed by a "file" line in a single write, so an interrupted run
+// leaves at most one torn block at the end, which is cut off on resume. The
+// header holds a hash of the settings; a different hash starts over.
+//
+//   campaign <hash>
+//   event <path> <channel> <trigger> <onset> <end> <method> <ratio> <amplitude> <snr> <aic>
+//         <fitted> <C_f> <X_c> <Gamma> <y> <shift> <chi2>
+//   file <path> <status> <channels> <samples> <events> <seconds>
+class CampaignCheckpoint {
+private:
+    int fd = -1;
+    std::mutex mutex;
+
+    static std::vector<std::string> split(const std::string& line) {
+        std::vector<std::string> fields;
+        std::size_t start = 0;
+        for (;;) {
+            std::size_t tab = line.find('\t', start);
+            fields.push_back(line.substr(start, tab == std::string::npos ? std::string::npos : tab - start));
+            if (tab == std::string::npos)
+                return fields;
+            start = tab + 1;
+        }
+    }
+
+public:
+    static std::string number(double v) {
+        char buffer[32];
+        std::snprintf(buffer, sizeof(buffer), "%.17g", v);
+        return buffer;
+    }
+
+    static std::string event_line(const std::string& path, const EventRow& e) {
+        const Pick& p = e.pick;
+        std::ostringstream line;
+        line << "event\t" << path << '\t' << p.channel << '\t' << p.trigger << '\t' << p.onset << '\t' << p.end
+             << '\t' << static_cast<int>(p.method) << '\t' << number(p.ratio) << '\t' << number(p.amplitude) << '\t'
+             << number(p.snr) << '\t' << number(p.aic_contrast) << '\t' << (e.fitted ? 1 : 0) << '\t'
+             << number(e.fit.C_f) << '\t' << number(e.fit.X_c) << '\t' << number(e.fit.Gamma) << '\t' << number(e.y)
+             << '\t' << number(e.fit.shift) << '\t' << number(e.fit.chi2) << '\n';
+        return line.str();
+    }
+
+    // Opens (or starts) the log and returns the files it already holds.
+    // Only files that finished with status "ok" count as done.
+    CampaignResult open(const std::string& path, const std::string& hash) {
+        CampaignResult done;
+        std::string text;
+        {
+            std::ifstream in(path, std::ios::binary);
+            text.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+        }
+        std::size_t committed = 0;
+        bool valid = text.compare(0, 9 + hash.size() + 1, "campaign\t" + hash + "\n") == 0;
+        if (valid) {
+            committed = 9 + hash.size() + 1;
+            std::vector<EventRow> block;
+            std::size_t at = committed;
+            for (std::size_t eol; (eol = text.find('\n', at)) != std::string::npos; at = eol + 1) {
+                // A line that does not parse is the start of a torn block, like
+                // an unterminated one
+                try {
+                    auto f = split(text.substr(at, eol - at));
+                    if (f[0] == "event" && f.size() == 18) {
+                        EventRow e{};
+                        e.pick = {std::stoul(f[2]), std::stoul(f[3]), std::stoul(f[4]), std::stoul(f[5]),
+                                  static_cast<PickMethod>(std::stoi(f[6])), std::stod(f[7]), std::stod(f[8]),
+                                  std::stod(f[9]), std::stod(f[10])};
+                        e.fitted = f[11] == "1";
+                        e.fit.C_f = std::stod(f[12]);
+                        e.fit.X_c = std::stod(f[13]);
+                        e.fit.Gamma = std::stod(f[14]);
+                        e.y = std::stod(f[15]);
+                        e.fit.shift = std::stod(f[16]);
+                        e.fit.chi2 = std::stod(f[17]);
+                        block.push_back(e);
+                    } else if (f[0] == "file" && f.size() == 7) {
+                        if (f[2] == "ok") {
+                            FileSummary s;
+                            s.path = f[1];
+                            s.status = f[2];
+                            s.channels = std::stoul(f[3]);
+                            s.samples = std::stoul(f[4]);
+                            s.events = std::stoul(f[5]);
+                            s.seconds = std::stod(f[6]);
+                            s.resumed = true;
+                            for (auto& e : block)
+                                e.file = done.files.size();
+                            done.events.insert(done.events.end(), block.begin(), block.end());
+                            done.files.push_back(s);
+                        }
+                        committed = eol + 1;
+                        block.clear();
+                    } else {
+                        break;
+                    }
+                } catch (const std::logic_error&) {
+                    break;
+                }
+            }
+        }
+
+        fd = ::open(path.c_str(), O_WRONLY | O_CREAT, 0644);
+        if (fd < 0)
+            throw std::runtime_error("cannot open checkpoint " + path);
+        if (!valid) {
+            done = CampaignResult{};
+            std::string header = "campaign\t" + hash + "\n";
+            if (::ftruncate(fd, 0) != 0)
+                throw std::runtime_error("cannot truncate checkpoint " + path);
+            FileIO::write_all(fd, header.data(), header.size(), 0);
+            committed = header.size();
+        } else if (::ftruncate(fd, static_cast<off_t>(committed)) != 0) {
+            throw std::runtime_error("cannot truncate checkpoint " + path);
+        }
+        ::lseek(fd, static_cast<off_t>(committed), SEEK_SET);
+        return done;
+    }
+
+    void commit(const FileSummary& file, const std::vector<EventRow>& events) {
+        if (fd < 0)
+            return;
+        std::string block;
+        for (const EventRow& e : events)
+            block += event_line(file.path, e);
+        std::string status = file.status;
+        std::replace(status.begin(), status.end(), '\t', ' ');
+        std::replace(status.begin(), status.end(), '\n', ' ');
+        block += "file\t" + file.path + '\t' + status + '\t' + std::to_string(file.channels) + '\t' +
+                 std::to_string(file.samples) + '\t' + std::to_string(file.events) + '\t' + number(file.seconds) +
+                 '\n';
+        std::lock_guard<std::mutex> lock(mutex);
+        for (std::size_t done = 0; done < block.size();) {
+            ssize_t n = ::write(fd, block.data() + done, block.size() - done);
+            if (n <= 0)
+                throw std::runtime_error("checkpoint write failed");
+            done += static_cast<std::size_t>(n);
+        }
+        ::fsync(fd);
+    }
+
+    ~CampaignCheckpoint() {
+        if (fd >= 0)
+            ::close(fd);
+    }
+};
+
+// Hash (FNV-1a) of everything that changes the results, for the checkpoint header.
+inline std::string campaign_hash(const CampaignSettings& s) {
+    std::string text = s.fingerprint + '|' + s.member + '|' + std::to_string(s.time_axis);
+    for (double f : s.factors)
+        text += '|' + CampaignCheckpoint::number(f);
+    for (const Biquad& b : s.filter.sections)
+        for (double c : {b.b0, b.b1, b.b2, b.a1, b.a2})
+            text += '|' + CampaignCheckpoint::number(c);
+    const PickerSettings& p = s.picker;
+    text += '|' + std::to_string(p.sta) + '|' + std::to_string(p.lta) + '|' + CampaignCheckpoint::number(p.on) + '|' +
+            CampaignCheckpoint::number(p.off) + '|' + CampaignCheckpoint::number(p.derivative) + '|' +
+            std::to_string(p.pre) + '|' + std::to_string(p.post) + '|' + std::to_string(p.dead_time);
+    if (s.index && s.bank)
+        text += "|fit|" + std::to_string(s.bank->size()) + '|' + std::to_string(s.bank->length) + '|' +
+                std::to_string(s.neighbours) + '|' + std::to_string(s.fit_offset) + '|' +
+                CampaignCheckpoint::number(s.min_snr);
+    std::uint64_t h = 1469598103934665603ull;
+    for (unsigned char c : text) {
+        h ^= c;
+        h *= 1099511628211ull;
+    }
+    char buffer[17];
+    std::snprintf(buffer, sizeof(buffer), "%016llx", static_cast<unsigned long long>(h));
+    return buffer;
+}
+
+// Runs the pipeline over a list of files on a work-stealing pool. A file task
+// waits for its share of the memory budget, loads and processes the record,
+// copies out one window per pick and releases the record; every window then
+// becomes its own fit task, so a file with many events spreads over idle
+// workers. Files already completed in the checkpoint are not run again, and a
+// failing file is reported in its summary instead of stopping the campaign.
+inline CampaignResult run_campaign(const std::vector<std::string>& paths, const CampaignSettings& settings) {
+    using clock = std::chrono::steady_clock;
+    const bool fitting = settings.index && settings.bank;
+    for (const std::string& path : paths)
+        if (path.find_first_of("\t\n") != std::string::npos)
+            throw std::invalid_argument("run_campaign: file names may not contain tabs or newlines");
+    if (fitting && settings.neighbours == 0)
+        throw std::invalid_argument("run_campaign: fitting needs at least one neighbour");
+
+    CampaignCheckpoint checkpoint;
+    CampaignResult resumed;
+    if (!settings.checkpoint.empty())
+        resumed = checkpoint.open(settings.checkpoint, campaign_hash(settings));
+
+    CampaignResult result;
+    result.files.resize(paths.size());
+    std::vector<std::vector<EventRow>> per_file(paths.size());
+    std::vector<bool> skip(paths.size(), false);
+    for (std::size_t f = 0; f < paths.size(); ++f) {
+        result.files[f].path = paths[f];
+        for (std::size_t r = 0; r < resumed.files.size(); ++r)
+            if (resumed.files[r].path == paths[f] && !skip[f]) {
+                skip[f] = true;
+                result.files[f] = resumed.files[r];
+                for (const EventRow& e : resumed.events)
+                    if (e.file == r)
+                        per_file[f].push_back(e);
+            }
+    }
+
+    struct FileState {
+        std::size_t index;
+        clock::time_point start;
+        std::atomic<std::size_t> remaining{0};
+        std::vector<std::vector<double>> windows;
+        std::mutex mutex;
+        std::string error;                  // first failed fit
+    };
+
+    MemoryBudget budget(settings.memory_budget);
+    WorkStealingPool pool(settings.threads);
+
+    auto finish_file = [&](FileState& state) {
+        FileSummary& summary = result.files[state.index];
+        summary.seconds = std::chrono::duration<double>(clock::now() - state.start).count();
+        summary.events = per_file[state.index].size();
+        if (summary.status.empty())
+            summary.status = state.error.empty() ? "ok" : state.error;
+        checkpoint.commit(summary, per_file[state.index]);
+    };
+
+    for (std::size_t f = 0; f < paths.size(); ++f) {
+        if (skip[f])
+            continue;
+        pool.submit([&, f] {
+            auto state = std::make_shared<FileState>();
+            state->index = f;
+            state->start = clock::now();
+            FileSummary& summary = result.files[f];
+            std::vector<EventRow>& rows = per_file[f];
+            try {
+                ChunkSource source = open_record(paths[f], settings.member, settings.time_axis);
+                const std::size_t C = source.channels, N = source.samples;
+                summary.channels = C;
+                summary.samples = N;
+                if (!settings.factors.empty() && settings.factors.size() != C)
+                    throw std::invalid_argument("factors: one per channel");
+
+                const std::size_t held = budget.acquire(C * N * sizeof(double));
+                try {
+                    std::vector<double> data(C * N);
+                    source.read(0, N, data.data());
+                    if (!settings.factors.empty())
+                        for (std::size_t c = 0; c < C; ++c)
+                            for (std::size_t k = 0; k < N; ++k)
+                                data[c * N + k] *= settings.factors[c];
+                    if (!settings.filter.sections.empty())
+                        filtfilt_channels(settings.filter, data.data(), C, N, data.data(), 1);
+
+                    EventPicker picker(C, settings.picker);
+                    std::vector<Pick> picks = picker.process(data.data(), N, 1);
+                    auto rest = picker.finish();
+                    picks.insert(picks.end(), rest.begin(), rest.end());
+                    EventPicker::sort(picks);
+
+                    for (const Pick& p : picks)
+                        rows.push_back({f, p, false, FitResult{}, 0.0});
+                    if (fitting) {
+                        const std::size_t L = settings.bank->length;
+                        state->windows.resize(rows.size());
+                        for (std::size_t e = 0; e < rows.size(); ++e) {
+                            const Pick& p = rows[e].pick;
+                            const std::ptrdiff_t begin = static_cast<std::ptrdiff_t>(p.onset) + settings.fit_offset -
+                                                         static_cast<std::ptrdiff_t>(settings.bank->center);
+                            if (p.snr < settings.min_snr || begin < 0 ||
+                                static_cast<std::size_t>(begin) + L > N)
+                                continue;
+                            const double* x = data.data() + p.channel * N + begin;
+                            state->windows[e].assign(x, x + L);
+                        }
+                    }
+                } catch (...) {
+                    budget.release(held);
+                    throw;
+                }
+                budget.release(held);
+            } catch (const std::exception& error) {
+                summary.status = error.what();
+                rows.clear();
+                state->windows.clear();
+            }
+
+            std::vector<std::size_t> jobs;
+            for (std::size_t e = 0; e < state->windows.size(); ++e)
+                if (!state->windows[e].empty())
+                    jobs.push_back(e);
+            if (jobs.empty()) {
+                finish_file(*state);
+                return;
+            }
+            state->remaining = jobs.size();
+            for (std::size_t e : jobs)
+                pool.submit([&, state, e] {
+                    EventRow& row = per_file[state->index][e];
+                    const std::vector<double>& window = state->windows[e];
+                    try {
+                        row.fit = fit_from_index(*settings.index, *settings.bank, window.data(), window.size(),
+                                                 settings.neighbours);
+                        row.y = settings.bank->parameters[row.fit.seed_template].y;
+                        row.fitted = true;
+                    } catch (const std::exception& error) {
+                        std::lock_guard<std::mutex> lock(state->mutex);
+                        if (state->error.empty())
+                            state->error = std::string("fit: ") + error.what();
+                    }
+                    std::vector<double>().swap(state->windows[e]);
+                    if (--state->remaining == 0)
+                        finish_file(*state);
+                });
+        });
+    }
+    pool.wait();
+
+    for (std::size_t f = 0; f < paths.size(); ++f)
+        for (EventRow& e : per_file[f]) {
+            e.file = f;
+            result.events.push_back(e);
+        }
+    return result;
+}
+
+// One row per event (files without events get a single row with the status),
+// tab-separated with a header line.
+inline void write_summary(const CampaignResult& result, const std::string& path) {
+    std::ofstream out(path);
+    if (!out)
+        throw std::runtime_error("cannot create " + path);
+    out << "file\tstatus\tchannel\ttrigger\tonset\tend\tmethod\tratio\tamplitude\tsnr\taic_contrast\tfitted"
+           "\tC_f\tX_c\tGamma\ty\tshift\tchi2\n";
+    std::size_t e = 0;
+    for (std::size_t f = 0; f < result.files.size(); ++f) {
+        const FileSummary& file = result.files[f];
+        std::string status = file.status;
+        std::replace(status.begin(), status.end(), '\t', ' ');
+        std::replace(status.begin(), status.end(), '\n', ' ');
+        bool any = false;
+        for (; e < result.events.size() && result.events[e].file == f; ++e) {
+            std::string line = CampaignCheckpoint::event_line(file.path, result.events[e]);
+            // "event\t<path>\t..." -> "<path>\t<status>\t..."
+            out << file.path << '\t' << status << line.substr(6 + file.path.size());
+            any = true;
+        }
+        if (!any)
+            out << file.path << '\t' << status << "\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\n";
+    }
+}
+
+#endif
@@ -0,0 +1,164 @@
+#ifndef CROSS_CORRELATOR_HH
+#define CROSS_CORRELATOR_HH
+
+#include "FFT.hh"
+#include "Parallel.hh"
+
+#include <vector>
+#include <complex>
+#include <cmath>
+#include <cstddef>
+#include <utility>
+#include <algorithm>
+#include <stdexcept>
+
+struct CorrelationPeak {
+    std::size_t i, j;
+    double lag;                   // samples, sub-sample; > 0 when channel i lags channel j
+    double value;                 // correlation at the interpolated peak
+    double coefficient;           // value / (|x_i| |x_j|)
+};
+
+// Cross-correlations between every channel of an N-channel record, the same
+// as DataProcessor.get_ccf_full: each channel is demeaned, linearly detrended
+// and demeaned again, then
+//   c_ij[k] = sum_n x_i[n + k - (N - 1)] x_j[n],   k = 0 .. 2N - 2,
+// i.e. scipy.signal.correlate(x_i, x_j, 'full'). Every channel is transformed
+// once at construction; a pair then costs one spectrum product and one
+// inverse FFT.
+class CrossCorrelator {
+private:
+    using cd = std::complex<double>;
+
+    std::size_t channels;
+    std::size_t samples;
+    std::size_t nfft;
+    FFTPlan plan;
+    std::vector<cd> spectra;      // [channel][bin]
+    std::vector<double> norms;
+
+    static void detrend(double* x, std::size_t n) {
+        auto demean = [&]() {
+            double mean = 0.0;
+            for (std::size_t k = 0; k < n; ++k)
+                mean += x[k];
+            mean /= static_cast<double>(n);
+            for (std::size_t k = 0; k < n; ++k)
+                x[k] -= mean;
+        };
+        demean();
+        // Least-squares line on t = k - (n - 1) / 2; x already has zero mean
+        const double t0 = 0.5 * static_cast<double>(n - 1);
+        double st = 0.0, tt = 0.0;
+        for (std::size_t k = 0; k < n; ++k) {
+            double t = static_cast<double>(k) - t0;
+            st += t * x[k];
+            tt += t * t;
+        }
+        const double slope = tt > 0.0 ? st / tt : 0.0;
+        for (std::size_t k = 0; k < n; ++k)
+            x[k] -= slope * (static_cast<double>(k) - t0);
+        demean();
+    }
+
+    // Lag k - (N - 1) of the full correlation from the circular one
+    std::size_t bin(std::size_t k) const {
+        return k >= samples - 1 ? k - (samples - 1) : nfft - (samples - 1 - k);
+    }
+
+public:
+    // data is [channel][sample]
+    CrossCorrelator(const double* data, std::size_t channels, std::size_t samples, unsigned threads = 0)
+        : channels(channels), samples(samples), nfft(FFTPlan::next_pow2(std::max<std::size_t>(2 * samples, 2) - 1)),
+          plan(nfft), spectra(channels * nfft), norms(channels) {
+        if (samples < 2)
+            throw std::invalid_argument("CrossCorrelator: need at least two samples per channel");
+        parallel_for(channels, threads, [&](std::size_t c, unsigned) {
+            std::vector<double> x(data + c * samples, data + (c + 1) * samples);
+            detrend(x.data(), samples);
+            double ss = 0.0;
+            for (double v : x)
+                ss += v * v;
+            norms[c] = std::sqrt(ss);
+            cd* s = spectra.data() + c * nfft;
+            std::fill(s, s + nfft, cd(0.0, 0.0));
+            for (std::size_t k = 0; k < samples; ++k)
+                s[k] = x[k];
+            plan.forward(s);
+        });
+    }
+
+    std::size_t n_channels() const { return channels; }
+    std::size_t n_samples() const { return samples; }
+    std::size_t full_size() const { return 2 * samples - 1; }
+
+    // Full correlation of channels i and j into out[0, 2N - 1). `work` is nfft scratch.
+    void correlate(std::size_t i, std::size_t j, double* out, std::vector<cd>& work) const {
+        work.resize(nfft);
+        const cd* a = spectra.data() + i * nfft;
+        const cd* b = spectra.data() + j * nfft;
+        for (std::size_t k = 0; k < nfft; ++k)
+            work[k] = a[k] * std::conj(b[k]);
+        plan.inverse(work.data());
+        for (std::size_t k = 0; k < full_size(); ++k)
+            out[k] = work[bin(k)].real();
+    }
+
+    // Index of the largest c[first..last], moved by the vertex of the parabola
+    // through it and its neighbours; `value` is the parabola's peak.
+    static double refine_peak(const double* c, std::size_t first, std::size_t last, double& value) {
+        std::size_t k = first;
+        for (std::size_t m = first + 1; m <= last; ++m)
+            if (c[m] > c[k])
+                k = m;
+        double offset = 0.0;
+        value = c[k];
+        if (k > first && k < last) {
+            double l = c[k - 1], r = c[k + 1];
+            double curvature = l - 2.0 * c[k] + r;
+            if (curvature < 0.0) {
+                offset = 0.5 * (l - r) / curvature;
+                value = c[k] - 0.25 * (l - r) * offset;
+            }
+        }
+        return static_cast<double>(k) + offset;
+    }
+
+    static std::vector<std::pair<std::size_t, std::size_t>> all_pairs(std::size_t channels) {
+        std::vector<std::pair<std::size_t, std::size_t>> pairs;
+        for (std::size_t i = 0; i < channels; ++i)
+            for (std::size_t j = i + 1; j < channels; ++j)
+                pairs.emplace_back(i, j);
+        return pairs;
+    }
+
+    // Largest correlation of each pair within |lag| <= max_lag (0: any lag),
+    // refined by a parabola through the peak and its neighbours.
+    std::vector<CorrelationPeak> peaks(const std::vector<std::pair<std::size_t, std::size_t>>& pairs,
+                                       std::size_t max_lag = 0, unsigned threads = 0) const {
+        for (const auto& p : pairs)
+            if (p.first >= channels || p.second >= channels)
+                throw std::out_of_range("CrossCorrelator: channel index out of range");
+        const std::size_t limit = max_lag == 0 ? samples - 1 : std::min(max_lag, samples - 1);
+        const std::size_t first = samples - 1 - limit, last = samples - 1 + limit;
+
+        std::vector<CorrelationPeak> result(pairs.size());
+        const unsigned workers = resolve_threads(threads, pairs.size());
+        std::vector<std::vector<cd>> work(workers);
+        std::vector<std::vector<double>> full(workers, std::vector<double>(full_size()));
+        parallel_for(pairs.size(), workers, [&](std::size_t p, unsigned w) {
+            const std::size_t i = pairs[p].first, j = pairs[p].second;
+            const double* c = full[w].data();
+            correlate(i, j, full[w].data(), work[w]);
+
+            double value;
+            double position = refine_peak(c, first, last, value);
+            double scale = norms[i] * norms[j];
+            result[p] = {i, j, position - static_cast<double>(samples - 1), value,
+                         scale > 0.0 ? value / scale : 0.0};
+        });
+        return result;
+    }
+};
+
+#endif
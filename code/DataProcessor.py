@@ -56,12 +56,28 @@ def shear_strain_to_stress(E: float, poisson_ratio: float, strain: float|np.ndar
     
     return stress
 
+def voltage_to_stress(raw_voltage: np.ndarray, E: float|list[float] = 51e9, poisson_ratio: float|list[float] = 0.25,
+                      Vex: float|list[float] = 4.98, GF: float|list[float] = 2.12, Gain: float|list[float] = 1000,
+                      out: np.ndarray|None = None, threads: int = 1) -> np.ndarray:
+    '''
+    voltage_to_strain followed by shear_strain_to_stress in one native pass.
+
+    raw_voltage is a (channels, samples) array, the layout of highpass_filter
+    and the cross-correlation helpers (or 1-D for a single channel); every
+    constant may be a scalar or one value per channel. Pass out=raw_voltage to
+    convert a float64 or float32 array (e.g. a writable memmap) in place.
+    '''
+    raw_voltage = np.asarray(raw_voltage)
+    channels = 1 if raw_voltage.ndim == 1 else raw_voltage.shape[0]
+    converter = CohesiveCrack.StrainConverter(channels, Vex, GF, Gain, E, poisson_ratio)
+    return converter.process(raw_voltage, out, threads)
+
 def highpass_filter(data, cutoff, fs, order=4):
-    nyquist = 0.5 * fs
-    normal_cutoff = cutoff / nyquist
-    b, a = scipy.signal.butter(order, normal_cutoff, btype = 'high', analog=False)
-    filtered_data = scipy.signal.filtfilt(b, a, data)
-    return filtered_data
+    '''
+    Zero-phase Butterworth high-pass along the last axis (same result as
+    scipy.signal.sosfiltfilt); a (channels, samples) array is filtered in parallel.
+    '''
+    return CohesiveCrack.filtfilt(data, cutoff, fs, order, 'high')
 
 def apply_taper(signal:np.ndarray, taper_ratio: float = 0.05) -> np.ndarray:
     """
@@ -93,7 +109,8 @@ def fitting_function(X_c: float, C_f: float, Gamma: float, x: float|np.ndarray,
     C_s = 2760    # Shear wave speed (m/s)
     C_d = 4790    # Longitudinal wave speed (m/s)
     
-    return CohesiveCrack.delta_sigma_xy(x, y, X_c, C_f, C_s, C_d, nu, Gamma, E)
+    x = np.asarray(x, dtype=float)
+    return CohesiveCrack.delta_sigma_xy_array(x.ravel(), y, X_c, C_f, C_s, C_d, nu, Gamma, E).reshape(x.shape)
 
 def chi_square(X_c: float, Gamma: float, C_f: float, X: np.ndarray, Y: np.ndarray):
     '''
@@ -105,50 +122,46 @@ def chi_square(X_c: float, Gamma: float, C_f: float, X: np.ndarray, Y: np.ndarra
     chi2 = np.sum((Y - MODEL)**2)
     return chi2
 
+def residual_scan(record: np.ndarray, fs: float, X_c: float, C_f: float, Gamma: float, y: float,
+                  window: int = 2048, block_size: int = 65536, component: str = 'xy') -> tuple[np.ndarray, np.ndarray]:
+    '''
+    Slide the model along a continuous record and return (t0_index, residual),
+    where residual is the mean squared misfit of the window centred on t0.
+    The record is streamed block by block, so it may be a memory-mapped array.
+    '''
+    E = 51e9
+    nu = 0.25
+    C_s = 2760
+    C_d = 4790
+
+    center = window // 2
+    model = CohesiveCrack.model_trace(component, X_c, C_f, C_s, C_d, nu, Gamma, E, y, fs, window, center)
+    evaluator = CohesiveCrack.StreamingEvaluator(model, center)
+
+    first_t0 = evaluator.next_t0
+    if len(record) == 0:
+        return np.arange(0), np.empty(0)
+    residual = np.concatenate([evaluator.push(record[i:i + block_size]) for i in range(0, len(record), block_size)])
+    return first_t0 + np.arange(len(residual)), residual
+
 def do_deconvolution(SIGNAL_1: np.ndarray, 
                      SIGNAL_2: np.ndarray, 
                      water_level: float =  0.05, 
                      damp_ratio: float = 0.05,
                      stabilizing_type: str = 'W') -> np.ndarray:
-    
-    NUMERATOR = np.fft.fft(SIGNAL_1)
-    DENUMERATOR = np.fft.fft(SIGNAL_2)
-
-
-    max_denominator = np.max(np.abs(DENUMERATOR))
-    water_level_value = water_level * max_denominator
-
-
-    # Do water leveling
-    STABILIZED_DENOMINATOR = DENUMERATOR
-    for i in range(len(DENUMERATOR)):
-        if np.abs(DENUMERATOR[i]) < water_level_value:
-            STABILIZED_DENOMINATOR[i] = ( DENUMERATOR[i] / np.abs(DENUMERATOR[i]) ) * water_level_value
-    DECONV_STABILIZED_WTER = NUMERATOR / STABILIZED_DENOMINATOR
-    DECONV_TIME_DOMAIN_WTER = np.fft.ifft(DECONV_STABILIZED_WTER)
-
-
-    # Do damped
-    damp_value = np.average(np.abs(DENUMERATOR)**2) * damp_ratio
-    DECONV_STABILIZED_DAMP = (NUMERATOR * np.conjugate(DENUMERATOR)) / (DENUMERATOR * np.conjugate(DENUMERATOR) + damp_value)
-    DECONV_TIME_DOMAIN_DAMP = np.fft.ifft(DECONV_STABILIZED_DAMP)
-
-
-    # Choose type
-    if stabilizing_type == 'W':
-        DECONV_TIME_DOMAIN = DECONV_TIME_DOMAIN_WTER
-    if stabilizing_type == 'D':
-        DECONV_TIME_DOMAIN = DECONV_TIME_DOMAIN_DAMP
-
-    # Do shifting
-    total_len = int(len(DECONV_TIME_DOMAIN))
-    midpoint = int(len(DECONV_TIME_DOMAIN) / 2)
-    DECONV_TIME_DOMAIN_SHIFTED = np.append(DECONV_TIME_DOMAIN[midpoint: total_len-1], DECONV_TIME_DOMAIN[0:midpoint-1])
-
-    return np.real(DECONV_TIME_DOMAIN_SHIFTED)
+    '''
+    Deconvolve SIGNAL_1 by SIGNAL_2 with water-level ('W') or damped ('D')
+    stabilization and return the real result shifted so zero lag sits near the
+    middle (length N - 2). SIGNAL_1 may also be a (signals, N) batch sharing
+    the reference SIGNAL_2.
+    '''
+    return CohesiveCrack.deconvolve(SIGNAL_1, SIGNAL_2, water_level, damp_ratio, stabilizing_type)
 
 
 def get_ccf_full(DATA_FLOOR_1: np.ndarray, DATA_FLOOR_2: np.ndarray) -> np.ndarray:
+    if len(DATA_FLOOR_1) == len(DATA_FLOOR_2):
+        return CohesiveCrack.CrossCorrelator(np.vstack([DATA_FLOOR_1, DATA_FLOOR_2])).full(0, 1)
+
     DATA_1 = DATA_FLOOR_1 - np.mean(DATA_FLOOR_1)
     DATA_2 = DATA_FLOOR_2 - np.mean(DATA_FLOOR_2)
 
@@ -159,4 +172,39 @@ def get_ccf_full(DATA_FLOOR_1: np.ndarray, DATA_FLOOR_2: np.ndarray) -> np.ndarr
     DATA_2 = DATA_2 - np.mean(DATA_2)
 
     cross_correlation = scipy.signal.correlate(DATA_1, DATA_2, mode='full')
-    return cross_correlation
\ No newline at end of file
+    return cross_correlation
+
+def arrival_lags(record: np.ndarray, fs: float, max_lag: float|None = None) -> dict:
+    '''
+    Relative arrival times between every pair of channels of a (channels, samples)
+    record from the peak of get_ccf_full-style cross-correlations. Returns the
+    pair indices, lag in seconds (> 0 when channel i arrives after channel j)
+    and the normalized correlation at the peak.
+    '''
+    engine = CohesiveCrack.CrossCorrelator(np.asarray(record, dtype=float))
+    peaks = engine.peaks(max_lag=0 if max_lag is None else int(np.ceil(max_lag * fs)))
+    peaks['lag'] = peaks['lag'] / fs
+    return peaks
+
+def pick_arrivals(record: np.ndarray, fs: float, sta: float = 20e-6, lta: float = 1e-3, on: float = 4.0,
+                  off: float = 1.5, derivative: float = 0.0, pre: float = 200e-6, post: float = 100e-6) -> dict:
+    '''
+    Rupture arrivals on every channel of a (channels, samples) record: STA/LTA
+    (and optionally derivative) triggers refined to an AIC onset. Windows are
+    in seconds; returns the native pick arrays plus onset/trigger times (s).
+    '''
+    samples = lambda t: max(int(round(t * fs)), 1)
+    settings = CohesiveCrack.PickerSettings(samples(sta), samples(lta), on, off, derivative, samples(pre), samples(post))
+    picks = CohesiveCrack.pick_events(np.asarray(record, dtype=float), settings)
+    picks['onset_time'] = picks['onset'] / fs
+    picks['trigger_time'] = picks['trigger'] / fs
+    return picks
+
+def decimate(data: np.ndarray, fs: float, factor: int) -> tuple[np.ndarray, float]:
+    '''
+    Anti-aliased decimation of a (samples,) or (channels, samples) array along
+    its last axis by an integer factor (native polyphase FIR, same output as
+    scipy.signal.resample_poly(data, 1, factor, axis=-1)). Returns the
+    decimated data and the new sample rate.
+    '''
+    return CohesiveCrack.resample_poly(np.asarray(data, dtype=float), 1, factor), fs / factor
@@ -0,0 +1,114 @@
+#ifndef DECONVOLUTION_HH
+#define DECONVOLUTION_HH
+
+#include "FFT.hh"
+#include "Parallel.hh"
+
+#include <vector>
+#include <complex>
+#include <cmath>
+#include <cstddef>
+#include <algorithm>
+#include <memory>
+#include <stdexcept>
+
+enum class Stabilization { water_level, damped };
+
+// Spectral division of a signal by a reference with a stabilized denominator,
+// as DataProcessor.do_deconvolution:
+//   water level: bins with |D| < level * max|D| are raised to that magnitude;
+//   damped:      N conj(D) / (|D|^2 + ratio * mean|D|^2).
+// The stabilized inverse of the reference is computed once by set_reference()
+// and reused for every signal, so a batch against one reference costs one
+// forward and one inverse FFT per signal. Output keeps the Python shift,
+// x[mid:N-1] followed by x[0:mid-1] (N - 2 samples, zero lag near the middle).
+class Deconvolver {
+private:
+    using cd = std::complex<double>;
+
+    std::size_t n;
+    FFTPlan plan;
+    std::vector<cd> inverse_reference;
+
+public:
+    explicit Deconvolver(std::size_t n) : n(n), plan(n) {
+        if (n < 3)
+            throw std::invalid_argument("Deconvolver: need at least three samples");
+    }
+
+    std::size_t size() const { return n; }
+    std::size_t output_size() const { return n - 2; }
+
+    void set_reference(const double* reference, Stabilization type, double water_level, double damp_ratio) {
+        std::vector<cd> D(reference, reference + n);
+        plan.forward(D.data());
+        inverse_reference.resize(n);
+
+        if (type == Stabilization::water_level) {
+            double max_abs = 0.0;
+            for (const auto& v : D)
+                max_abs = std::max(max_abs, std::abs(v));
+            const double level = water_level * max_abs;
+            for (std::size_t k = 0; k < n; ++k) {
+                double a = std::abs(D[k]);
+                cd d = a >= level ? D[k] : (a > 0.0 ? D[k] * (level / a) : cd(level, 0.0));
+                inverse_reference[k] = 1.0 / d;
+            }
+        } else {
+            double mean_power = 0.0;
+            for (const auto& v : D)
+                mean_power += std::norm(v);
+            const double damp = damp_ratio * mean_power / static_cast<double>(n);
+            for (std::size_t k = 0; k < n; ++k)
+                inverse_reference[k] = std::conj(D[k]) / (std::norm(D[k]) + damp);
+        }
+    }
+
+    // Deconvolves one signal against the current reference into out[0, N - 2).
+    // `work` is per-thread scratch of N bins.
+    void apply(const double* signal, double* out, std::vector<cd>& work) const {
+        if (inverse_reference.size() != n)
+            throw std::logic_error("Deconvolver: set_reference() has not been called");
+        work.resize(n);
+        for (std::size_t k = 0; k < n; ++k)
+            work[k] = cd(signal[k], 0.0);
+        plan.forward(work.data());
+        for (std::size_t k = 0; k < n; ++k)
+            work[k] *= inverse_reference[k];
+        plan.inverse(work.data());
+
+        const std::size_t mid = n / 2;
+        std::size_t j = 0;
+        for (std::size_t k = mid; k < n - 1; ++k)
+            out[j++] = work[k].real();
+        for (std::size_t k = 0; k + 1 < mid; ++k)
+            out[j++] = work[k].real();
+    }
+
+    // Rows of a [signal][sample] batch against the current reference, in parallel.
+    void apply_batch(const double* signals, std::size_t count, double* out, unsigned threads = 0) const {
+        const unsigned workers = resolve_threads(threads, count);
+        std::vector<std::vector<cd>> scratch(workers);
+        parallel_for(count, workers, [&](std::size_t i, unsigned w) {
+            apply(signals + i * n, out + i * output_size(), scratch[w]);
+        });
+    }
+};
+
+// Row i of signals against row i of references, in parallel. Each worker
+// keeps its own Deconvolver, since the stabilized reference changes per row.
+inline void deconvolve_pairs(const double* signals, const double* references, std::size_t count, std::size_t n,
+                             Stabilization type, double water_level, double damp_ratio, double* out,
+                             unsigned threads = 0) {
+    const unsigned workers = resolve_threads(threads, count);
+    std::vector<std::unique_ptr<Deconvolver>> local(workers);
+    std::vector<std::vector<std::complex<double>>> scratch(workers);
+    parallel_for(count, workers, [&](std::size_t i, unsigned w) {
+        if (!local[w])
+            local[w] = std::make_unique<Deconvolver>(n);
+        local[w]->set_reference(references + i * n, type, water_level, damp_ratio);
+        local[w]->apply(signals + i * n, out + i * (n - 2), scratch[w]);
+    });
+}
+
+#endif
@@ -0,0 +1,298 @@
+#ifndef EVENT_PICKER_HH
+#define EVENT_PICKER_HH
+
+#include "OutOfCore.hh"
+#include "Parallel.hh"
+
+#include <vector>
+#include <random>
+#include <chrono>
+#include <iostream>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <algorithm>
+#include <stdexcept>
+
+// Detector settings; lengths are in samples.
+struct PickerSettings {
+    std::size_t sta = 20;         // short-term average window
+    std::size_t lta = 1000;       // long-term average window (also the warm-up)
+    double on = 4.0;              // STA/LTA trigger ratio
+    double off = 1.5;             // STA/LTA detrigger ratio
+    double derivative = 0.0;      // also trigger when |dx| > derivative * rms(dx); 0 disables
+    std::size_t pre = 200;        // AIC window before the trigger
+    std::size_t post = 100;       // AIC window after the trigger
+    std::size_t dead_time = 0;    // no new trigger this long after a detrigger
+};
+
+enum class PickMethod { sta_lta = 0, derivative = 1 };
+
+struct Pick {
+    std::size_t channel;
+    std::size_t trigger;          // sample at which the detector fired
+    std::size_t onset;            // AIC-refined arrival
+    std::size_t end;              // detrigger sample
+    PickMethod method;
+    double ratio;                 // peak STA/LTA while triggered
+    double amplitude;             // peak |x| while triggered
+    double snr;                   // amplitude / pre-trigger RMS (sqrt LTA)
+    double aic_contrast;          // (mean - min) of the AIC curve per sample; sharp onsets score high
+};
+
+// Maeda's AIC on one window: AIC(k) = k log var(x[0, k]) + (n - k - 1) log var(x[k + 1, n)).
+// Returns k + 1 for the minimizing k, the first sample after the change; prefix
+// sums keep it O(n).
+struct OnsetAIC {
+    static std::size_t refine(const double* x, std::size_t n, double& contrast, std::vector<double>& work) {
+        contrast = 0.0;
+        if (n < 4)
+            return 0;
+        work.assign(2 * (n + 1), 0.0);
+        double* s = work.data();
+        double* q = s + n + 1;
+        for (std::size_t k = 0; k < n; ++k) {
+            s[k + 1] = s[k] + x[k];
+            q[k + 1] = q[k] + x[k] * x[k];
+        }
+        auto log_var = [](double sum, double squares, double count) {
+            double mean = sum / count;
+            return std::log(std::max(squares / count - mean * mean, std::numeric_limits<double>::min()));
+        };
+        std::size_t best = 1;
+        double lowest = std::numeric_limits<double>::infinity(), total = 0.0;
+        for (std::size_t k = 1; k + 2 < n; ++k) {
+            const double left = static_cast<double>(k + 1), right = static_cast<double>(n - k - 1);
+            double aic = static_cast<double>(k) * log_var(s[k + 1], q[k + 1], left) +
+                         right * log_var(s[n] - s[k + 1], q[n] - q[k + 1], right);
+            total += aic;
+            if (aic < lowest) {
+                lowest = aic;
+                best = k;
+            }
+        }
+        contrast = (total / static_cast<double>(n - 3) - lowest) / static_cast<double>(n);
+        return best + 1;
+    }
+};
+
+// Streaming detector for one channel. Recursive STA/LTA of x^2 (and an LTA
+// of the first difference for the derivative test) is updated per sample; a
+// ring of the last pre + post + 1 samples lets the AIC window straddle chunk
+// boundaries. A pick is emitted once it has detriggered and its post window
+// is complete.
+class ChannelPicker {
+private:
+    PickerSettings settings;
+    std::size_t channel;
+    double c_sta, c_lta;
+    double sta = 0.0, lta = 0.0, dlta = 0.0, last = 0.0;
+    std::size_t seen = 0;
+    std::size_t quiet_until = 0;
+
+    std::vector<double> ring;
+    std::size_t mask;
+
+    bool open = false;            // a pick has fired and is not yet emitted
+    bool triggered = false;       // still above the detrigger ratio
+    bool refined = false;         // AIC already computed
+    Pick current{};
+
+    std::vector<double> window, work;
+
+    void refine(std::size_t available_end) {
+        const std::size_t first = current.trigger >= settings.pre ? current.trigger - settings.pre : 0;
+        const std::size_t oldest = seen > ring.size() ? seen - ring.size() : 0;
+        const std::size_t begin = std::max(first, oldest);
+        const std::size_t end = std::min(available_end, current.trigger + settings.post + 1);
+        window.resize(end - begin);
+        for (std::size_t k = begin; k < end; ++k)
+            window[k - begin] = ring[k & mask];
+        current.onset = begin + OnsetAIC::refine(window.data(), window.size(), current.aic_contrast, work);
+        refined = true;
+    }
+
+    void close() {
+        const double rms = current.snr;
+        current.snr = rms > 0.0 ? current.amplitude / rms : std::numeric_limits<double>::infinity();
+        open = triggered = false;
+        quiet_until = current.end + settings.dead_time;
+    }
+
+public:
+    ChannelPicker(const PickerSettings& settings, std::size_t channel)
+        : settings(settings), channel(channel), c_sta(1.0 / static_cast<double>(std::max<std::size_t>(settings.sta, 1))),
+          c_lta(1.0 / static_cast<double>(std::max<std::size_t>(settings.lta, 1))) {
+        if (settings.sta == 0 || settings.lta <= settings.sta)
+            throw std::invalid_argument("PickerSettings: need 0 < sta < lta");
+        if (settings.off > settings.on)
+            throw std::invalid_argument("PickerSettings: off must not exceed on");
+        std::size_t size = 1;
+        while (size < settings.pre + settings.post + 1)
+            size <<= 1;
+        ring.assign(size, 0.0);
+        mask = size - 1;
+    }
+
+    template <typename Emit>
+    void process(const double* x, std::size_t n, Emit&& emit) {
+        const double k2 = settings.derivative * settings.derivative;
+        for (std::size_t i = 0; i < n; ++i) {
+            const double v = x[i], e = v * v, d = v - last;
+            const double noise = lta, dnoise = dlta;
+            sta += c_sta * (e - sta);
+            lta += c_lta * (e - lta);
+            dlta += c_lta * (d * d - dlta);
+            last = v;
+            ring[seen & mask] = v;
+            const std::size_t t = seen++;
+
+            const double ratio = lta > 0.0 ? sta / lta : 0.0;
+            if (!open) {
+                if (t < settings.lta || t < quiet_until)
+                    continue;
+                const bool by_ratio = ratio > settings.on;
+                const bool by_derivative = k2 > 0.0 && d * d > k2 * dnoise;
+                if (!by_ratio && !by_derivative)
+                    continue;
+                open = triggered = true;
+                refined = false;
+                current = Pick{channel, t, t, t, by_ratio ? PickMethod::sta_lta : PickMethod::derivative,
+                               ratio, std::abs(v), 0.0, 0.0};
+                current.snr = std::sqrt(noise);     // pre-trigger RMS until the pick closes
+                continue;
+            }
+            if (triggered) {
+                current.ratio = std::max(current.ratio, ratio);
+                current.amplitude = std::max(current.amplitude, std::abs(v));
+                if (ratio < settings.off && t >= current.trigger + settings.sta) {
+                    triggered = false;
+                    current.end = t;
+                }
+            }
+            if (!refined && t >= current.trigger + settings.post)
+                refine(seen);
+            if (!triggered && refined) {
+                close();
+                emit(current);
+            }
+        }
+    }
+
+    // Emits a pick still open at the end of the record, with whatever AIC window exists.
+    template <typename Emit>
+    void finish(Emit&& emit) {
+        if (!open)
+            return;
+        if (triggered)
+            current.end = seen - 1;
+        if (!refined)
+            refine(seen);
+        close();
+        emit(current);
+    }
+
+};
+
+// All channels of a record in one pass: chunks are [channel][sample] and the
+// channels of a chunk run in parallel. Each call returns its picks ordered by trigger.
+class EventPicker {
+private:
+    std::vector<ChannelPicker> pickers;
+    std::vector<std::vector<Pick>> found;
+
+    std::vector<Pick> collect() {
+        std::vector<Pick> picks;
+        for (auto& f : found) {
+            picks.insert(picks.end(), f.begin(), f.end());
+            f.clear();
+        }
+        sort(picks);
+        return picks;
+    }
+
+public:
+    EventPicker(std::size_t channels, const PickerSettings& settings) : found(channels) {
+        if (channels == 0)
+            throw std::invalid_argument("EventPicker: need at least one channel");
+        for (std::size_t c = 0; c < channels; ++c)
+            pickers.emplace_back(settings, c);
+    }
+
+    std::size_t n_channels() const { return pickers.size(); }
+
+    static void sort(std::vector<Pick>& picks) {
+        std::sort(picks.begin(), picks.end(), [](const Pick& a, const Pick& b) {
+            return a.trigger != b.trigger ? a.trigger < b.trigger : a.channel < b.channel;
+        });
+    }
+
+    // Feeds the next `count` samples of every channel; returns the picks completed so far.
+    std::vector<Pick> process(const double* data, std::size_t count, unsigned threads = 0) {
+        parallel_for(pickers.size(), threads, [&](std::size_t c, unsigned) {
+            pickers[c].process(data + c * count, count, [&](const Pick& p) { found[c].push_back(p); });
+        });
+        return collect();
+    }
+
+    std::vector<Pick> finish() {
+        for (std::size_t c = 0; c < pickers.size(); ++c)
+            pickers[c].finish([&](const Pick& p) { found[c].push_back(p); });
+        return collect();
+    }
+
+    // Streaming throughput on synthetic noise with a burst every 50000
+    // samples, default settings, one chunk fed `rounds` times per thread count.
+    static void benchmark_test(std::size_t channels = 8, std::size_t chunk = 1 << 18, std::size_t rounds = 16) {
+        std::cout << "Running event picker benchmark..." << std::endl;
+        std::vector<double> data(channels * chunk);
+        std::mt19937 generator(1);
+        std::normal_distribution<double> noise(0.0, 1.0);
+        for (std::size_t c = 0; c < channels; ++c)
+            for (std::size_t k = 0; k < chunk; ++k)
+                data[c * chunk + k] = noise(generator) * (k % 50000 >= 40000 && k % 50000 < 40400 ? 20.0 : 1.0);
+
+        std::vector<unsigned> counts{1};
+        if (default_threads() > 1)
+            counts.push_back(default_threads());
+        for (unsigned threads : counts) {
+            EventPicker picker(channels, PickerSettings());
+            std::size_t picks = 0;
+            auto start = std::chrono::high_resolution_clock::now();
+            for (std::size_t r = 0; r < rounds; ++r)
+                picks += picker.process(data.data(), chunk, threads).size();
+            picks += picker.finish().size();
+            auto end = std::chrono::high_resolution_clock::now();
+            double seconds = std::chrono::duration<double>(end - start).count();
+            const std::size_t samples = channels * chunk * rounds;
+            std::cout << "Threads: " << threads << ", samples: " << samples << ", picks: " << picks
+                      << ", time: " << seconds * 1000.0 << " ms, throughput: "
+                      << static_cast<double>(samples) / seconds / 1e6 << " M samples/s" << std::endl;
+        }
+    }
+};
+
+// Picks a whole chunked record, prefetching the next chunk while the current one is scanned.
+inline std::vector<Pick> pick_out_of_core(const ChunkSource& source, const PickerSettings& settings,
+                                          std::size_t chunk = 1 << 20, unsigned threads = 0) {
+    const std::size_t C = source.channels, n = source.samples;
+    const std::size_t n_chunks = (n + chunk - 1) / chunk;
+    EventPicker picker(C, settings);
+    std::vector<Pick> picks;
+
+    PrefetchReader reader([&](std::size_t c, std::vector<double>& buffer) {
+        const std::size_t count = std::min(chunk, n - c * chunk);
+        buffer.resize(C * count);
+        source.read(c * chunk, count, buffer.data());
+    }, n_chunks);
+    for (std::size_t c = 0; c < n_chunks; ++c) {
+        auto done = picker.process(reader.next()->data(), std::min(chunk, n - c * chunk), threads);
+        picks.insert(picks.end(), done.begin(), done.end());
+    }
+    auto rest = picker.finish();
+    picks.insert(picks.end(), rest.begin(), rest.end());
+    EventPicker::sort(picks);     // a long pick on one channel can finish after a later one elsewhere
+    return picks;
+}
+
+#endif
@@ -0,0 +1,8 @@
+#include "EventPicker.hh"
+
+int main() {
+    std::cout << "=== Event Picker Throughput ===" << std::endl;
+    EventPicker::benchmark_test();
+
+    return 0;
+}
@@ -0,0 +1,455 @@
+#ifndef EXPERIMENT_STORE_HH
+#define EXPERIMENT_STORE_HH
+
+#include "NpyReader.hh"
+#include "OutOfCore.hh"
+#include "Parallel.hh"
+
+#include <zlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <cmath>
+#include <cstring>
+#include <cstdint>
+#include <cstddef>
+#include <limits>
+#include <algorithm>
+#include <stdexcept>
+
+// Columnar store for one experiment run (.ccs):
+//
+//   "CCSTORE1" | u32 channels | u32 block_samples | u64 samples | f64 fs
+//   | channel names (u32 length + bytes each)
+//   | compressed blocks ...
+//   | directory: BlockInfo[channel][block]
+//   | u64 directory offset | "CCSTORE1"
+//
+// Every channel is cut into blocks of block_samples float64 values. A block is
+// byte-shuffled (all first bytes, then all second bytes, ...) so the slowly
+// varying exponent bytes line up, then deflated. The directory keeps each
+// block's location and min/max/RMS, so a time window decompresses only the
+// blocks it overlaps and overviews never decompress anything. Numbers are
+// stored in host byte order (little-endian on every machine we use).
+struct BlockInfo {
+    std::uint64_t offset;
+    std::uint32_t compressed_size;
+    std::uint32_t count;
+    double min;
+    double max;
+    double rms;
+};
+
+// One detected event in the sidecar index (.ccs.events), sorted by sample.
+struct StoredEvent {
+    std::uint64_t sample;         // t0, record sample index
+    std::uint32_t channel;
+    std::uint32_t flags;
+    double amplitude;
+    double score;
+    double C_f;
+    double X_c;
+    double Gamma;
+};
+
+struct BlockCodec {
+    static void shuffle(const double* in, std::size_t n, unsigned char* out) {
+        const unsigned char* bytes = reinterpret_cast<const unsigned char*>(in);
+        for (std::size_t b = 0; b < sizeof(double); ++b)
+            for (std::size_t k = 0; k < n; ++k)
+                out[b * n + k] = bytes[k * sizeof(double) + b];
+    }
+
+    static void unshuffle(const unsigned char* in, std::size_t n, double* out) {
+        unsigned char* bytes = reinterpret_cast<unsigned char*>(out);
+        for (std::size_t b = 0; b < sizeof(double); ++b)
+            for (std::size_t k = 0; k < n; ++k)
+                bytes[k * sizeof(double) + b] = in[b * n + k];
+    }
+
+    static std::vector<unsigned char> encode(const double* x, std::size_t n, int level) {
+        std::vector<unsigned char> shuffled(n * sizeof(double));
+        shuffle(x, n, shuffled.data());
+        uLongf size = compressBound(static_cast<uLong>(shuffled.size()));
+        std::vector<unsigned char> packed(size);
+        if (compress2(packed.data(), &size, shuffled.data(), static_cast<uLong>(shuffled.size()), level) != Z_OK)
+            throw std::runtime_error("ExperimentStore: compression failed");
+        packed.resize(size);
+        return packed;
+    }
+
+    static void decode(const unsigned char* packed, std::size_t packed_size, std::size_t n, double* out,
+                       std::vector<unsigned char>& scratch) {
+        scratch.resize(n * sizeof(double));
+        uLongf size = static_cast<uLongf>(scratch.size());
+        if (uncompress(scratch.data(), &size, packed, static_cast<uLong>(packed_size)) != Z_OK ||
+            size != scratch.size())
+            throw std::runtime_error("ExperimentStore: corrupt block");
+        unshuffle(scratch.data(), n, out);
+    }
+};
+
+// Owning file descriptor, closed when it goes out of scope, so a constructor
+// or loader that throws half-way does not leak it.
+class FileDescriptor {
+private:
+    int fd = -1;
+
+public:
+    explicit FileDescriptor(int fd = -1) : fd(fd) {}
+
+    ~FileDescriptor() { reset(); }
+
+    FileDescriptor(const FileDescriptor&) = delete;
+    FileDescriptor& operator=(const FileDescriptor&) = delete;
+
+    int get() const { return fd; }
+
+    bool is_open() const { return fd >= 0; }
+
+    void reset(int other = -1) {
+        if (fd >= 0)
+            ::close(fd);
+        fd = other;
+    }
+};
+
+// Streaming writer: append channel-major chunks of any length; full blocks
+// are compressed (channels in parallel) and written as they complete.
+class StoreWriter {
+private:
+    static constexpr char magic[9] = "CCSTORE1";
+
+    FileDescriptor file;
+    std::uint64_t position = 0;
+    std::uint32_t channel_count;
+    std::uint32_t block_samples;
+    std::uint64_t samples = 0;
+    std::uint64_t samples_field = 0;        // file offset of the sample count
+    int level;
+    unsigned threads;
+    std::vector<std::vector<double>> pending;
+    std::vector<std::vector<BlockInfo>> directory;
+
+    void put(const void* data, std::size_t n) {
+        FileIO::write_all(file.get(), data, n, position);
+        position += n;
+    }
+
+    // Compresses one block per channel starting at rows[c] and writes them in channel order
+    void flush_block(const std::vector<const double*>& rows, std::size_t count) {
+        std::vector<std::vector<unsigned char>> packed(channel_count);
+        std::vector<BlockInfo> info(channel_count);
+        parallel_for(channel_count, threads, [&](std::size_t c, unsigned) {
+            const double* x = rows[c];
+            double lo = std::numeric_limits<double>::infinity(), hi = -lo, ss = 0.0;
+            for (std::size_t k = 0; k < count; ++k) {
+                lo = std::min(lo, x[k]);
+                hi = std::max(hi, x[k]);
+                ss += x[k] * x[k];
+            }
+            packed[c] = BlockCodec::encode(x, count, level);
+            info[c] = {0, static_cast<std::uint32_t>(packed[c].size()), static_cast<std::uint32_t>(count), lo, hi,
+                       std::sqrt(ss / static_cast<double>(count))};
+        });
+        for (std::size_t c = 0; c < channel_count; ++c) {
+            info[c].offset = position;
+            put(packed[c].data(), packed[c].size());
+            directory[c].push_back(info[c]);
+        }
+    }
+
+    void flush_pending() {
+        std::vector<const double*> rows(channel_count);
+        for (std::size_t c = 0; c < channel_count; ++c)
+            rows[c] = pending[c].data();
+        flush_block(rows, pending[0].size());
+        for (auto& p : pending)
+            p.clear();
+    }
+
+public:
+    StoreWriter(const std::string& path, std::size_t channels, double fs, std::size_t block_samples = 4096,
+                const std::vector<std::string>& names = {}, int level = 1, unsigned threads = 0)
+        : channel_count(static_cast<std::uint32_t>(channels)),
+          block_samples(static_cast<std::uint32_t>(block_samples)), level(level), threads(threads), pending(channels), directory(channels) {
+        if (channels == 0 || block_samples == 0)
+            throw std::invalid_argument("StoreWriter: need channels and a block size");
+        if (!names.empty() && names.size() != channels)
+            throw std::invalid_argument("StoreWriter: one name per channel");
+        file.reset(::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644));
+        if (!file.is_open())
+            throw std::runtime_error("cannot create " + path);
+
+        put(magic, 8);
+        put(&channel_count, 4);
+        put(&this->block_samples, 4);
+        samples_field = position;
+        put(&samples, 8);
+        put(&fs, 8);
+        for (std::size_t c = 0; c < channels; ++c) {
+            std::string name = names.empty() ? "ch" + std::to_string(c) : names[c];
+            std::uint32_t length = static_cast<std::uint32_t>(name.size());
+            put(&length, 4);
+            put(name.data(), name.size());
+        }
+    }
+
+    ~StoreWriter() {
+        try {
+            close();
+        } catch (...) {
+        }
+    }
+
+    StoreWriter(const StoreWriter&) = delete;
+    StoreWriter& operator=(const StoreWriter&) = delete;
+
+    std::size_t channels() const { return channel_count; }
+
+    // data[channel * count + k]. Whole blocks are compressed straight from
+    // `data`; only a partial block is kept back until the next call.
+    void append(const double* data, std::size_t count) {
+        if (!file.is_open())
+            throw std::logic_error("StoreWriter: already closed");
+        std::size_t at = 0;
+        if (!pending[0].empty()) {
+            at = std::min<std::size_t>(count, block_samples - pending[0].size());
+            for (std::size_t c = 0; c < channel_count; ++c)
+                pending[c].insert(pending[c].end(), data + c * count, data + c * count + at);
+            if (pending[0].size() == block_samples)
+                flush_pending();
+        }
+        std::vector<const double*> rows(channel_count);
+        for (; count - at >= block_samples; at += block_samples) {
+            for (std::size_t c = 0; c < channel_count; ++c)
+                rows[c] = data + c * count + at;
+            flush_block(rows, block_samples);
+        }
+        for (std::size_t c = 0; c < channel_count; ++c)
+            pending[c].insert(pending[c].end(), data + c * count + at, data + (c + 1) * count);
+        samples += count;
+    }
+
+    void close() {
+        if (!file.is_open())
+            return;
+        if (!pending[0].empty())
+            flush_pending();
+        const std::uint64_t directory_offset = position;
+        for (const auto& blocks : directory)
+            put(blocks.data(), blocks.size() * sizeof(BlockInfo));
+        put(&directory_offset, 8);
+        put(magic, 8);
+        FileIO::write_all(file.get(), &samples, 8, samples_field);
+        file.reset();
+    }
+};
+
+// Memory-mapped reader. Windows decompress only the blocks they overlap, in
+// parallel across channels; summaries come from the directory alone.
+class StoreReader {
+private:
+    std::shared_ptr<const MappedFile> file;
+    std::uint32_t channels = 0;
+    std::uint32_t block_samples = 0;
+    std::uint64_t samples = 0;
+    double fs = 0.0;
+    std::vector<std::string> names;
+    std::vector<BlockInfo> directory;     // [channel][block]
+    std::size_t n_blocks = 0;
+
+    template <typename T>
+    T get(std::size_t& at) const {
+        if (at + sizeof(T) > file->size())
+            throw std::runtime_error("ExperimentStore: truncated file");
+        T v;
+        std::memcpy(&v, file->data() + at, sizeof(T));
+        at += sizeof(T);
+        return v;
+    }
+
+public:
+    explicit StoreReader(const std::string& path) : file(std::make_shared<const MappedFile>(path)) {
+        const unsigned char* p = file->data();
+        const std::size_t n = file->size();
+        if (n < 40 || std::memcmp(p, "CCSTORE1", 8) != 0 || std::memcmp(p + n - 8, "CCSTORE1", 8) != 0)
+            throw std::runtime_error(path + " is not a closed experiment store");
+        std::size_t at = 8;
+        channels = get<std::uint32_t>(at);
+        block_samples = get<std::uint32_t>(at);
+        samples = get<std::uint64_t>(at);
+        fs = get<double>(at);
+        for (std::uint32_t c = 0; c < channels; ++c) {
+            std::uint32_t length = get<std::uint32_t>(at);
+            if (at + length > n)
+                throw std::runtime_error("ExperimentStore: truncated file");
+            names.emplace_back(reinterpret_cast<const char*>(p + at), length);
+            at += length;
+        }
+        n_blocks = static_cast<std::size_t>((samples + block_samples - 1) / block_samples);
+        std::size_t directory_at = n - 16;
+        directory_at = static_cast<std::size_t>(get<std::uint64_t>(directory_at));
+        if (directory_at + channels * n_blocks * sizeof(BlockInfo) > n - 16)
+            throw std::runtime_error("ExperimentStore: bad directory");
+        directory.resize(channels * n_blocks);
+        std::memcpy(directory.data(), p + directory_at, directory.size() * sizeof(BlockInfo));
+        // Blocks lie between the header and the directory
+        for (const auto& info : directory)
+            if (info.offset < at || info.offset > directory_at || info.compressed_size > directory_at - info.offset)
+                throw std::runtime_error("ExperimentStore: block outside the file");
+    }
+
+    std::size_t n_channels() const { return channels; }
+    std::size_t n_samples() const { return samples; }
+    std::size_t block_size() const { return block_samples; }
+    std::size_t blocks() const { return n_blocks; }
+    double sample_rate() const { return fs; }
+    const std::vector<std::string>& channel_names() const { return names; }
+
+    const BlockInfo& block(std::size_t channel, std::size_t index) const {
+        return directory[channel * n_blocks + index];
+    }
+
+    // Samples [begin, end) of the given channels into out[i * (end - begin) + k]
+    void read(const std::vector<std::size_t>& which, std::size_t begin, std::size_t end, double* out,
+              unsigned threads = 0) const {
+        if (begin > end || end > samples)
+            throw std::out_of_range("ExperimentStore: window outside the record");
+        for (std::size_t c : which)
+            if (c >= channels)
+                throw std::out_of_range("ExperimentStore: channel index out of range");
+        const std::size_t width = end - begin;
+        if (width == 0)
+            return;
+        const std::size_t first = begin / block_samples, last = (end - 1) / block_samples;
+        const std::size_t tasks = which.size() * (last - first + 1);
+        const unsigned workers = resolve_threads(threads, tasks);
+        std::vector<std::vector<double>> block_buffer(workers);
+        std::vector<std::vector<unsigned char>> scratch(workers);
+        parallel_for(tasks, workers, [&](std::size_t t, unsigned w) {
+            const std::size_t i = t / (last - first + 1), b = first + t % (last - first + 1);
+            const BlockInfo& info = block(which[i], b);
+            const std::size_t start = b * block_samples;
+            std::vector<double>& x = block_buffer[w];
+            x.resize(info.count);
+            BlockCodec::decode(file->data() + info.offset, info.compressed_size, info.count, x.data(), scratch[w]);
+            const std::size_t lo = std::max(begin, start), hi = std::min(end, start + info.count);
+            std::copy(x.begin() + static_cast<std::ptrdiff_t>(lo - start),
+                      x.begin() + static_cast<std::ptrdiff_t>(hi - start), out + i * width + (lo - begin));
+        });
+    }
+
+    // Whole store as a ChunkSource for the out-of-core stages
+    ChunkSource source(unsigned threads = 0) const {
+        ChunkSource s;
+        s.channels = channels;
+        s.samples = samples;
+        std::vector<std::size_t> all(channels);
+        for (std::size_t c = 0; c < channels; ++c)
+            all[c] = c;
+        s.read = [this, all, threads](std::size_t begin, std::size_t count, double* out) {
+            read(all, begin, begin + count, out, threads);
+        };
+        return s;
+    }
+};
+
+// Copies a chunked source (e.g. an .npy record) into a store in one pass.
+inline void write_store(const ChunkSource& source, const std::string& path, double fs,
+                        std::size_t block_samples = 4096, const std::vector<std::string>& names = {}, int level = 1,
+                        std::size_t chunk = 1 << 20, unsigned threads = 0) {
+    const std::size_t C = source.channels, n = source.samples;
+    const std::size_t n_chunks = (n + chunk - 1) / chunk;
+    StoreWriter writer(path, C, fs, block_samples, names, level, threads);
+    PrefetchReader reader([&](std::size_t c, std::vector<double>& buffer) {
+        const std::size_t count = std::min(chunk, n - c * chunk);
+        buffer.resize(C * count);
+        source.read(c * chunk, count, buffer.data());
+    }, n_chunks);
+    for (std::size_t c = 0; c < n_chunks; ++c)
+        writer.append(reader.next()->data(), std::min(chunk, n - c * chunk));
+    writer.close();
+}
+
+// Chunked source over an .npy file, an .npz member or a store (.ccs), picked by
+// extension; time_axis < 0 counts from the end like NumPy.
+inline ChunkSource open_record(const std::string& path, const std::string& member = "", int time_axis = -1) {
+    if (path.size() > 4 && path.compare(path.size() - 4, 4, ".ccs") == 0) {
+        auto store = std::make_shared<const StoreReader>(path);
+        ChunkSource source = store->source();
+        auto inner = source.read;
+        source.read = [store, inner](std::size_t begin, std::size_t count, double* out) { inner(begin, count, out); };
+        return source;
+    }
+    NpyArray array = member.empty() ? load_npy(path) : NpzArchive(path).load(member);
+    const int ndim = static_cast<int>(array.shape.size());
+    const int axis = time_axis < 0 ? time_axis + ndim : time_axis;
+    if (axis < 0 || axis >= ndim)
+        throw std::invalid_argument("time_axis out of range");
+    return npy_source(array, static_cast<std::size_t>(axis));
+}
+
+// Sidecar event index, kept sorted by sample so windows are found by binary search.
+class EventIndex {
+private:
+    static constexpr char magic[9] = "CCEVENT1";
+    std::vector<StoredEvent> entries;
+
+public:
+    EventIndex() = default;
+
+    static std::string sidecar(const std::string& store_path) { return store_path + ".events"; }
+
+    static EventIndex load(const std::string& path) {
+        EventIndex index;
+        FileDescriptor file(::open(path.c_str(), O_RDONLY));
+        if (!file.is_open())
+            return index;
+        struct stat st;
+        if (::fstat(file.get(), &st) != 0)
+            throw std::runtime_error("cannot stat " + path);
+        const std::size_t n = static_cast<std::size_t>(st.st_size);
+        char head[8];
+        if (n < 8 || (n - 8) % sizeof(StoredEvent) != 0)
+            throw std::runtime_error(path + " is not an event index");
+        FileIO::read_all(file.get(), head, 8, 0);
+        if (std::memcmp(head, magic, 8) != 0)
+            throw std::runtime_error(path + " is not an event index");
+        index.entries.resize((n - 8) / sizeof(StoredEvent));
+        FileIO::read_all(file.get(), index.entries.data(), index.entries.size() * sizeof(StoredEvent), 8);
+        return index;
+    }
+
+    void save(const std::string& path) const {
+        FileDescriptor file(::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644));
+        if (!file.is_open())
+            throw std::runtime_error("cannot create " + path);
+        FileIO::write_all(file.get(), magic, 8, 0);
+        FileIO::write_all(file.get(), entries.data(), entries.size() * sizeof(StoredEvent), 8);
+    }
+
+    void add(const StoredEvent& e) {
+        auto at = std::upper_bound(entries.begin(), entries.end(), e.sample,
+                                   [](std::uint64_t s, const StoredEvent& x) { return s < x.sample; });
+        entries.insert(at, e);
+    }
+
+    std::size_t size() const { return entries.size(); }
+    const StoredEvent& operator[](std::size_t i) const { return entries[i]; }
+    const std::vector<StoredEvent>& all() const { return entries; }
+
+    // Index range of events with begin <= sample < end
+    std::pair<std::size_t, std::size_t> between(std::uint64_t begin, std::uint64_t end) const {
+        auto key = [](const StoredEvent& x, std::uint64_t s) { return x.sample < s; };
+        auto lo = std::lower_bound(entries.begin(), entries.end(), begin, key);
+        auto hi = std::lower_bound(lo, entries.end(), end, key);
+        return {static_cast<std::size_t>(lo - entries.begin()), static_cast<std::size_t>(hi - entries.begin())};
+    }
+};
+
+#endif
@@ -0,0 +1,138 @@
+#ifndef FFT_HH
+#define FFT_HH
+
+#include <complex>
+#include <cmath>
+#include <vector>
+#include <memory>
+#include <cstddef>
+#include <stdexcept>
+
+// Reusable complex FFT plan of fixed length. Power-of-two lengths use an
+// iterative radix-2 transform; any other length goes through Bluestein's
+// chirp-z algorithm on top of a power-of-two plan, so results follow the
+// numpy.fft conventions for every n (forward unscaled, inverse scaled by 1/n).
+// A plan is immutable after construction and may be shared between threads.
+class FFTPlan {
+private:
+    using cd = std::complex<double>;
+    static constexpr double PI = M_PI;
+
+    std::size_t n;
+    bool radix2;
+
+    std::vector<cd> twiddles;            // exp(-2 pi i k / n), k < n/2
+    std::vector<std::size_t> bitrev;
+
+    std::vector<cd> chirp;               // exp(i pi k^2 / n)
+    std::vector<cd> chirp_spectrum;      // FFT of the chirp filter
+    std::unique_ptr<FFTPlan> inner;
+
+    void transform_radix2(cd* data, bool inverse) const {
+        for (std::size_t i = 0; i < n; ++i) {
+            std::size_t j = bitrev[i];
+            if (i < j)
+                std::swap(data[i], data[j]);
+        }
+        for (std::size_t len = 2; len <= n; len <<= 1) {
+            const std::size_t half = len >> 1;
+            const std::size_t step = n / len;
+            for (std::size_t i = 0; i < n; i += len) {
+                for (std::size_t j = 0; j < half; ++j) {
+                    cd w = twiddles[j * step];
+                    if (inverse)
+                        w = std::conj(w);
+                    cd u = data[i + j];
+                    cd v = data[i + j + half] * w;
+                    data[i + j] = u + v;
+                    data[i + j + half] = u - v;
+                }
+            }
+        }
+    }
+
+    void transform_bluestein(cd* data, bool inverse) const {
+        const std::size_t m = inner->size();
+        std::vector<cd> work(m, cd(0.0, 0.0));
+        for (std::size_t k = 0; k < n; ++k) {
+            cd c = inverse ? chirp[k] : std::conj(chirp[k]);
+            work[k] = data[k] * c;
+        }
+        inner->forward(work.data());
+        for (std::size_t k = 0; k < m; ++k)
+            work[k] *= inverse ? std::conj(chirp_spectrum[k]) : chirp_spectrum[k];
+        inner->inverse(work.data());
+        for (std::size_t k = 0; k < n; ++k) {
+            cd c = inverse ? chirp[k] : std::conj(chirp[k]);
+            data[k] = work[k] * c;
+        }
+    }
+
+public:
+    explicit FFTPlan(std::size_t n) : n(n), radix2(is_pow2(n)) {
+        if (n == 0)
+            throw std::invalid_argument("FFTPlan: zero length");
+        if (radix2) {
+            twiddles.resize(n / 2);
+            for (std::size_t k = 0; k < n / 2; ++k)
+                twiddles[k] = std::polar(1.0, -2.0 * PI * static_cast<double>(k) / static_cast<double>(n));
+            bitrev.resize(n);
+            std::size_t bits = 0;
+            while ((std::size_t(1) << bits) < n)
+                ++bits;
+            for (std::size_t i = 0; i < n; ++i) {
+                std::size_t r = 0;
+                for (std::size_t b = 0; b < bits; ++b)
+                    r |= ((i >> b) & 1) << (bits - 1 - b);
+                bitrev[i] = r;
+            }
+            return;
+        }
+
+        const std::size_t m = next_pow2(2 * n - 1);
+        inner = std::make_unique<FFTPlan>(m);
+        chirp.resize(n);
+        for (std::size_t k = 0; k < n; ++k) {
+            // k^2 mod 2n keeps the phase argument small for long transforms
+            std::size_t k2 = (k * k) % (2 * n);
+            chirp[k] = std::polar(1.0, PI * static_cast<double>(k2) / static_cast<double>(n));
+        }
+        chirp_spectrum.assign(m, cd(0.0, 0.0));
+        chirp_spectrum[0] = chirp[0];
+        for (std::size_t k = 1; k < n; ++k) {
+            chirp_spectrum[k] = chirp[k];
+            chirp_spectrum[m - k] = chirp[k];
+        }
+        inner->forward(chirp_spectrum.data());
+    }
+
+    static bool is_pow2(std::size_t n) { return n != 0 && (n & (n - 1)) == 0; }
+
+    static std::size_t next_pow2(std::size_t n) {
+        std::size_t p = 1;
+        while (p < n)
+            p <<= 1;
+        return p;
+    }
+
+    std::size_t size() const { return n; }
+
+    void forward(cd* data) const {
+        if (radix2)
+            transform_radix2(data, false);
+        else
+            transform_bluestein(data, false);
+    }
+
+    void inverse(cd* data) const {
+        if (radix2)
+            transform_radix2(data, true);
+        else
+            transform_bluestein(data, true);
+        const double scale = 1.0 / static_cast<double>(n);
+        for (std::size_t k = 0; k < n; ++k)
+            data[k] *= scale;
+    }
+};
+
+#endif
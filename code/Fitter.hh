@@ -0,0 +1,182 @@
+#ifndef FITTER_HH
+#define FITTER_HH
+
+#include "CohesiveCrack.hh"
+#include "TemplateIndex.hh"
+
+#include <vector>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include <cstddef>
+
+struct FitResult {
+    double C_f;
+    double X_c;
+    double Gamma;
+    double shift;                 // t0 offset from the window center, samples
+    double chi2;                  // sum of squared demeaned residuals
+    std::size_t evaluations;
+    std::size_t seed_template;
+    int polarity;
+};
+
+// Least-squares fit of (C_f, X_c, Gamma, t0) to one aligned gauge window with
+// y and the material fixed. The minimizer is a plain Nelder-Mead simplex on
+// (C_f, log X_c, log Gamma, shift); it is meant to polish starting points
+// taken from a TemplateIndex rather than to search the whole space.
+class TraceFitter {
+private:
+    using Point = std::array<double, 4>;
+
+    StressComponent component;
+    const double* data;
+    std::size_t n;
+    double fs;
+    double center;
+    ModelParameters base;
+    int polarity;
+    std::vector<double> model;
+    std::size_t evaluations = 0;
+
+    double objective(const Point& v) {
+        ++evaluations;
+        ModelParameters p = base;
+        p.C_f = v[0];
+        p.X_c = std::exp(v[1]);
+        p.Gamma = std::exp(v[2]);
+        if (!(p.C_f > 0.0 && p.C_f < p.C_s))
+            return std::numeric_limits<double>::max();
+
+        double t0 = center + v[3];
+        double mean_d = 0.0, mean_m = 0.0;
+        for (std::size_t k = 0; k < n; ++k) {
+            double x = p.C_f * (t0 - static_cast<double>(k)) / fs;
+            double m = component == StressComponent::xy
+                ? StressAnalysis::delta_sigma_xy(x, p.y, p.X_c, p.C_f, p.C_s, p.C_d, p.nu, p.Gamma, p.E)
+                : StressAnalysis::delta_sigma_xx(x, p.y, p.X_c, p.C_f, p.C_s, p.C_d, p.nu, p.Gamma, p.E);
+            model[k] = polarity * m;
+            mean_d += data[k];
+            mean_m += model[k];
+        }
+        mean_d /= static_cast<double>(n);
+        mean_m /= static_cast<double>(n);
+        double chi2 = 0.0;
+        for (std::size_t k = 0; k < n; ++k) {
+            double r = (data[k] - mean_d) - (model[k] - mean_m);
+            chi2 += r * r;
+        }
+        return std::isfinite(chi2) ? chi2 : std::numeric_limits<double>::max();
+    }
+
+public:
+    TraceFitter(StressComponent component, const double* data, std::size_t n, double fs,
+                double center, const ModelParameters& base, int polarity = 1)
+        : component(component), data(data), n(n), fs(fs), center(center), base(base), polarity(polarity), model(n) {}
+
+    FitResult fit(double C_f, double X_c, double Gamma, std::size_t max_evaluations = 2000,
+                  double tolerance = 1e-10) {
+        evaluations = 0;
+        Point start{C_f, std::log(X_c), std::log(Gamma), 0.0};
+        Point step{0.05 * C_f, 0.2, 0.2, 1.0};
+
+        std::array<Point, 5> simplex;
+        std::array<double, 5> value;
+        simplex[0] = start;
+        for (std::size_t i = 0; i < 4; ++i) {
+            simplex[i + 1] = start;
+            simplex[i + 1][i] += step[i];
+        }
+        for (std::size_t i = 0; i < 5; ++i)
+            value[i] = objective(simplex[i]);
+
+        while (evaluations < max_evaluations) {
+            std::array<std::size_t, 5> idx{0, 1, 2, 3, 4};
+            std::sort(idx.begin(), idx.end(), [&](std::size_t a, std::size_t b) { return value[a] < value[b]; });
+            const std::size_t best = idx[0], worst = idx[4], second = idx[3];
+            if (std::abs(value[worst] - value[best]) <= tolerance * (std::abs(value[best]) + 1e-300))
+                break;
+
+            Point centroid{0.0, 0.0, 0.0, 0.0};
+            for (std::size_t i = 0; i < 4; ++i)
+                for (std::size_t d = 0; d < 4; ++d)
+                    centroid[d] += simplex[idx[i]][d] / 4.0;
+
+            auto along = [&](double t) {
+                Point p;
+                for (std::size_t d = 0; d < 4; ++d)
+                    p[d] = centroid[d] + t * (simplex[worst][d] - centroid[d]);
+                return p;
+            };
+
+            Point reflected = along(-1.0);
+            double f_reflected = objective(reflected);
+            if (f_reflected < value[best]) {
+                Point expanded = along(-2.0);
+                double f_expanded = objective(expanded);
+                if (f_expanded < f_reflected) {
+                    simplex[worst] = expanded;
+                    value[worst] = f_expanded;
+                } else {
+                    simplex[worst] = reflected;
+                    value[worst] = f_reflected;
+                }
+            } else if (f_reflected < value[second]) {
+                simplex[worst] = reflected;
+                value[worst] = f_reflected;
+            } else {
+                Point contracted = f_reflected < value[worst] ? along(-0.5) : along(0.5);
+                double f_contracted = objective(contracted);
+                if (f_contracted < std::min(f_reflected, value[worst])) {
+                    simplex[worst] = contracted;
+                    value[worst] = f_contracted;
+                } else {
+                    for (std::size_t i = 1; i < 5; ++i) {
+                        for (std::size_t d = 0; d < 4; ++d)
+                            simplex[idx[i]][d] = simplex[best][d] + 0.5 * (simplex[idx[i]][d] - simplex[best][d]);
+                        value[idx[i]] = objective(simplex[idx[i]]);
+                    }
+                }
+            }
+        }
+
+        std::size_t best = static_cast<std::size_t>(std::min_element(value.begin(), value.end()) - value.begin());
+        const Point& v = simplex[best];
+        return {v[0], std::exp(v[1]), std::exp(v[2]), v[3], value[best], evaluations, 0, polarity};
+    }
+};
+
+// Seeds TraceFitter with the k nearest templates and keeps the best fit.
+inline FitResult fit_from_index(const TemplateIndex& index, const TemplateBank& bank,
+                                const double* trace, std::size_t n, std::size_t k = 3) {
+    const StressComponent component = index.component();
+    FitResult best{};
+    best.chi2 = std::numeric_limits<double>::max();
+    for (const Neighbour& hit : index.query(trace, n, k)) {
+        const TemplateParameters& t = bank.parameters[hit.template_index];
+        ModelParameters base = bank.base;
+        base.y = t.y;
+
+        // Gamma from the amplitude of the trace against the raw template
+        const double* w = bank.waveform(component, hit.template_index);
+        double mean = 0.0;
+        for (std::size_t s = 0; s < n; ++s)
+            mean += trace[s];
+        mean /= static_cast<double>(n);
+        double projection = 0.0;
+        for (std::size_t s = 0; s < n; ++s)
+            projection += (trace[s] - mean) * w[s];
+        double a = projection / bank.norm(component, hit.template_index);
+        double Gamma = std::max(bank.base.Gamma * a * a, 1e-12 * bank.base.Gamma);
+
+        TraceFitter fitter(component, trace, n, bank.fs, static_cast<double>(bank.center), base, hit.polarity);
+        FitResult r = fitter.fit(t.C_f, t.X_c, Gamma);
+        r.seed_template = hit.template_index;
+        if (r.chi2 < best.chi2)
+            best = r;
+    }
+    return best;
+}
+
+#endif
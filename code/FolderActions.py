@@ -1,6 +1,7 @@
 import os
 import re
 import shutil
+import numpy as np
 
 def delete_pycache() -> None:
     current_directory = os.getcwd()
@@ -35,4 +36,39 @@ def read_materials(file_path):
             'parameters': params
         }
 
-    return materials
\ No newline at end of file
+    return materials
+
+
+PROBE_CHANNELS = ('strain', 'stress', 'vx', 'vy', 'vz')
+
+def read_probes(file_path):
+    """Memory-maps a probe time series written by the Akantu drivers (probes.hh).
+
+    Returns a dict with the gauge 'names', 'position' and 'direction' arrays of
+    shape (gauges, 3), 'time' of shape (records,), 'values' of shape
+    (records, gauges, channels) and one (records, gauges) array per channel in
+    PROBE_CHANNELS. The channel arrays are strided views
+    into the mapped file, so nothing is copied until they are used. A trailing
+    partial record (interrupted run) is ignored.
+    """
+    with open(file_path, 'rb') as f:
+        head = np.frombuffer(f.read(24), dtype=[('magic', 'S8'), ('gauges', '<u4'), ('channels', '<u4'), ('size', '<u8')])[0]
+        if head['magic'] != b'CCPROBE1':
+            raise ValueError(f"{file_path} is not a probe file")
+        n_gauges, n_channels, header_size = int(head['gauges']), int(head['channels']), int(head['size'])
+        gauges = np.frombuffer(f.read(header_size - 24), dtype=[('name', 'S32'), ('position', '<f8', 3), ('direction', '<f8', 3)])
+
+    record = np.dtype([('time', '<f8'), ('values', '<f4', (n_gauges, n_channels))])
+    n_records = (os.path.getsize(file_path) - header_size) // record.itemsize
+    data = np.memmap(file_path, dtype=record, mode='r', offset=header_size, shape=(n_records,))
+
+    probes = {
+        'names': [name.decode() for name in gauges['name']],
+        'position': gauges['position'].copy(),
+        'direction': gauges['direction'].copy(),
+        'time': data['time'],
+        'values': data['values'],
+    }
+    for k, channel in enumerate(PROBE_CHANNELS[:n_channels]):
+        probes[channel] = data['values'][:, :, k]
+    return probes
@@ -0,0 +1,129 @@
+import json
+import os
+
+import numpy as np
+
+import FolderActions
+
+GRAVITY = 9.80665
+
+def hertz_stf(t: np.ndarray, rho: float, R: float, v: float, E1: float, nu1: float, E2: float, nu2: float) -> tuple[np.ndarray, float, float]:
+    '''
+    Hertzian source-time function of a sphere impact (McLaskey 2009), the same
+    formula as hertz::stf in Akantu/Ball-Drop/Ball-Drop.cc, vectorised.
+
+    Args:
+        t (np.ndarray): Times (s).
+        rho (float): Target density (kg/m^3).
+        R (float): Sphere radius (m).
+        v (float): Impact velocity (m/s).
+        E1, nu1 (float): Sphere Young's modulus (Pa) and Poisson's ratio.
+        E2, nu2 (float): Target Young's modulus (Pa) and Poisson's ratio.
+
+    Returns:
+        tuple: (stf (N), fmax (N), tc (s)).
+    '''
+    del1 = (1 - nu1 ** 2) / (np.pi * E1)
+    del2 = (1 - nu2 ** 2) / (np.pi * E2)
+    tc = 4.53 * ((4 * rho * np.pi * (del1 + del2) / 3) ** (2 / 5)) * R * (v ** (-1 / 5))
+    fmax = 1.917 * (rho ** (3 / 5)) * ((del1 + del2) ** (-2 / 5)) * (R ** 2) * (v ** (6 / 5))
+
+    t = np.asarray(t, dtype=float)
+    stf = np.zeros_like(t)
+    inside = (t > 0) & (t < tc)
+    stf[inside] = fmax * np.sin(np.pi * t[inside] / tc) ** 1.5
+    return stf, fmax, tc
+
+class GreensFunction:
+    '''
+    Responses of a linear elastic Ball-Drop model to any vertical point load,
+    from one FEM run in Green's-function mode (`mode = green` in the run spec).
+
+    The explicit time stepping is linear and time-invariant, so with the force
+    sampled at the run's dt the response to f is the discrete convolution of
+    the stored unit-pulse response with f; for `pulse = impulse` this is exact.
+    A Gaussian pulse is first deconvolved with a water level. The spectra of
+    the stored responses are computed once, so each new drop height or radius
+    costs one FFT of the force and one inverse FFT.
+
+    Attributes:
+        dt (float): Time step of the run (s).
+        steps (int): Samples per response; sample n is at time (n + 1) * dt.
+        block (dict): Target 'rho', 'E', 'nu' (SI) from the run's material file.
+        probes (dict | None): FolderActions.read_probes() of the pulse response.
+        surface_nodes (np.ndarray | None): (nodes, 3) top-surface coordinates (mm); only
+            the modelled part of a half / quarter model, while probes are full-plate.
+    '''
+
+    def __init__(self, directory: str, water_level: float = 1e-3):
+        with open(os.path.join(directory, 'green.json')) as f:
+            meta = json.load(f)
+        self.directory = directory
+        self.dt = meta['dt']
+        self.block = meta['block']
+        self.load_node = np.asarray(meta['load_node'])
+        self.pulse = np.load(os.path.join(directory, 'green_pulse.npy'))
+        self.steps = len(self.pulse)
+        self.nfft = 1 << int(np.ceil(np.log2(2 * self.steps)))
+
+        self.probes = None
+        if meta.get('probes'):
+            self.probes = FolderActions.read_probes(os.path.join(directory, meta['probes']))
+        self.surface_nodes = None
+        self.surface = {}
+        if os.path.exists(os.path.join(directory, 'surface_uz.npy')):
+            self.surface_nodes = np.load(os.path.join(directory, 'surface_nodes.npy'))
+            for key in ('uz', 'vz'):
+                self.surface[key] = np.load(os.path.join(directory, f'surface_{key}.npy'), mmap_mode='r')
+
+        # Inverse of the applied pulse; 1 for a unit impulse in the first step
+        P = np.fft.rfft(self.pulse, self.nfft)
+        if meta['pulse'] == 'impulse':
+            self.inverse = np.ones_like(P)
+        else:
+            floor = (water_level * np.abs(P).max()) ** 2
+            self.inverse = np.conj(P) / np.maximum(np.abs(P) ** 2, floor)
+        self._spectra = {}
+
+    def _spectrum(self, key: str) -> np.ndarray:
+        if key not in self._spectra:
+            if key == 'probes':
+                values = np.asarray(self.probes['values'][:self.steps], dtype=float)
+                data = values.reshape(values.shape[0], -1)
+            else:
+                data = np.asarray(self.surface[key][:self.steps], dtype=float)
+            self._spectra[key] = np.fft.rfft(data, self.nfft, axis=0) * self.inverse[:, None]
+        return self._spectra[key]
+
+    def time(self) -> np.ndarray:
+        return (np.arange(self.steps) + 1) * self.dt
+
+    def hertz_force(self, h: float, R: float = 1e-3, E_ball: float = 208.197e9, nu_ball: float = 0.286,
+                    scale: float = 1.0) -> np.ndarray:
+        '''Hertz STF of a drop from height h (m) sampled like the driver, f[n] = stf(n dt).'''
+        v = np.sqrt(2 * GRAVITY * h)
+        stf, _, _ = hertz_stf(np.arange(self.steps) * self.dt, self.block['rho'], R, v,
+                              E_ball, nu_ball, self.block['E'], self.block['nu'])
+        return scale * stf
+
+    def convolve(self, force: np.ndarray) -> dict:
+        '''
+        Responses to a downward point load force[n] (N) applied in step n.
+
+        Returns:
+            dict: 'time', one (steps, gauges) array per probe channel under
+            'probes', and (steps, nodes) 'surface_uz' / 'surface_vz' when stored.
+        '''
+        F = np.fft.rfft(np.asarray(force, dtype=float)[:self.steps], self.nfft)
+        out = {'time': self.time()}
+        if self.probes is not None:
+            y = np.fft.irfft(self._spectrum('probes') * F[:, None], self.nfft, axis=0)[:self.steps]
+            y = y.reshape(self.steps, len(self.probes['names']), -1)
+            out['probes'] = {channel: y[:, :, k] for k, channel in enumerate(FolderActions.PROBE_CHANNELS[:y.shape[2]])}
+        for key in self.surface:
+            out[f'surface_{key}'] = np.fft.irfft(self._spectrum(key) * F[:, None], self.nfft, axis=0)[:self.steps]
+        return out
+
+    def drop(self, h: float, R: float = 1e-3, **kwargs) -> dict:
+        '''Responses to the Hertzian impact of a sphere of radius R (m) dropped from h (m).'''
+        return self.convolve(self.hertz_force(h, R, **kwargs))
@@ -0,0 +1,261 @@
+#ifndef IIR_FILTER_HH
+#define IIR_FILTER_HH
+
+#include "Parallel.hh"
+
+#include <vector>
+#include <complex>
+#include <cmath>
+#include <cstddef>
+#include <algorithm>
+#include <stdexcept>
+
+enum class FilterType { lowpass, highpass, bandpass };
+
+// One second-order section, a0 = 1. First-order sections have b2 = a2 = 0.
+struct Biquad {
+    double b0, b1, b2;
+    double a1, a2;
+};
+
+// Cascade of second-order sections, as scipy.signal's output='sos'.
+class SecondOrderSections {
+public:
+    std::vector<Biquad> sections;
+
+    std::size_t size() const { return sections.size(); }
+
+    // Digital Butterworth filter following scipy.signal.butter: analog
+    // prototype, frequency transform on the prewarped edges, bilinear
+    // transform at fs = 2. Frequencies are in the same unit as fs; `high` is
+    // only used by band-pass designs. Poles are paired by conjugates, so the
+    // sections can differ from scipy's zpk2sos ordering but the cascade (and
+    // anything filtered by it) is the same.
+    static SecondOrderSections butterworth(std::size_t order, FilterType type, double fs, double low, double high = 0.0) {
+        using cd = std::complex<double>;
+        const double PI = M_PI;
+        if (order == 0)
+            throw std::invalid_argument("butterworth: order must be positive");
+        const double nyquist = 0.5 * fs;
+        if (!(low > 0.0 && low < nyquist) || (type == FilterType::bandpass && !(high > low && high < nyquist)))
+            throw std::invalid_argument("butterworth: critical frequencies must lie in (0, fs/2)");
+
+        const std::size_t N = order;
+        std::vector<cd> p;                        // analog prototype, unit cutoff
+        for (std::size_t k = 0; k < N; ++k) {
+            double m = -static_cast<double>(N) + 1.0 + 2.0 * static_cast<double>(k);
+            p.push_back(-std::exp(cd(0.0, PI * m / (2.0 * static_cast<double>(N)))));
+        }
+        auto warp = [&](double f) { return 4.0 * std::tan(PI * (f / nyquist) / 2.0); };
+
+        std::vector<cd> z;
+        double gain = 1.0;
+        if (type == FilterType::lowpass) {
+            const double wo = warp(low);
+            for (auto& v : p)
+                v *= wo;
+            gain = std::pow(wo, static_cast<double>(N));
+        } else if (type == FilterType::highpass) {
+            const double wo = warp(low);
+            cd prod(1.0, 0.0);
+            for (auto& v : p) {
+                prod *= -v;
+                v = wo / v;
+            }
+            gain = (1.0 / prod).real();
+            z.assign(N, cd(0.0, 0.0));
+        } else {
+            const double w1 = warp(low), w2 = warp(high);
+            const double bw = w2 - w1, wo = std::sqrt(w1 * w2);
+            std::vector<cd> bp;
+            for (const auto& v : p) {
+                cd lp = v * (bw / 2.0);
+                cd root = std::sqrt(lp * lp - wo * wo);
+                bp.push_back(lp + root);
+                bp.push_back(lp - root);
+            }
+            p = std::move(bp);
+            gain = std::pow(bw, static_cast<double>(N));
+            z.assign(N, cd(0.0, 0.0));
+        }
+
+        // Bilinear transform, fs = 2
+        const double fs2 = 4.0;
+        cd num(1.0, 0.0), den(1.0, 0.0);
+        for (auto& v : z) {
+            num *= fs2 - v;
+            v = (fs2 + v) / (fs2 - v);
+        }
+        for (auto& v : p) {
+            den *= fs2 - v;
+            v = (fs2 + v) / (fs2 - v);
+        }
+        gain *= (num / den).real();
+        std::vector<double> plus, minus;          // digital zeros are all at +1 or -1
+        for (const auto& v : z)
+            (v.real() > 0.0 ? plus : minus).push_back(v.real());
+        minus.resize(minus.size() + p.size() - z.size(), -1.0);
+
+        // Conjugate pairs first, then real poles two by two, a lone real pole last
+        std::vector<cd> complex_poles;
+        std::vector<double> real_poles;
+        for (const auto& v : p) {
+            if (std::abs(v.imag()) <= 1e-12 * std::max(1.0, std::abs(v)))
+                real_poles.push_back(v.real());
+            else if (v.imag() > 0.0)
+                complex_poles.push_back(v);
+        }
+        // Alternate +1 / -1 zeros so band-pass sections do not stack zeros at DC
+        auto next_zero = [&]() {
+            std::vector<double>& from = plus.size() >= minus.size() ? plus : minus;
+            double v = from.back();
+            from.pop_back();
+            return v;
+        };
+
+        SecondOrderSections sos;
+        for (const auto& v : complex_poles) {
+            double z1 = next_zero(), z2 = next_zero();
+            sos.sections.push_back({1.0, -(z1 + z2), z1 * z2, -2.0 * v.real(), std::norm(v)});
+        }
+        for (std::size_t i = 0; i + 1 < real_poles.size(); i += 2) {
+            double z1 = next_zero(), z2 = next_zero();
+            double p1 = real_poles[i], p2 = real_poles[i + 1];
+            sos.sections.push_back({1.0, -(z1 + z2), z1 * z2, -(p1 + p2), p1 * p2});
+        }
+        if (real_poles.size() % 2 == 1)
+            sos.sections.push_back({1.0, -next_zero(), 0.0, -real_poles.back(), 0.0});
+
+        Biquad& first = sos.sections.front();
+        first.b0 *= gain;
+        first.b1 *= gain;
+        first.b2 *= gain;
+        return sos;
+    }
+
+    // Per-section state reached after a long unit step, as scipy.signal.sosfilt_zi.
+    std::vector<double> steady_state() const {
+        std::vector<double> zi(2 * sections.size());
+        double scale = 1.0;
+        for (std::size_t s = 0; s < sections.size(); ++s) {
+            const Biquad& q = sections[s];
+            double y = (q.b0 + q.b1 + q.b2) / (1.0 + q.a1 + q.a2);
+            zi[2 * s] = scale * (y - q.b0);
+            zi[2 * s + 1] = scale * (q.b2 - q.a2 * y);
+            scale *= y;
+        }
+        return zi;
+    }
+
+    // Edge padding used by scipy.signal.sosfiltfilt
+    std::size_t padlen() const {
+        std::size_t b_first = 0, a_first = 0;
+        for (const auto& q : sections) {
+            b_first += q.b2 == 0.0;
+            a_first += q.a2 == 0.0;
+        }
+        return 3 * (2 * sections.size() + 1 - std::min(b_first, a_first));
+    }
+};
+
+// Streaming transposed direct form II cascade for one channel. The state
+// carries over between process() calls, so a long record may be fed in
+// arbitrary chunks. Samples are run through one section at a time over short
+// blocks, which keeps each section's loop tight and the block in L1.
+class IIRFilter {
+private:
+    static constexpr std::size_t block = 2048;
+
+    SecondOrderSections sos;
+    std::vector<double> state;    // z1, z2 per section
+
+public:
+    explicit IIRFilter(SecondOrderSections sos) : sos(std::move(sos)), state(2 * this->sos.size(), 0.0) {}
+
+    const SecondOrderSections& sections() const { return sos; }
+
+    void reset() { std::fill(state.begin(), state.end(), 0.0); }
+
+    // State of a filter that has seen the constant x0 forever
+    void reset_steady(double x0) {
+        state = sos.steady_state();
+        for (auto& v : state)
+            v *= x0;
+    }
+
+    const std::vector<double>& get_state() const { return state; }
+
+    void set_state(const std::vector<double>& values) {
+        if (values.size() != state.size())
+            throw std::invalid_argument("IIRFilter: state size mismatch");
+        state = values;
+    }
+
+    // out may alias in
+    void process(const double* in, std::size_t n, double* out) {
+        for (std::size_t start = 0; start < n; start += block) {
+            const std::size_t count = std::min(block, n - start);
+            const double* src = in + start;
+            double* dst = out + start;
+            for (std::size_t s = 0; s < sos.size(); ++s) {
+                const Biquad q = sos.sections[s];
+                double z1 = state[2 * s], z2 = state[2 * s + 1];
+                for (std::size_t k = 0; k < count; ++k) {
+                    double x = src[k];
+                    double y = q.b0 * x + z1;
+                    z1 = q.b1 * x - q.a1 * y + z2;
+                    z2 = q.b2 * x - q.a2 * y;
+                    dst[k] = y;
+                }
+                state[2 * s] = z1;
+                state[2 * s + 1] = z2;
+                src = dst;
+            }
+            if (sos.size() == 0 && dst != src)
+                std::copy(src, src + count, dst);
+        }
+    }
+
+    // Forward-backward (zero-phase) filtering of one record, matching
+    // scipy.signal.sosfiltfilt with padtype='odd'. `work` is scratch space,
+    // grown as needed, so repeated calls do not allocate.
+    static void filtfilt(const SecondOrderSections& sos, const double* x, std::size_t n, double* out,
+                         std::vector<double>& work) {
+        const std::size_t edge = sos.padlen();
+        if (n <= edge)
+            throw std::invalid_argument("filtfilt: the record must be longer than padlen = " + std::to_string(edge));
+        const std::size_t m = n + 2 * edge;
+        work.resize(m);
+
+        // Odd extension about both end points
+        for (std::size_t k = 0; k < edge; ++k) {
+            work[k] = 2.0 * x[0] - x[edge - k];
+            work[edge + n + k] = 2.0 * x[n - 1] - x[n - 2 - k];
+        }
+        std::copy(x, x + n, work.begin() + static_cast<std::ptrdiff_t>(edge));
+
+        IIRFilter filter(sos);
+        filter.reset_steady(work[0]);
+        filter.process(work.data(), m, work.data());
+
+        std::reverse(work.begin(), work.end());
+        filter.reset_steady(work[0]);
+        filter.process(work.data(), m, work.data());
+
+        for (std::size_t k = 0; k < n; ++k)
+            out[k] = work[m - 1 - edge - k];
+    }
+};
+
+// filtfilt over every row of a [channel][sample] array, channels in parallel.
+// out may alias data.
+inline void filtfilt_channels(const SecondOrderSections& sos, const double* data, std::size_t channels,
+                              std::size_t samples, double* out, unsigned threads = 0) {
+    const unsigned workers = resolve_threads(threads, channels);
+    std::vector<std::vector<double>> scratch(workers);
+    parallel_for(channels, workers, [&](std::size_t c, unsigned w) {
+        IIRFilter::filtfilt(sos, data + c * samples, samples, out + c * samples, scratch[w]);
+    });
+}
+
+#endif
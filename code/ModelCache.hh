@@ -0,0 +1,207 @@
+#ifndef MODEL_CACHE_HH
+#define MODEL_CACHE_HH
+
+#include "CohesiveCrack.hh"
+
+#include <list>
+#include <unordered_map>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <cstring>
+#include <cstdint>
+#include <cstddef>
+
+// Thread-safe least-recently-used map. Values are handed out as shared
+// pointers, so an entry evicted by one thread stays valid for readers that
+// already hold it.
+template <typename Key, typename Value, typename Hash>
+class LRUCache {
+private:
+    using Entry = std::pair<Key, std::shared_ptr<const Value>>;
+
+    std::size_t capacity;
+    std::list<Entry> entries;     // most recently used first
+    std::unordered_map<Key, typename std::list<Entry>::iterator, Hash> lookup;
+    mutable std::mutex mutex;
+    std::size_t hits = 0;
+    std::size_t misses = 0;
+
+public:
+    explicit LRUCache(std::size_t capacity) : capacity(capacity) {}
+
+    std::shared_ptr<const Value> find(const Key& key) {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = lookup.find(key);
+        if (it == lookup.end()) {
+            ++misses;
+            return nullptr;
+        }
+        ++hits;
+        entries.splice(entries.begin(), entries, it->second);
+        return it->second->second;
+    }
+
+    std::shared_ptr<const Value> insert(const Key& key, Value value) {
+        auto stored = std::make_shared<const Value>(std::move(value));
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = lookup.find(key);
+        if (it != lookup.end()) {
+            entries.splice(entries.begin(), entries, it->second);
+            return it->second->second;
+        }
+        entries.emplace_front(key, stored);
+        lookup.emplace(key, entries.begin());
+        while (entries.size() > capacity) {
+            lookup.erase(entries.back().first);
+            entries.pop_back();
+        }
+        return stored;
+    }
+
+    void clear() {
+        std::lock_guard<std::mutex> lock(mutex);
+        entries.clear();
+        lookup.clear();
+        hits = misses = 0;
+    }
+
+    void stats(std::size_t& n_hits, std::size_t& n_misses, std::size_t& size) const {
+        std::lock_guard<std::mutex> lock(mutex);
+        n_hits = hits;
+        n_misses = misses;
+        size = entries.size();
+    }
+};
+
+struct DerivedConstants {
+    double alpha_s;
+    double alpha_d;
+    double D;
+    double A2;
+};
+
+// Memoized evaluation of delta_sigma_xy / delta_sigma_xx over a whole x grid.
+// Keys compare parameters bit for bit. Two levels are cached:
+//   - alpha_s, alpha_d, D and A2 per (C_f, C_s, C_d, nu);
+//   - the stress trace at unit tau_p per (component, x grid, y, X_c, C_f, C_s, C_d, nu).
+// Gamma and E enter only through tau_p, so a step that changes only them
+// rescales the cached trace instead of re-evaluating M(z).
+class ModelCache {
+private:
+    static std::uint64_t bits(double v) {
+        std::uint64_t b;
+        std::memcpy(&b, &v, sizeof b);
+        return b;
+    }
+
+    static std::size_t mix(std::size_t seed, std::uint64_t v) {
+        return seed ^ (static_cast<std::size_t>(v) + 0x9E3779B97F4A7C15ull + (seed << 6) + (seed >> 2));
+    }
+
+    struct ConstantsKey {
+        std::uint64_t C_f, C_s, C_d, nu;
+        bool operator==(const ConstantsKey& o) const {
+            return C_f == o.C_f && C_s == o.C_s && C_d == o.C_d && nu == o.nu;
+        }
+    };
+
+    struct ConstantsHash {
+        std::size_t operator()(const ConstantsKey& k) const {
+            return mix(mix(mix(mix(0, k.C_f), k.C_s), k.C_d), k.nu);
+        }
+    };
+
+    struct TraceKey {
+        int component;
+        std::uint64_t y, X_c, C_f, C_s, C_d, nu;
+        std::vector<double> x;
+        std::size_t hash;
+        bool operator==(const TraceKey& o) const {
+            return hash == o.hash && component == o.component && y == o.y && X_c == o.X_c &&
+                   C_f == o.C_f && C_s == o.C_s && C_d == o.C_d && nu == o.nu &&
+                   x.size() == o.x.size() &&
+                   std::memcmp(x.data(), o.x.data(), x.size() * sizeof(double)) == 0;
+        }
+    };
+
+    struct TraceHash {
+        std::size_t operator()(const TraceKey& k) const { return k.hash; }
+    };
+
+    LRUCache<ConstantsKey, DerivedConstants, ConstantsHash> constants_cache;
+    LRUCache<TraceKey, std::vector<double>, TraceHash> trace_cache;
+
+public:
+    explicit ModelCache(std::size_t constants_capacity = 256, std::size_t trace_capacity = 64)
+        : constants_cache(constants_capacity), trace_cache(trace_capacity) {}
+
+    static ModelCache& instance() {
+        static ModelCache cache;
+        return cache;
+    }
+
+    DerivedConstants constants(double C_f, double C_s, double C_d, double nu) {
+        ConstantsKey key{bits(C_f), bits(C_s), bits(C_d), bits(nu)};
+        if (auto hit = constants_cache.find(key))
+            return *hit;
+        DerivedConstants c;
+        c.alpha_s = StressAnalysis::alpha_s(C_f, C_s);
+        c.alpha_d = StressAnalysis::alpha_d(C_f, C_d);
+        c.D = StressAnalysis::D(c.alpha_s, c.alpha_d);
+        c.A2 = StressAnalysis::compute_A2(C_f, C_s, nu, c.D);
+        return *constants_cache.insert(key, c);
+    }
+
+    void delta_sigma(StressComponent component, const double* x, std::size_t n, double y,
+                     double X_c, double C_f, double C_s, double C_d, double nu,
+                     double Gamma, double E, double* out) {
+        const DerivedConstants c = constants(C_f, C_s, C_d, nu);
+        const double K2 = StressAnalysis::compute_K2(Gamma, E, nu, c.A2);
+        const double tau_p = StressAnalysis::compute_tau_p(K2, X_c);
+
+        TraceKey key{static_cast<int>(component), bits(y), bits(X_c), bits(C_f),
+                     bits(C_s), bits(C_d), bits(nu), std::vector<double>(x, x + n), 0};
+        std::size_t h = mix(0, static_cast<std::uint64_t>(key.component));
+        for (std::uint64_t v : {key.y, key.X_c, key.C_f, key.C_s, key.C_d, key.nu})
+            h = mix(h, v);
+        for (std::size_t i = 0; i < n; ++i)
+            h = mix(h, bits(x[i]));
+        key.hash = h;
+
+        auto unit = trace_cache.find(key);
+        if (!unit) {
+            std::vector<double> trace(n);
+            for (std::size_t i = 0; i < n; ++i) {
+                std::complex<double> z_d(x[i], c.alpha_d * y);
+                std::complex<double> z_s(x[i], c.alpha_s * y);
+                std::complex<double> M_z_d = StressAnalysis::M_of_z(1.0, X_c, z_d);
+                std::complex<double> M_z_s = StressAnalysis::M_of_z(1.0, X_c, z_s);
+                std::complex<double> Sxx_tmp, Syy_tmp, Sxy_tmp;
+                StressAnalysis::compute_stress_components(M_z_d, M_z_s, c.alpha_s, c.alpha_d,
+                                                          Sxx_tmp, Syy_tmp, Sxy_tmp);
+                double Sxx, Syy, Sxy;
+                StressAnalysis::compute_stresses(Sxx_tmp, Syy_tmp, Sxy_tmp, c.alpha_s, c.D, Sxx, Syy, Sxy);
+                trace[i] = component == StressComponent::xy ? Sxy : Sxx;
+            }
+            unit = trace_cache.insert(key, std::move(trace));
+        }
+        const double* u = unit->data();
+        for (std::size_t i = 0; i < n; ++i)
+            out[i] = tau_p * u[i];
+    }
+
+    void clear() {
+        constants_cache.clear();
+        trace_cache.clear();
+    }
+
+    void stats(std::size_t& constant_hits, std::size_t& constant_misses,
+               std::size_t& trace_hits, std::size_t& trace_misses) const {
+        std::size_t size;
+        constants_cache.stats(constant_hits, constant_misses, size);
+        trace_cache.stats(trace_hits, trace_misses, size);
+    }
+};
+
+#endif
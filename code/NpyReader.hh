@@ -0,0 +1,555 @@
+#ifndef NPY_READER_HH
+#define NPY_READER_HH
+
+#include <zlib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstring>
+#include <cstdint>
+#include <cstddef>
+#include <climits>
+#include <algorithm>
+#include <type_traits>
+#include <stdexcept>
+
+// Read-only memory map of a whole file, unmapped when the last owner goes.
+class MappedFile {
+private:
+    const unsigned char* base = nullptr;
+    std::size_t length = 0;
+
+public:
+    explicit MappedFile(const std::string& path) {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            throw std::runtime_error("cannot open " + path);
+        struct stat st;
+        if (::fstat(fd, &st) != 0) {
+            ::close(fd);
+            throw std::runtime_error("cannot stat " + path);
+        }
+        length = static_cast<std::size_t>(st.st_size);
+        if (length > 0) {
+            void* p = ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p == MAP_FAILED) {
+                ::close(fd);
+                throw std::runtime_error("cannot map " + path);
+            }
+            base = static_cast<const unsigned char*>(p);
+        }
+        ::close(fd);
+    }
+
+    ~MappedFile() {
+        if (base)
+            ::munmap(const_cast<unsigned char*>(base), length);
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const unsigned char* data() const { return base; }
+    std::size_t size() const { return length; }
+};
+
+// Element type from an .npy 'descr' such as '<f8'.
+struct NpyDtype {
+    std::string descr;
+    char kind = 0;                // 'f', 'i', 'u', 'b', 'c'
+    std::size_t itemsize = 0;
+    bool native = true;           // byte order matches this machine
+
+    template <typename T>
+    bool is() const {
+        const char want = std::is_floating_point<T>::value ? 'f'
+                        : std::is_same<T, bool>::value     ? 'b'
+                        : std::is_signed<T>::value         ? 'i'
+                                                           : 'u';
+        return native && kind == want && itemsize == sizeof(T);
+    }
+};
+
+// 1-D view with an element stride, e.g. one channel of a [sample][channel] array.
+template <typename T>
+struct StridedSpan {
+    const T* data = nullptr;
+    std::size_t size = 0;
+    std::ptrdiff_t stride = 1;    // in elements
+
+    const T& operator[](std::size_t i) const { return data[static_cast<std::ptrdiff_t>(i) * stride]; }
+
+    StridedSpan sub(std::size_t begin, std::size_t end) const {
+        if (begin > end || end > size)
+            throw std::out_of_range("StridedSpan: window outside the span");
+        return {data + static_cast<std::ptrdiff_t>(begin) * stride, end - begin, stride};
+    }
+
+    bool contiguous() const { return stride == 1; }
+
+    void copy_to(T* out) const {
+        if (contiguous())
+            std::copy(data, data + size, out);
+        else
+            for (std::size_t i = 0; i < size; ++i)
+                out[i] = (*this)[i];
+    }
+};
+
+// An .npy array: header fields plus a pointer into memory kept alive by
+// `owner` (a file mapping or an inflated buffer).
+class NpyArray {
+public:
+    NpyDtype dtype;
+    std::vector<std::size_t> shape;
+    bool fortran_order = false;
+
+    NpyArray() = default;
+    NpyArray(NpyDtype dtype, std::vector<std::size_t> shape, bool fortran_order,
+             const unsigned char* bytes, std::shared_ptr<const void> owner)
+        : dtype(std::move(dtype)), shape(std::move(shape)), fortran_order(fortran_order),
+          bytes(bytes), owner(std::move(owner)) {}
+
+    const void* data() const { return bytes; }
+    const std::shared_ptr<const void>& keep_alive() const { return owner; }
+
+    std::size_t size() const {
+        std::size_t n = 1;
+        for (std::size_t d : shape)
+            n *= d;
+        return n;
+    }
+
+    std::size_t nbytes() const { return size() * dtype.itemsize; }
+
+    // Byte strides per axis
+    std::vector<std::ptrdiff_t> strides() const {
+        std::vector<std::ptrdiff_t> s(shape.size());
+        std::ptrdiff_t step = static_cast<std::ptrdiff_t>(dtype.itemsize);
+        for (std::size_t k = 0; k < shape.size(); ++k) {
+            std::size_t axis = fortran_order ? k : shape.size() - 1 - k;
+            s[axis] = step;
+            step *= static_cast<std::ptrdiff_t>(shape[axis]);
+        }
+        return s;
+    }
+
+    // np.savez does not align members inside the zip, so a view into an
+    // archive may start at any byte. NumPy copes with that; typed C++ access
+    // needs aligned_copy() first.
+    bool aligned() const {
+        return reinterpret_cast<std::uintptr_t>(bytes) % std::max<std::size_t>(dtype.itemsize, 1) == 0;
+    }
+
+    NpyArray aligned_copy() const {
+        if (aligned())
+            return *this;
+        auto buffer = std::make_shared<std::vector<double>>((nbytes() + sizeof(double) - 1) / sizeof(double));
+        std::memcpy(buffer->data(), bytes, nbytes());
+        const unsigned char* copy = reinterpret_cast<const unsigned char*>(buffer->data());
+        return NpyArray(dtype, shape, fortran_order, copy, std::shared_ptr<const void>(buffer, copy));
+    }
+
+    template <typename T>
+    const T* as() const {
+        if (!dtype.is<T>())
+            throw std::invalid_argument("NpyArray: element type is " + dtype.descr);
+        if (reinterpret_cast<std::uintptr_t>(bytes) % alignof(T) != 0)
+            throw std::logic_error("NpyArray: data is not aligned, use aligned_copy()");
+        return reinterpret_cast<const T*>(bytes);
+    }
+
+    // 1-D slice of a 2-D array along the other axis: lane(1, c) is column c,
+    // lane(0, r) is row r.
+    template <typename T>
+    StridedSpan<T> lane(std::size_t fixed_axis, std::size_t index) const {
+        if (shape.size() != 2 || fixed_axis > 1 || index >= shape[fixed_axis])
+            throw std::out_of_range("NpyArray: lane outside the array");
+        const T* p = as<T>();
+        auto s = strides();
+        const std::size_t free_axis = 1 - fixed_axis;
+        const std::ptrdiff_t item = static_cast<std::ptrdiff_t>(sizeof(T));
+        return {p + static_cast<std::ptrdiff_t>(index) * (s[fixed_axis] / item), shape[free_axis],
+                s[free_axis] / item};
+    }
+
+    template <typename T>
+    StridedSpan<T> flat() const {
+        return {as<T>(), size(), 1};
+    }
+
+private:
+    const unsigned char* bytes = nullptr;
+    std::shared_ptr<const void> owner;
+};
+
+// .npy preamble parsing shared by the file and archive readers
+struct NpyFormat {
+    static std::uint64_t le(const unsigned char* p, std::size_t n) {
+        std::uint64_t v = 0;
+        for (std::size_t k = 0; k < n; ++k)
+            v |= static_cast<std::uint64_t>(p[k]) << (8 * k);
+        return v;
+    }
+
+    static bool little_endian_host() {
+        const std::uint16_t probe = 1;
+        unsigned char first;
+        std::memcpy(&first, &probe, 1);
+        return first == 1;
+    }
+
+    // Value of 'key' in the header dict, up to the matching terminator
+    static std::string field(const std::string& header, const std::string& key) {
+        std::size_t k = header.find("'" + key + "'");
+        if (k == std::string::npos)
+            throw std::runtime_error("npy header has no '" + key + "'");
+        std::size_t colon = header.find(':', k);
+        std::size_t start = header.find_first_not_of(' ', colon + 1);
+        if (header[start] == '\'')
+            return header.substr(start + 1, header.find('\'', start + 1) - start - 1);
+        if (header[start] == '(')
+            return header.substr(start + 1, header.find(')', start) - start - 1);
+        return header.substr(start, header.find_first_of(",}", start) - start);
+    }
+
+    // Length of the preamble (magic, version, header length, header), given
+    // at least the first `available` bytes of an .npy stream.
+    static std::size_t preamble_size(const unsigned char* p, std::size_t available) {
+        if (available < 10 || std::memcmp(p, "\x93NUMPY", 6) != 0)
+            throw std::runtime_error("not an .npy stream");
+        if (p[6] == 1)
+            return 10 + static_cast<std::size_t>(le(p + 8, 2));
+        if (available < 12)
+            throw std::runtime_error("truncated .npy header");
+        return 12 + static_cast<std::size_t>(le(p + 8, 4));
+    }
+
+    static void parse_header(const unsigned char* p, std::size_t preamble, NpyDtype& dtype,
+                             std::vector<std::size_t>& shape, bool& fortran_order) {
+        const std::size_t offset = p[6] == 1 ? 10 : 12;
+        std::string header(reinterpret_cast<const char*>(p + offset), preamble - offset);
+
+        dtype.descr = field(header, "descr");
+        if (dtype.descr.size() < 3)
+            throw std::runtime_error("unsupported npy descr " + dtype.descr);
+        const char order = dtype.descr[0];
+        dtype.kind = dtype.descr[1];
+        dtype.itemsize = static_cast<std::size_t>(std::stoul(dtype.descr.substr(2)));
+        dtype.native = order == '|' || order == '=' || (order == '<') == little_endian_host();
+        if (std::string("fiubc").find(dtype.kind) == std::string::npos)
+            throw std::runtime_error("unsupported npy descr " + dtype.descr);
+
+        fortran_order = field(header, "fortran_order").find("True") != std::string::npos;
+
+        shape.clear();
+        std::string dims = field(header, "shape");
+        std::size_t pos = 0;
+        while ((pos = dims.find_first_of("0123456789", pos)) != std::string::npos) {
+            std::size_t end = dims.find_first_not_of("0123456789", pos);
+            shape.push_back(static_cast<std::size_t>(std::stoull(dims.substr(pos, end - pos))));
+            pos = end;
+        }
+    }
+
+};
+
+// Maps an .npy file; the array points straight into the mapping.
+inline NpyArray load_npy(const std::string& path) {
+    auto file = std::make_shared<const MappedFile>(path);
+    const std::size_t preamble = NpyFormat::preamble_size(file->data(), file->size());
+    if (preamble > file->size())
+        throw std::runtime_error("truncated .npy header in " + path);
+    NpyDtype dtype;
+    std::vector<std::size_t> shape;
+    bool fortran_order;
+    NpyFormat::parse_header(file->data(), preamble, dtype, shape, fortran_order);
+    NpyArray array(dtype, shape, fortran_order, file->data() + preamble, file);
+    if (preamble + array.nbytes() > file->size())
+        throw std::runtime_error("truncated .npy data in " + path);
+    return array;
+}
+
+// Lazy reader for .npz archives (zip files of .npy members, Zip64 included).
+// Only the central directory is read up front. Stored members (np.savez) are
+// served straight from a memory map of the archive, so touching a window reads
+// only its pages. Deflated members (np.savez_compressed) are inflated as a
+// stream on access. read_window() stops inflating once the window has been
+// produced and keeps nothing else.
+class NpzArchive {
+private:
+    struct Member {
+        std::string name;
+        std::uint16_t method;
+        std::uint64_t compressed_size;
+        std::uint64_t size;
+        std::uint64_t data_offset;
+    };
+
+    std::string path;
+    std::shared_ptr<const MappedFile> file;
+    std::vector<Member> members;
+
+    // Sequential reader over the decompressed bytes of one member
+    class MemberStream {
+    private:
+        const unsigned char* source;
+        const Member& member;
+        std::uint64_t position = 0;
+        z_stream zs{};
+        std::uint64_t consumed = 0;
+
+    public:
+        MemberStream(const unsigned char* source, const Member& member) : source(source), member(member) {
+            if (member.method == 8 && inflateInit2(&zs, -MAX_WBITS) != Z_OK)
+                throw std::runtime_error("zlib initialisation failed");
+        }
+
+        ~MemberStream() {
+            if (member.method == 8)
+                inflateEnd(&zs);
+        }
+
+        MemberStream(const MemberStream&) = delete;
+        MemberStream& operator=(const MemberStream&) = delete;
+
+        std::uint64_t tell() const { return position; }
+
+        void read(void* destination, std::size_t n) {
+            if (position + n > member.size)
+                throw std::runtime_error("npz member " + member.name + " is truncated");
+            if (member.method == 0) {
+                std::memcpy(destination, source + position, n);
+                position += n;
+                return;
+            }
+            unsigned char* out = static_cast<unsigned char*>(destination);
+            while (n > 0) {
+                const std::size_t out_chunk = std::min<std::size_t>(n, UINT_MAX);
+                zs.next_out = out;
+                zs.avail_out = static_cast<uInt>(out_chunk);
+                while (zs.avail_out > 0) {
+                    if (zs.avail_in == 0) {
+                        std::uint64_t left = member.compressed_size - consumed;
+                        std::size_t in_chunk = static_cast<std::size_t>(std::min<std::uint64_t>(left, UINT_MAX));
+                        zs.next_in = const_cast<Bytef*>(source + consumed);
+                        zs.avail_in = static_cast<uInt>(in_chunk);
+                        consumed += in_chunk;
+                    }
+                    int status = inflate(&zs, Z_NO_FLUSH);
+                    if (status == Z_STREAM_END && zs.avail_out > 0)
+                        throw std::runtime_error("npz member " + member.name + " ended early");
+                    if (status != Z_OK && status != Z_STREAM_END)
+                        throw std::runtime_error("npz member " + member.name + " is corrupt");
+                }
+                out += out_chunk;
+                n -= out_chunk;
+                position += out_chunk;
+            }
+        }
+
+        void skip(std::uint64_t n) {
+            if (member.method == 0) {
+                if (position + n > member.size)
+                    throw std::runtime_error("npz member " + member.name + " is truncated");
+                position += n;
+                return;
+            }
+            std::vector<unsigned char> scratch(static_cast<std::size_t>(std::min<std::uint64_t>(n, 1 << 20)));
+            while (n > 0) {
+                std::size_t chunk = static_cast<std::size_t>(std::min<std::uint64_t>(n, scratch.size()));
+                read(scratch.data(), chunk);
+                n -= chunk;
+            }
+        }
+    };
+
+    const Member& find(const std::string& name) const {
+        for (const auto& m : members)
+            if (m.name == name || m.name == name + ".npy")
+                return m;
+        throw std::out_of_range("no member '" + name + "' in " + path);
+    }
+
+    // Header of a member; leaves the stream at the first data byte
+    static std::size_t read_header(MemberStream& stream, NpyDtype& dtype, std::vector<std::size_t>& shape,
+                                   bool& fortran_order) {
+        std::vector<unsigned char> head(12);
+        stream.read(head.data(), 10);
+        if (head[6] != 1)
+            stream.read(head.data() + 10, 2);
+        const std::size_t preamble = NpyFormat::preamble_size(head.data(), head[6] == 1 ? 10 : 12);
+        const std::size_t got = head[6] == 1 ? 10 : 12;
+        head.resize(preamble);
+        stream.read(head.data() + got, preamble - got);
+        NpyFormat::parse_header(head.data(), preamble, dtype, shape, fortran_order);
+        return preamble;
+    }
+
+    void read_directory() {
+        const auto le = &NpyFormat::le;
+        const unsigned char* p = file->data();
+        const std::size_t n = file->size();
+        if (n < 22)
+            throw std::runtime_error(path + " is not a zip archive");
+
+        std::size_t eocd = n - 22;
+        const std::size_t lowest = n > 22 + 65535 ? n - 22 - 65535 : 0;
+        while (le(p + eocd, 4) != 0x06054b50) {
+            if (eocd == lowest)
+                throw std::runtime_error(path + " is not a zip archive");
+            --eocd;
+        }
+        std::uint64_t entries = le(p + eocd + 10, 2);
+        std::uint64_t directory = le(p + eocd + 16, 4);
+        if (eocd >= 20 && le(p + eocd - 20, 4) == 0x07064b50) {
+            const std::size_t zip64 = static_cast<std::size_t>(le(p + eocd - 20 + 8, 8));
+            if (zip64 + 56 > n || le(p + zip64, 4) != 0x06064b50)
+                throw std::runtime_error(path + ": bad Zip64 directory");
+            entries = le(p + zip64 + 32, 8);
+            directory = le(p + zip64 + 48, 8);
+        }
+
+        std::size_t at = static_cast<std::size_t>(directory);
+        for (std::uint64_t e = 0; e < entries; ++e) {
+            if (at + 46 > n || le(p + at, 4) != 0x02014b50)
+                throw std::runtime_error(path + ": bad central directory");
+            Member m;
+            m.method = static_cast<std::uint16_t>(le(p + at + 10, 2));
+            m.compressed_size = le(p + at + 20, 4);
+            m.size = le(p + at + 24, 4);
+            const std::size_t name_length = static_cast<std::size_t>(le(p + at + 28, 2));
+            const std::size_t extra_length = static_cast<std::size_t>(le(p + at + 30, 2));
+            const std::size_t comment_length = static_cast<std::size_t>(le(p + at + 32, 2));
+            std::uint64_t local = le(p + at + 42, 4);
+            m.name.assign(reinterpret_cast<const char*>(p + at + 46), name_length);
+
+            // Zip64 extended sizes and offset, present only for saturated fields
+            const unsigned char* extra = p + at + 46 + name_length;
+            for (std::size_t k = 0; k + 4 <= extra_length;) {
+                const std::size_t id = static_cast<std::size_t>(le(extra + k, 2));
+                const std::size_t length = static_cast<std::size_t>(le(extra + k + 2, 2));
+                if (id == 0x0001) {
+                    const unsigned char* q = extra + k + 4;
+                    if (m.size == 0xFFFFFFFFu) { m.size = le(q, 8); q += 8; }
+                    if (m.compressed_size == 0xFFFFFFFFu) { m.compressed_size = le(q, 8); q += 8; }
+                    if (local == 0xFFFFFFFFu) { local = le(q, 8); }
+                }
+                k += 4 + length;
+            }
+            if (m.method != 0 && m.method != 8)
+                throw std::runtime_error(path + ": member " + m.name + " uses an unsupported compression");
+
+            const std::size_t lh = static_cast<std::size_t>(local);
+            if (lh + 30 > n || le(p + lh, 4) != 0x04034b50)
+                throw std::runtime_error(path + ": bad local header for " + m.name);
+            m.data_offset = local + 30 + le(p + lh + 26, 2) + le(p + lh + 28, 2);
+            if (m.data_offset + m.compressed_size > n)
+                throw std::runtime_error(path + ": member " + m.name + " runs past the end of the file");
+            members.push_back(std::move(m));
+            at += 46 + name_length + extra_length + comment_length;
+        }
+    }
+
+public:
+    explicit NpzArchive(const std::string& path) : path(path), file(std::make_shared<const MappedFile>(path)) {
+        read_directory();
+    }
+
+    // Array names, without the ".npy" suffix
+    std::vector<std::string> names() const {
+        std::vector<std::string> out;
+        for (const auto& m : members) {
+            std::string name = m.name;
+            if (name.size() > 4 && name.compare(name.size() - 4, 4, ".npy") == 0)
+                name.resize(name.size() - 4);
+            out.push_back(name);
+        }
+        return out;
+    }
+
+    bool compressed(const std::string& name) const { return find(name).method != 0; }
+
+    // Header only; deflated members inflate just the first few hundred bytes
+    NpyArray describe(const std::string& name) const {
+        const Member& m = find(name);
+        MemberStream stream(file->data() + m.data_offset, m);
+        NpyArray a;
+        read_header(stream, a.dtype, a.shape, a.fortran_order);
+        return a;
+    }
+
+    // Whole member. Stored members are views into the archive mapping
+    // (possibly unaligned); deflated ones are inflated into an owned buffer.
+    NpyArray load(const std::string& name) const {
+        const Member& m = find(name);
+        MemberStream stream(file->data() + m.data_offset, m);
+        NpyDtype dtype;
+        std::vector<std::size_t> shape;
+        bool fortran_order;
+        const std::size_t preamble = read_header(stream, dtype, shape, fortran_order);
+        NpyArray header(dtype, shape, fortran_order, nullptr, nullptr);
+        if (preamble + header.nbytes() > m.size)
+            throw std::runtime_error("npz member " + m.name + " is truncated");
+
+        if (m.method == 0)
+            return NpyArray(dtype, shape, fortran_order, file->data() + m.data_offset + preamble, file);
+
+        auto buffer = std::make_shared<std::vector<unsigned char>>(header.nbytes());
+        stream.read(buffer->data(), buffer->size());
+        const unsigned char* bytes = buffer->data();
+        return NpyArray(dtype, shape, fortran_order, bytes, std::shared_ptr<const void>(buffer, bytes));
+    }
+
+    // Indices [begin, end) along `axis`, all other axes whole, always aligned.
+    // A contiguous window of a stored member is a view when possible;
+    // otherwise only the window is kept and only the bytes up to its end are
+    // decompressed.
+    NpyArray read_window(const std::string& name, std::size_t axis, std::size_t begin, std::size_t end) const {
+        const Member& m = find(name);
+        MemberStream stream(file->data() + m.data_offset, m);
+        NpyDtype dtype;
+        std::vector<std::size_t> shape;
+        bool fortran_order;
+        read_header(stream, dtype, shape, fortran_order);
+        if (axis >= shape.size() || begin > end || end > shape[axis])
+            throw std::out_of_range("read_window: window outside member " + m.name);
+
+        // Memory-order axis index; outer blocks before it, contiguous run after it
+        const std::size_t memory_axis = fortran_order ? shape.size() - 1 - axis : axis;
+        std::vector<std::size_t> order(shape);
+        if (fortran_order)
+            std::reverse(order.begin(), order.end());
+        std::size_t outer = 1, inner = dtype.itemsize;
+        for (std::size_t k = 0; k < memory_axis; ++k)
+            outer *= order[k];
+        for (std::size_t k = memory_axis + 1; k < order.size(); ++k)
+            inner *= order[k];
+
+        const std::uint64_t data_start = stream.tell();
+        const std::size_t run = (end - begin) * inner;
+        if (m.method == 0 && outer == 1) {
+            NpyArray view(dtype, shape, fortran_order,
+                          file->data() + m.data_offset + data_start + begin * inner, file);
+            view.shape[axis] = end - begin;
+            if (view.aligned())
+                return view;
+        }
+        auto buffer = std::make_shared<std::vector<unsigned char>>(outer * run);
+        for (std::size_t o = 0; o < outer && run > 0; ++o) {
+            const std::uint64_t at = data_start + (static_cast<std::uint64_t>(o) * shape[axis] + begin) * inner;
+            stream.skip(at - stream.tell());
+            stream.read(buffer->data() + o * run, run);
+        }
+        shape[axis] = end - begin;
+        const unsigned char* bytes = buffer->data();
+        return NpyArray(dtype, shape, fortran_order, bytes, std::shared_ptr<const void>(buffer, bytes));
+    }
+};
+
+#endif
@@ -0,0 +1,535 @@
+#ifndef OUT_OF_CORE_HH
+#define OUT_OF_CORE_HH
+
+#include "NpyReader.hh"
+#include "IIRFilter.hh"
+#include "CrossCorrelator.hh"
+#include "FFT.hh"
+#include "Parallel.hh"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <vector>
+#include <string>
+#include <complex>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <cmath>
+#include <cstring>
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+#include <stdexcept>
+
+// A record that is read in pieces: read(begin, count, out) fills
+// out[channel * count + k] with sample begin + k of every channel.
+struct ChunkSource {
+    std::size_t channels = 0;
+    std::size_t samples = 0;
+    std::function<void(std::size_t begin, std::size_t count, double* out)> read;
+};
+
+// Chunked reads straight from a mapped .npy array (or a stored .npz member)
+// with time along `time_axis`. Elements are converted to double on the fly;
+// memcpy per element keeps unaligned archive members legal.
+inline ChunkSource npy_source(const NpyArray& array, std::size_t time_axis) {
+    if (array.shape.empty() || array.shape.size() > 2 || time_axis >= array.shape.size())
+        throw std::invalid_argument("npy_source: need a 1-D or 2-D array and a valid time axis");
+    if (!array.dtype.native)
+        throw std::invalid_argument("npy_source: non-native byte order");
+
+    const auto strides = array.strides();
+    const std::size_t channel_axis = 1 - time_axis;
+    ChunkSource source;
+    source.samples = array.shape[time_axis];
+    source.channels = array.shape.size() == 2 ? array.shape[channel_axis] : 1;
+    const std::ptrdiff_t time_stride = strides[time_axis];
+    const std::ptrdiff_t channel_stride = array.shape.size() == 2 ? strides[channel_axis] : 0;
+    const unsigned char* base = static_cast<const unsigned char*>(array.data());
+    const std::size_t channels = source.channels;
+
+    auto reader = [array, base, time_stride, channel_stride, channels](auto tag) {
+        using T = decltype(tag);
+        return [array, base, time_stride, channel_stride, channels](std::size_t begin, std::size_t count, double* out) {
+            for (std::size_t c = 0; c < channels; ++c) {
+                const unsigned char* p = base + static_cast<std::ptrdiff_t>(c) * channel_stride +
+                                         static_cast<std::ptrdiff_t>(begin) * time_stride;
+                double* row = out + c * count;
+                for (std::size_t k = 0; k < count; ++k, p += time_stride) {
+                    T v;
+                    std::memcpy(&v, p, sizeof(T));
+                    row[k] = static_cast<double>(v);
+                }
+            }
+        };
+    };
+
+    const NpyDtype& d = array.dtype;
+    if (d.kind == 'f' && d.itemsize == 8)
+        source.read = reader(double());
+    else if (d.kind == 'f' && d.itemsize == 4)
+        source.read = reader(float());
+    else if (d.kind == 'i' && d.itemsize == 2)
+        source.read = reader(std::int16_t());
+    else if (d.kind == 'i' && d.itemsize == 4)
+        source.read = reader(std::int32_t());
+    else
+        throw std::invalid_argument("npy_source: unsupported element type " + d.descr);
+    return source;
+}
+
+// Per-channel gain applied while reading (e.g. the StrainConverter factors).
+inline ChunkSource scaled_source(ChunkSource source, std::vector<double> factors) {
+    if (factors.size() != source.channels)
+        throw std::invalid_argument("scaled_source: one factor per channel");
+    auto inner = source.read;
+    source.read = [inner, factors](std::size_t begin, std::size_t count, double* out) {
+        inner(begin, count, out);
+        for (std::size_t c = 0; c < factors.size(); ++c)
+            for (std::size_t k = 0; k < count; ++k)
+                out[c * count + k] *= factors[c];
+    };
+    return source;
+}
+
+// Double-buffered chunk loader: while the caller works on chunk k, chunk k + 1
+// is loaded into the other buffer. One loader thread serves every chunk and
+// lives as long as the reader; an exception thrown by `load` is rethrown by
+// next().
+class PrefetchReader {
+private:
+    std::function<void(std::size_t, std::vector<double>&)> load;
+    std::size_t n_chunks;
+    std::size_t next_chunk = 0;   // next chunk handed to the caller
+    std::vector<double> buffers[2];
+
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::size_t requested = 0;    // the loader may fill chunks [0, requested)
+    std::size_t loaded = 0;       // chunks [0, loaded) are ready
+    bool stopping = false;
+    std::exception_ptr error;
+    std::thread loader;
+
+    void run() {
+        for (std::size_t chunk = 0; chunk < n_chunks; ++chunk) {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                changed.wait(lock, [&] { return stopping || chunk < requested; });
+                if (stopping)
+                    return;
+            }
+            std::exception_ptr failure;
+            try {
+                load(chunk, buffers[chunk % 2]);
+            } catch (...) {
+                failure = std::current_exception();
+            }
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                error = failure;
+                loaded = chunk + 1;
+            }
+            changed.notify_all();
+            if (failure)
+                return;
+        }
+    }
+
+public:
+    PrefetchReader(std::function<void(std::size_t, std::vector<double>&)> load, std::size_t n_chunks)
+        : load(std::move(load)), n_chunks(n_chunks) {
+        if (n_chunks > 0) {
+            requested = 1;
+            loader = std::thread([this]() { run(); });
+        }
+    }
+
+    ~PrefetchReader() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        changed.notify_all();
+        if (loader.joinable())
+            loader.join();
+    }
+
+    PrefetchReader(const PrefetchReader&) = delete;
+    PrefetchReader& operator=(const PrefetchReader&) = delete;
+
+    // Next chunk in order, or nullptr at the end. The buffer stays valid
+    // until the following call.
+    std::vector<double>* next() {
+        if (next_chunk >= n_chunks)
+            return nullptr;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            changed.wait(lock, [&] { return error || loaded > next_chunk; });
+            if (error)
+                std::rethrow_exception(error);
+            requested = std::min(n_chunks, next_chunk + 2);
+        }
+        changed.notify_all();
+        return &buffers[next_chunk++ % 2];
+    }
+};
+
+// Positional I/O helpers that loop over short reads and writes.
+struct FileIO {
+    static void write_all(int fd, const void* data, std::size_t n, std::uint64_t offset) {
+        const char* p = static_cast<const char*>(data);
+        while (n > 0) {
+            ssize_t w = ::pwrite(fd, p, n, static_cast<off_t>(offset));
+            if (w <= 0)
+                throw std::runtime_error("write failed");
+            p += w;
+            n -= static_cast<std::size_t>(w);
+            offset += static_cast<std::uint64_t>(w);
+        }
+    }
+
+    static void read_all(int fd, void* data, std::size_t n, std::uint64_t offset) {
+        char* p = static_cast<char*>(data);
+        while (n > 0) {
+            ssize_t r = ::pread(fd, p, n, static_cast<off_t>(offset));
+            if (r <= 0)
+                throw std::runtime_error("read failed");
+            p += r;
+            n -= static_cast<std::size_t>(r);
+            offset += static_cast<std::uint64_t>(r);
+        }
+    }
+};
+
+// float64 (channels, samples) .npy file written chunk by chunk, so results
+// larger than RAM can be memory-mapped by NumPy afterwards.
+class NpyFileWriter {
+private:
+    int fd = -1;
+    std::size_t channels;
+    std::size_t samples;
+    std::size_t header = 0;
+
+public:
+    NpyFileWriter(const std::string& path, std::size_t channels, std::size_t samples)
+        : channels(channels), samples(samples) {
+        std::string dict = std::string("{'descr': '") + (NpyFormat::little_endian_host() ? "<" : ">") +
+                           "f8', 'fortran_order': False, 'shape': (" + std::to_string(channels) + ", " +
+                           std::to_string(samples) + "), }";
+        const std::size_t padding = 64 - (10 + dict.size() + 1) % 64;
+        dict += std::string(padding % 64, ' ') + "\n";
+        std::string preamble("\x93NUMPY\x01\x00", 8);
+        preamble += static_cast<char>(dict.size() & 0xFF);
+        preamble += static_cast<char>((dict.size() >> 8) & 0xFF);
+        preamble += dict;
+        header = preamble.size();
+
+        fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0)
+            throw std::runtime_error("cannot create " + path);
+        const std::uint64_t total = header + static_cast<std::uint64_t>(channels) * samples * sizeof(double);
+        if (::ftruncate(fd, static_cast<off_t>(total)) != 0) {
+            ::close(fd);
+            throw std::runtime_error("cannot size " + path);
+        }
+        FileIO::write_all(fd, preamble.data(), preamble.size(), 0);
+    }
+
+    ~NpyFileWriter() {
+        if (fd >= 0)
+            ::close(fd);
+    }
+
+    NpyFileWriter(const NpyFileWriter&) = delete;
+    NpyFileWriter& operator=(const NpyFileWriter&) = delete;
+
+    // Samples [begin, begin + count) of every channel from data[channel * count + k]
+    void write(std::size_t begin, std::size_t count, const double* data) {
+        for (std::size_t c = 0; c < channels; ++c)
+            FileIO::write_all(fd, data + c * count, count * sizeof(double),
+                              header + (static_cast<std::uint64_t>(c) * samples + begin) * sizeof(double));
+    }
+};
+
+// Anonymous scratch file next to `near`, removed as soon as it is created.
+class SpillFile {
+private:
+    int fd = -1;
+
+public:
+    explicit SpillFile(const std::string& near) {
+        std::string pattern = near + ".spillXXXXXX";
+        std::vector<char> name(pattern.begin(), pattern.end());
+        name.push_back('\0');
+        fd = ::mkstemp(name.data());
+        if (fd < 0)
+            throw std::runtime_error("cannot create a spill file next to " + near);
+        ::unlink(name.data());
+    }
+
+    ~SpillFile() {
+        if (fd >= 0)
+            ::close(fd);
+    }
+
+    SpillFile(const SpillFile&) = delete;
+    SpillFile& operator=(const SpillFile&) = delete;
+
+    void write(const double* data, std::size_t n, std::uint64_t offset) {
+        FileIO::write_all(fd, data, n * sizeof(double), offset * sizeof(double));
+    }
+
+    void read(double* data, std::size_t n, std::uint64_t offset) const {
+        FileIO::read_all(fd, data, n * sizeof(double), offset * sizeof(double));
+    }
+};
+
+// Butterworth filtering of a record that does not fit in memory, written to
+// an .npy file. Causal mode carries the cascade state across chunks. Zero-phase
+// mode is exactly IIRFilter::filtfilt on the whole record:
+//   - the odd extensions only need the first and last padlen + 1 samples;
+//   - the forward pass is spilled to a scratch file chunk by chunk;
+//   - the backward pass reads the spilled chunks last to first and writes the
+//     result.
+// Chunks are prefetched while the previous one is filtered; channels of a
+// chunk are filtered in parallel.
+inline void filter_out_of_core(const ChunkSource& source, const SecondOrderSections& sos, bool zero_phase,
+                               const std::string& output, std::size_t chunk = 1 << 20, unsigned threads = 0) {
+    const std::size_t C = source.channels, n = source.samples;
+    if (chunk == 0)
+        throw std::invalid_argument("filter_out_of_core: zero chunk size");
+    const std::size_t n_chunks = (n + chunk - 1) / chunk;
+    auto count_of = [&](std::size_t c) { return std::min(chunk, n - c * chunk); };
+
+    NpyFileWriter writer(output, C, n);
+    std::vector<IIRFilter> filters(C, IIRFilter(sos));
+    auto filter_chunk = [&](std::vector<double>& buffer, std::size_t count) {
+        parallel_for(C, threads, [&](std::size_t ch, unsigned) {
+            filters[ch].process(buffer.data() + ch * count, count, buffer.data() + ch * count);
+        });
+    };
+    PrefetchReader forward_reader([&](std::size_t c, std::vector<double>& buffer) {
+        buffer.resize(C * count_of(c));
+        source.read(c * chunk, count_of(c), buffer.data());
+    }, n_chunks);
+
+    if (!zero_phase) {
+        for (std::size_t c = 0; c < n_chunks; ++c) {
+            std::vector<double>& buffer = *forward_reader.next();
+            filter_chunk(buffer, count_of(c));
+            writer.write(c * chunk, count_of(c), buffer.data());
+        }
+        return;
+    }
+
+    const std::size_t edge = sos.padlen();
+    if (n <= edge)
+        throw std::invalid_argument("filter_out_of_core: the record must be longer than padlen = " +
+                                    std::to_string(edge));
+    std::vector<double> head(C * (edge + 1)), tail(C * (edge + 1)), pad(edge);
+    source.read(0, edge + 1, head.data());
+    source.read(n - edge - 1, edge + 1, tail.data());
+
+    // Left extension primes the forward state; its output is never needed
+    for (std::size_t ch = 0; ch < C; ++ch) {
+        const double* x = head.data() + ch * (edge + 1);
+        for (std::size_t k = 0; k < edge; ++k)
+            pad[k] = 2.0 * x[0] - x[edge - k];
+        filters[ch].reset_steady(pad[0]);
+        filters[ch].process(pad.data(), edge, pad.data());
+    }
+
+    SpillFile spill(output);
+    for (std::size_t c = 0; c < n_chunks; ++c) {
+        std::vector<double>& buffer = *forward_reader.next();
+        filter_chunk(buffer, count_of(c));
+        spill.write(buffer.data(), buffer.size(), static_cast<std::uint64_t>(c) * chunk * C);
+    }
+
+    // Right extension: forward through it, then turn around
+    for (std::size_t ch = 0; ch < C; ++ch) {
+        const double* x = tail.data() + ch * (edge + 1);
+        for (std::size_t k = 0; k < edge; ++k)
+            pad[k] = 2.0 * x[edge] - x[edge - 1 - k];
+        filters[ch].process(pad.data(), edge, pad.data());
+        std::reverse(pad.begin(), pad.end());
+        filters[ch].reset_steady(pad[0]);
+        filters[ch].process(pad.data(), edge, pad.data());
+    }
+
+    PrefetchReader backward_reader([&](std::size_t i, std::vector<double>& buffer) {
+        const std::size_t c = n_chunks - 1 - i;
+        buffer.resize(C * count_of(c));
+        spill.read(buffer.data(), buffer.size(), static_cast<std::uint64_t>(c) * chunk * C);
+    }, n_chunks);
+    for (std::size_t i = 0; i < n_chunks; ++i) {
+        const std::size_t c = n_chunks - 1 - i, count = count_of(c);
+        std::vector<double>& buffer = *backward_reader.next();
+        parallel_for(C, threads, [&](std::size_t ch, unsigned) {
+            double* row = buffer.data() + ch * count;
+            std::reverse(row, row + count);
+            filters[ch].process(row, count, row);
+            std::reverse(row, row + count);
+        });
+        writer.write(c * chunk, count, buffer.data());
+    }
+}
+
+// Least-squares line of one channel, x ~ mean + slope (k - t0).
+struct LinearTrend {
+    double mean = 0.0;
+    double slope = 0.0;
+    double t0 = 0.0;
+
+    double operator()(std::size_t k) const { return mean + slope * (static_cast<double>(k) - t0); }
+};
+
+// First pass of an out-of-core linear detrend (scipy.signal.detrend, type
+// 'linear'): per-channel sums accumulated chunk by chunk. With t centred on
+// the record the mean and slope decouple, so one pass is enough.
+inline std::vector<LinearTrend> trend_out_of_core(const ChunkSource& source, std::size_t chunk = 1 << 20,
+                                                  unsigned threads = 0) {
+    const std::size_t C = source.channels, n = source.samples;
+    const std::size_t n_chunks = (n + chunk - 1) / chunk;
+    const double t0 = 0.5 * static_cast<double>(n - 1);
+    std::vector<double> sum(C, 0.0), moment(C, 0.0);
+
+    PrefetchReader reader([&](std::size_t c, std::vector<double>& buffer) {
+        const std::size_t count = std::min(chunk, n - c * chunk);
+        buffer.resize(C * count);
+        source.read(c * chunk, count, buffer.data());
+    }, n_chunks);
+    for (std::size_t c = 0; c < n_chunks; ++c) {
+        const std::size_t begin = c * chunk, count = std::min(chunk, n - begin);
+        const std::vector<double>& buffer = *reader.next();
+        parallel_for(C, threads, [&](std::size_t ch, unsigned) {
+            const double* x = buffer.data() + ch * count;
+            double s = 0.0, m = 0.0;
+            for (std::size_t k = 0; k < count; ++k) {
+                s += x[k];
+                m += (static_cast<double>(begin + k) - t0) * x[k];
+            }
+            sum[ch] += s;
+            moment[ch] += m;
+        });
+    }
+
+    const double N = static_cast<double>(n);
+    const double tt = N * (N * N - 1.0) / 12.0;    // sum (k - t0)^2
+    std::vector<LinearTrend> trends(C);
+    for (std::size_t ch = 0; ch < C; ++ch)
+        trends[ch] = {sum[ch] / N, tt > 0.0 ? moment[ch] / tt : 0.0, t0};
+    return trends;
+}
+
+// Lag-limited cross-correlation of detrended channels, chunk by chunk, equal
+// to the |lag| <= max_lag part of CrossCorrelator::correlate. Each chunk is cut
+// into FFT blocks; a block of channel i is correlated against the same block
+// of channel j plus the max_lag samples before it, which gives every product
+// x_i[n] x_j[n - l] with n in the block, and the ordered pair (j, i) supplies
+// the negative lags. The FFT length follows max_lag (never more than the chunk
+// plus max_lag), so the spectra, each channel transformed once per block and
+// shared by all pairs, stay small however long the chunks are.
+// full[p] receives the 2 max_lag + 1 correlation values of pair p (lag -max_lag first).
+inline std::vector<CorrelationPeak> correlate_out_of_core(
+    const ChunkSource& source, const std::vector<std::pair<std::size_t, std::size_t>>& pairs,
+    std::size_t max_lag, std::vector<std::vector<double>>& full, std::size_t chunk = 1 << 20,
+    unsigned threads = 0) {
+    using cd = std::complex<double>;
+    const std::size_t C = source.channels, n = source.samples, L = max_lag;
+    for (const auto& p : pairs)
+        if (p.first >= C || p.second >= C)
+            throw std::out_of_range("correlate_out_of_core: channel index out of range");
+    if (n < 2 || L >= n)
+        throw std::invalid_argument("correlate_out_of_core: max_lag must be shorter than the record");
+
+    const std::vector<LinearTrend> trends = trend_out_of_core(source, chunk, threads);
+    const std::size_t n_chunks = (n + chunk - 1) / chunk;
+    const std::size_t span = std::min({chunk, n, std::max<std::size_t>(3 * (L + 1), 1 << 15)});
+    const std::size_t nfft = FFTPlan::next_pow2(span + L);
+    const std::size_t block = nfft - L;
+    const FFTPlan plan(nfft);
+
+    // Buffer layout per channel: L samples of history, then the chunk
+    const std::size_t width = L + chunk;
+    std::vector<double> raw;      // only touched by the loader thread
+    PrefetchReader reader([&](std::size_t c, std::vector<double>& buffer) {
+        const std::size_t begin = c * chunk, count = std::min(chunk, n - begin);
+        const std::size_t first = begin >= L ? begin - L : 0, history = begin - first;
+        raw.resize(C * (history + count));
+        source.read(first, history + count, raw.data());
+        buffer.assign(C * width, 0.0);
+        for (std::size_t ch = 0; ch < C; ++ch)
+            for (std::size_t k = 0; k < history + count; ++k)
+                buffer[ch * width + L - history + k] = raw[ch * (history + count) + k] - trends[ch](first + k);
+    }, n_chunks);
+
+    std::vector<std::pair<std::size_t, std::size_t>> ordered;    // (i, j) then (j, i)
+    for (const auto& p : pairs) {
+        ordered.push_back(p);
+        ordered.emplace_back(p.second, p.first);
+    }
+    std::vector<std::vector<double>> positive(ordered.size(), std::vector<double>(L + 1, 0.0));
+    std::vector<double> energy(C, 0.0);
+    std::vector<cd> block_spectra(C * nfft), segment_spectra(C * nfft);
+    const unsigned workers = resolve_threads(threads, std::max(C, ordered.size()));
+    std::vector<std::vector<cd>> scratch(workers, std::vector<cd>(nfft));
+
+    for (std::size_t c = 0; c < n_chunks; ++c) {
+        const std::size_t count = std::min(chunk, n - c * chunk);
+        const std::vector<double>& buffer = *reader.next();
+        for (std::size_t offset = 0; offset < count; offset += block) {
+            const std::size_t length = std::min(block, count - offset);
+            parallel_for(C, workers, [&](std::size_t ch, unsigned) {
+                const double* x = buffer.data() + ch * width + offset;
+                cd* a = block_spectra.data() + ch * nfft;
+                cd* s = segment_spectra.data() + ch * nfft;
+                std::fill(a, a + nfft, cd(0.0, 0.0));
+                std::fill(s, s + nfft, cd(0.0, 0.0));
+                double e = 0.0;
+                for (std::size_t k = 0; k < length; ++k) {
+                    a[k] = x[L + k];
+                    e += x[L + k] * x[L + k];
+                }
+                for (std::size_t k = 0; k < L + length; ++k)
+                    s[k] = x[k];
+                energy[ch] += e;
+                plan.forward(a);
+                plan.forward(s);
+            });
+            // sum_k a[k] s[k + d] at d = L - l
+            parallel_for(ordered.size(), workers, [&](std::size_t p, unsigned w) {
+                const cd* a = block_spectra.data() + ordered[p].first * nfft;
+                const cd* s = segment_spectra.data() + ordered[p].second * nfft;
+                cd* work = scratch[w].data();
+                for (std::size_t k = 0; k < nfft; ++k)
+                    work[k] = std::conj(a[k]) * s[k];
+                plan.inverse(work);
+                for (std::size_t l = 0; l <= L; ++l)
+                    positive[p][l] += work[L - l].real();
+            });
+        }
+    }
+
+    full.assign(pairs.size(), std::vector<double>(2 * L + 1));
+    std::vector<CorrelationPeak> peaks(pairs.size());
+    for (std::size_t p = 0; p < pairs.size(); ++p) {
+        for (std::size_t l = 0; l <= L; ++l) {
+            full[p][L + l] = positive[2 * p][l];
+            full[p][L - l] = positive[2 * p + 1][l];
+        }
+        double value;
+        double position = CrossCorrelator::refine_peak(full[p].data(), 0, 2 * L, value);
+        double scale = std::sqrt(energy[pairs[p].first] * energy[pairs[p].second]);
+        peaks[p] = {pairs[p].first, pairs[p].second, position - static_cast<double>(L), value,
+                    scale > 0.0 ? value / scale : 0.0};
+    }
+    return peaks;
+}
+
+#endif
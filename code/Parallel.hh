@@ -0,0 +1,70 @@
+#ifndef PARALLEL_HH
+#define PARALLEL_HH
+
+#include <thread>
+#include <vector>
+#include <atomic>
+#include <algorithm>
+#include <exception>
+#include <mutex>
+#include <cstddef>
+
+// Number of worker threads to use when the caller passes 0.
+inline unsigned default_threads() {
+    unsigned n = std::thread::hardware_concurrency();
+    return n == 0 ? 1 : n;
+}
+
+// Worker count parallel_for will actually use for n tasks.
+inline unsigned resolve_threads(unsigned threads, std::size_t n) {
+    if (threads == 0)
+        threads = default_threads();
+    return static_cast<unsigned>(std::min<std::size_t>(threads, std::max<std::size_t>(n, 1)));
+}
+
+// Runs body(i, worker) for i in [0, n) on up to `threads` workers. Indices are
+// handed out one at a time, so uneven task costs balance themselves. The
+// worker id (< resolve_threads(threads, n)) lets callers keep per-thread scratch.
+// The first exception thrown by a task is rethrown on the calling thread.
+template <typename Body>
+unsigned parallel_for(std::size_t n, unsigned threads, Body&& body) {
+    threads = resolve_threads(threads, n);
+
+    std::atomic<std::size_t> next{0};
+    std::exception_ptr error;
+    std::mutex error_mutex;
+
+    auto worker = [&](unsigned id) {
+        for (;;) {
+            std::size_t i = next.fetch_add(1);
+            if (i >= n)
+                return;
+            try {
+                body(i, id);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(error_mutex);
+                if (!error)
+                    error = std::current_exception();
+                next.store(n);
+                return;
+            }
+        }
+    };
+
+    if (threads == 1) {
+        worker(0);
+    } else {
+        std::vector<std::thread> pool;
+        pool.reserve(threads - 1);
+        for (unsigned t = 1; t < threads; ++t)
+            pool.emplace_back(worker, t);
+        worker(0);
+        for (auto& t : pool)
+            t.join();
+    }
+    if (error)
+        std::rethrow_exception(error);
+    return threads;
+}
+
+#endif
@@ -0,0 +1,219 @@
+#ifndef RESAMPLER_HH
+#define RESAMPLER_HH
+
+#include "Simd.hh"
+#include "Parallel.hh"
+
+#include <vector>
+#include <cmath>
+#include <numeric>
+#include <cstddef>
+#include <algorithm>
+#include <stdexcept>
+
+struct FIRDesign {
+    // Modified Bessel function I0 by its power series (converges for all x).
+    static double bessel_i0(double x) {
+        double term = 1.0, sum = 1.0, q = 0.25 * x * x;
+        for (int k = 1; k < 200 && term > 1e-17 * sum; ++k) {
+            term *= q / (static_cast<double>(k) * static_cast<double>(k));
+            sum += term;
+        }
+        return sum;
+    }
+
+    // Kaiser-windowed sinc low-pass of `taps` coefficients with cutoff relative
+    // to Nyquist, scaled to unit DC gain (scipy.signal.firwin(taps, cutoff,
+    // window=('kaiser', beta))).
+    static std::vector<double> kaiser_lowpass(std::size_t taps, double cutoff, double beta) {
+        if (taps == 0 || !(cutoff > 0.0 && cutoff <= 1.0))
+            throw std::invalid_argument("kaiser_lowpass: need taps > 0 and 0 < cutoff <= 1");
+        std::vector<double> h(taps);
+        const double alpha = 0.5 * static_cast<double>(taps - 1);
+        const double norm = bessel_i0(beta);
+        double sum = 0.0;
+        for (std::size_t k = 0; k < taps; ++k) {
+            const double m = static_cast<double>(k) - alpha;
+            const double r = alpha > 0.0 ? m / alpha : 0.0;
+            const double window = bessel_i0(beta * std::sqrt(std::max(0.0, 1.0 - r * r))) / norm;
+            const double t = cutoff * m;
+            const double sinc = t == 0.0 ? 1.0 : std::sin(M_PI * t) / (M_PI * t);
+            h[k] = cutoff * sinc * window;
+            sum += h[k];
+        }
+        for (double& v : h)
+            v /= sum;
+        return h;
+    }
+
+    // The anti-aliasing filter scipy.signal.resample_poly uses for up/down
+    // (already reduced): 20 * max(up, down) + 1 taps, cutoff 1 / max(up, down),
+    // Kaiser beta 5, gain `up`.
+    static std::vector<double> resample_filter(std::size_t up, std::size_t down, double beta = 5.0) {
+        const std::size_t rate = std::max(up, down);
+        auto h = kaiser_lowpass(20 * rate + 1, 1.0 / static_cast<double>(rate), beta);
+        for (double& v : h)
+            v *= static_cast<double>(up);
+        return h;
+    }
+};
+
+// Rational up/down resampling of one channel by a polyphase FIR bank: only
+// the outputs that are kept are computed, and each costs one dot product of
+// ceil(taps / up) coefficients. With a filter of L taps, output m is
+//   y[m] = sum_j h[j] u[m * down + (L - 1) / 2 - j],
+// u being x upsampled by `up` with zeros, i.e. the delay-compensated output
+// of scipy.signal.resample_poly. Input may arrive in chunks of any size;
+// outputs are produced as soon as their last input is in, so a chunked run
+// equals a single call exactly.
+class PolyphaseChannel {
+private:
+    std::size_t up, down, offset, K;
+    const std::vector<double>* bank;      // [phase][K], taps reversed
+    std::vector<double> buffer;           // inputs from index `base` on
+    std::ptrdiff_t base;
+    std::size_t received = 0;
+    std::size_t produced = 0;
+
+    // Inputs needed by output m: x[i - K + 1 .. i], phase p
+    std::size_t newest(std::size_t m) const { return (m * down + offset) / up; }
+
+    void emit(std::vector<double>& out) {
+        const std::size_t n = newest(produced);
+        const std::size_t phase = (produced * down + offset) % up;
+        const double* x = buffer.data() + (static_cast<std::ptrdiff_t>(n) - static_cast<std::ptrdiff_t>(K) + 1 - base);
+        out.push_back(simd_dot(bank->data() + phase * K, x, K));
+        ++produced;
+    }
+
+    void compact() {
+        const std::ptrdiff_t keep_from = static_cast<std::ptrdiff_t>(newest(produced)) - static_cast<std::ptrdiff_t>(K) + 1;
+        if (keep_from > base + static_cast<std::ptrdiff_t>(buffer.size() / 2)) {
+            const std::size_t drop = static_cast<std::size_t>(std::min<std::ptrdiff_t>(
+                keep_from - base, static_cast<std::ptrdiff_t>(buffer.size())));
+            buffer.erase(buffer.begin(), buffer.begin() + static_cast<std::ptrdiff_t>(drop));
+            base += static_cast<std::ptrdiff_t>(drop);
+        }
+    }
+
+public:
+    PolyphaseChannel(std::size_t up, std::size_t down, std::size_t offset, std::size_t K,
+                     const std::vector<double>* bank)
+        : up(up), down(down), offset(offset), K(K), bank(bank), buffer(K - 1, 0.0),
+          base(-static_cast<std::ptrdiff_t>(K) + 1) {}
+
+    void reset() {
+        buffer.assign(K - 1, 0.0);
+        base = -static_cast<std::ptrdiff_t>(K) + 1;
+        received = produced = 0;
+    }
+
+    std::size_t outputs() const { return produced; }
+
+    void process(const double* x, std::size_t n, std::vector<double>& out) {
+        buffer.insert(buffer.end(), x, x + n);
+        received += n;
+        while (newest(produced) < received)
+            emit(out);
+        compact();
+    }
+
+    // Zero-extends the record so that every output up to ceil(received * up / down) exists.
+    void finish(std::vector<double>& out) {
+        const std::size_t total = (received * up + down - 1) / down;
+        while (produced < total) {
+            const std::size_t need = newest(produced) + 1;
+            if (need > received) {
+                buffer.resize(buffer.size() + (need - received), 0.0);
+                received = need;
+            }
+            emit(out);
+        }
+    }
+};
+
+// Multichannel polyphase resampler by up/down (reduced by their gcd); up = 1
+// is a plain decimator. Blocks are [channel][sample]; channels run in
+// parallel and keep their own history across blocks.
+class Resampler {
+private:
+    std::size_t up_, down_;
+    std::vector<double> taps;
+    std::vector<double> bank;
+    std::size_t K;
+    std::vector<PolyphaseChannel> states;
+
+public:
+    Resampler(std::size_t channels, std::size_t up, std::size_t down, std::vector<double> filter = {}) {
+        if (channels == 0 || up == 0 || down == 0)
+            throw std::invalid_argument("Resampler: need channels, up and down > 0");
+        const std::size_t g = std::gcd(up, down);
+        up_ = up / g;
+        down_ = down / g;
+        taps = filter.empty() ? FIRDesign::resample_filter(up_, down_) : std::move(filter);
+
+        // Phase p holds h[p], h[p + up], ... reversed, so it lines up with x[i - K + 1 .. i]
+        K = (taps.size() + up_ - 1) / up_;
+        bank.assign(up_ * K, 0.0);
+        for (std::size_t p = 0; p < up_; ++p)
+            for (std::size_t k = 0; k < K && p + k * up_ < taps.size(); ++k)
+                bank[p * K + (K - 1 - k)] = taps[p + k * up_];
+
+        const std::size_t offset = (taps.size() - 1) / 2;
+        for (std::size_t c = 0; c < channels; ++c)
+            states.emplace_back(up_, down_, offset, K, &bank);
+    }
+
+    Resampler(const Resampler&) = delete;
+    Resampler& operator=(const Resampler&) = delete;
+
+    std::size_t n_channels() const { return states.size(); }
+    std::size_t up() const { return up_; }
+    std::size_t down() const { return down_; }
+    const std::vector<double>& filter() const { return taps; }
+    std::size_t outputs() const { return states[0].outputs(); }
+
+    void reset() {
+        for (auto& s : states)
+            s.reset();
+    }
+
+    // Returns [channel][m] for the outputs completed by this block
+    std::vector<double> process(const double* data, std::size_t n, unsigned threads = 0) {
+        std::vector<std::vector<double>> out(states.size());
+        parallel_for(states.size(), threads, [&](std::size_t c, unsigned) {
+            states[c].process(data + c * n, n, out[c]);
+        });
+        return join(out);
+    }
+
+    std::vector<double> finish() {
+        std::vector<std::vector<double>> out(states.size());
+        for (std::size_t c = 0; c < states.size(); ++c)
+            states[c].finish(out[c]);
+        return join(out);
+    }
+
+    // Every channel produces the same count for the same input, so rows stack.
+    static std::vector<double> join(const std::vector<std::vector<double>>& rows) {
+        std::vector<double> flat;
+        flat.reserve(rows.size() * rows[0].size());
+        for (const auto& r : rows)
+            flat.insert(flat.end(), r.begin(), r.end());
+        return flat;
+    }
+
+    // Whole record in one call: ceil(n * up / down) outputs per channel
+    static std::vector<double> resample(const double* data, std::size_t channels, std::size_t n, std::size_t up,
+                                        std::size_t down, unsigned threads = 0) {
+        Resampler r(channels, up, down);
+        std::vector<std::vector<double>> out(channels);
+        parallel_for(channels, threads, [&](std::size_t c, unsigned) {
+            r.states[c].process(data + c * n, n, out[c]);
+            r.states[c].finish(out[c]);
+        });
+        return join(out);
+    }
+};
+
+#endif
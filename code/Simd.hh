@@ -0,0 +1,96 @@
+#ifndef SIMD_HH
+#define SIMD_HH
+
+#include <cstddef>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// Packed doubles in the widest register the compiler targets: AVX (4 lanes),
+// NEON or SSE2 (2 lanes), or a plain scalar otherwise. Only the handful of
+// operations the streaming kernels need are provided.
+struct SimdDouble {
+#if defined(__AVX__)
+    static constexpr std::size_t width = 4;
+    __m256d v;
+    static SimdDouble load(const double* p) { return {_mm256_loadu_pd(p)}; }
+    static SimdDouble broadcast(double x) { return {_mm256_set1_pd(x)}; }
+    static SimdDouble zero() { return {_mm256_setzero_pd()}; }
+    void store(double* p) const { _mm256_storeu_pd(p, v); }
+    friend SimdDouble operator+(SimdDouble a, SimdDouble b) { return {_mm256_add_pd(a.v, b.v)}; }
+    friend SimdDouble operator*(SimdDouble a, SimdDouble b) { return {_mm256_mul_pd(a.v, b.v)}; }
+    double sum() const {
+        __m128d s = _mm_add_pd(_mm256_castpd256_pd128(v), _mm256_extractf128_pd(v, 1));
+        return _mm_cvtsd_f64(_mm_add_sd(s, _mm_unpackhi_pd(s, s)));
+    }
+#elif defined(__ARM_NEON)
+    static constexpr std::size_t width = 2;
+    float64x2_t v;
+    static SimdDouble load(const double* p) { return {vld1q_f64(p)}; }
+    static SimdDouble broadcast(double x) { return {vdupq_n_f64(x)}; }
+    static SimdDouble zero() { return {vdupq_n_f64(0.0)}; }
+    void store(double* p) const { vst1q_f64(p, v); }
+    friend SimdDouble operator+(SimdDouble a, SimdDouble b) { return {vaddq_f64(a.v, b.v)}; }
+    friend SimdDouble operator*(SimdDouble a, SimdDouble b) { return {vmulq_f64(a.v, b.v)}; }
+    double sum() const { return vaddvq_f64(v); }
+#elif defined(__SSE2__)
+    static constexpr std::size_t width = 2;
+    __m128d v;
+    static SimdDouble load(const double* p) { return {_mm_loadu_pd(p)}; }
+    static SimdDouble broadcast(double x) { return {_mm_set1_pd(x)}; }
+    static SimdDouble zero() { return {_mm_setzero_pd()}; }
+    void store(double* p) const { _mm_storeu_pd(p, v); }
+    friend SimdDouble operator+(SimdDouble a, SimdDouble b) { return {_mm_add_pd(a.v, b.v)}; }
+    friend SimdDouble operator*(SimdDouble a, SimdDouble b) { return {_mm_mul_pd(a.v, b.v)}; }
+    double sum() const { return _mm_cvtsd_f64(_mm_add_sd(v, _mm_unpackhi_pd(v, v))); }
+#else
+    static constexpr std::size_t width = 1;
+    double v;
+    static SimdDouble load(const double* p) { return {*p}; }
+    static SimdDouble broadcast(double x) { return {x}; }
+    static SimdDouble zero() { return {0.0}; }
+    void store(double* p) const { *p = v; }
+    friend SimdDouble operator+(SimdDouble a, SimdDouble b) { return {a.v + b.v}; }
+    friend SimdDouble operator*(SimdDouble a, SimdDouble b) { return {a.v * b.v}; }
+    double sum() const { return v; }
+#endif
+};
+
+// out[k] = a[k] * factor; out may alias a.
+inline void simd_scale(const double* a, double factor, double* out, std::size_t n) {
+    const std::size_t W = SimdDouble::width;
+    const SimdDouble f = SimdDouble::broadcast(factor);
+    std::size_t k = 0;
+    for (; k + 2 * W <= n; k += 2 * W) {
+        SimdDouble p0 = SimdDouble::load(a + k) * f;
+        SimdDouble p1 = SimdDouble::load(a + k + W) * f;
+        p0.store(out + k);
+        p1.store(out + k + W);
+    }
+    for (; k < n; ++k)
+        out[k] = a[k] * factor;
+}
+
+// sum_k a[k] * b[k] with four independent accumulators.
+inline double simd_dot(const double* a, const double* b, std::size_t n) {
+    const std::size_t W = SimdDouble::width;
+    SimdDouble s0 = SimdDouble::zero(), s1 = s0, s2 = s0, s3 = s0;
+    std::size_t k = 0;
+    for (; k + 4 * W <= n; k += 4 * W) {
+        s0 = s0 + SimdDouble::load(a + k) * SimdDouble::load(b + k);
+        s1 = s1 + SimdDouble::load(a + k + W) * SimdDouble::load(b + k + W);
+        s2 = s2 + SimdDouble::load(a + k + 2 * W) * SimdDouble::load(b + k + 2 * W);
+        s3 = s3 + SimdDouble::load(a + k + 3 * W) * SimdDouble::load(b + k + 3 * W);
+    }
+    double sum = ((s0 + s1) + (s2 + s3)).sum();
+    for (; k < n; ++k)
+        sum += a[k] * b[k];
+    return sum;
+}
+
+#endif
@@ -0,0 +1,85 @@
+#ifndef STRAIN_CONVERTER_HH
+#define STRAIN_CONVERTER_HH
+
+#include "Simd.hh"
+#include "Parallel.hh"
+
+#include <vector>
+#include <algorithm>
+#include <type_traits>
+#include <cstddef>
+#include <stdexcept>
+
+// Bridge and material constants of one gauge channel.
+struct ChannelCalibration {
+    double Vex = 4.98;            // excitation voltage (V)
+    double GF = 2.12;             // gauge factor
+    double Gain = 1000.0;         // amplifier gain
+    double E = 51e9;              // Young's modulus (Pa)
+    double nu = 0.25;             // Poisson's ratio
+
+    // stress = voltage * factor: voltage_to_strain followed by shear_strain_to_stress
+    double factor() const {
+        double G = E / (2.0 * (1.0 + nu));
+        return G * 2.0 / (Vex * Gain * GF);
+    }
+};
+
+// Fused raw voltage -> strain -> shear stress for multichannel blocks laid out
+// [channel][sample], the layout of filtfilt_channels and CrossCorrelator. Each
+// stage of the Python chain is linear, so the whole conversion collapses to
+// one multiply per sample by a per-channel factor, a contiguous scaled copy of
+// every row. Samples may be float or double on either side, converted within
+// the same pass, so float32 records are converted without a staging copy and
+// can be converted in place.
+class StrainConverter {
+private:
+    std::vector<double> factors;
+
+    static constexpr std::size_t block_samples = 1 << 16;
+
+    template <typename T, typename U>
+    static void scale(const T* in, double factor, U* out, std::size_t n) {
+        if constexpr (std::is_same<T, double>::value && std::is_same<U, double>::value) {
+            simd_scale(in, factor, out, n);
+        } else {
+            for (std::size_t k = 0; k < n; ++k)
+                out[k] = static_cast<U>(factor * static_cast<double>(in[k]));
+        }
+    }
+
+public:
+    explicit StrainConverter(const std::vector<ChannelCalibration>& calibration) {
+        if (calibration.empty())
+            throw std::invalid_argument("StrainConverter: need at least one channel");
+        for (const ChannelCalibration& c : calibration)
+            factors.push_back(c.factor());
+    }
+
+    std::size_t n_channels() const { return factors.size(); }
+
+    double factor(std::size_t channel) const { return factors[channel]; }
+
+    // Converts channels x `samples` values from `in` into `out`, both
+    // [channel][sample]. `out` may be the same buffer as `in` when T and U
+    // match. Long records are split into blocks of every row across threads.
+    template <typename T, typename U>
+    void process(const T* in, std::size_t samples, U* out, unsigned threads = 1) const {
+        const std::size_t blocks = std::max<std::size_t>(1, (samples + block_samples - 1) / block_samples);
+        const std::size_t n_tasks = factors.size() * blocks;
+        if (n_tasks <= 1 || threads == 1) {
+            for (std::size_t c = 0; c < factors.size(); ++c)
+                scale(in + c * samples, factors[c], out + c * samples, samples);
+            return;
+        }
+        parallel_for(n_tasks, threads, [&](std::size_t t, unsigned) {
+            const std::size_t c = t / blocks;
+            const std::size_t first = (t % blocks) * block_samples;
+            const std::size_t count = std::min(block_samples, samples - first);
+            const std::size_t offset = c * samples + first;
+            scale(in + offset, factors[c], out + offset, count);
+        });
+    }
+};
+
+#endif
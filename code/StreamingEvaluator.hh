@@ -0,0 +1,190 @@
+#ifndef STREAMING_EVALUATOR_HH
+#define STREAMING_EVALUATOR_HH
+
+#include "CohesiveCrack.hh"
+#include "FFT.hh"
+
+#include <vector>
+#include <complex>
+#include <cstddef>
+#include <algorithm>
+#include <stdexcept>
+
+// Slides a fixed model trace along a continuous record and emits, for every
+// t0 hypothesis, the mean squared residual between the record window and the
+// model. With demean set, both the record window and the model are compared
+// about their means, so baseline offsets do not bias the scan. The record is
+// consumed in blocks of any size; only the last window - 1 samples are carried
+// between blocks, so memory stays bounded.
+//
+// The record-model products come from overlap-save FFT against the model
+// spectrum (direct dot products when a block completes only a few windows),
+// and the window sums slide sample by sample across blocks, so the cost per
+// sample is O(log nfft) instead of O(window).
+class StreamingEvaluator {
+private:
+    using cd = std::complex<double>;
+
+    std::vector<double> model;
+    std::size_t center;
+    bool demean;
+
+    double model_sum_sq = 0.0;
+
+    std::size_t nfft;
+    std::size_t direct_limit;     // below this many outputs per segment, dot products are cheaper
+    FFTPlan plan;
+    std::vector<cd> spectrum;     // conj(FFT(model))
+    std::vector<cd> work;
+
+    std::vector<double> buffer;   // carried tail + current block
+    std::size_t consumed = 0;     // samples dropped from the front of the stream
+
+    // Sums of (d - offset) and (d - offset)^2 over buffer[0 .. window - 1),
+    // recomputed every refresh_interval outputs to bound rounding drift
+    double offset = 0.0;
+    double tail_sum = 0.0;
+    double tail_sum_sq = 0.0;
+    bool sums_valid = false;
+    std::size_t since_refresh = 0;
+    std::size_t refresh_interval;
+
+    static std::size_t choose_nfft(std::size_t length) {
+        return FFTPlan::next_pow2(std::max<std::size_t>(4 * length, 4096));
+    }
+
+    static double dot(const double* a, const double* b, std::size_t n) {
+        double s0 = 0.0, s1 = 0.0, s2 = 0.0, s3 = 0.0;
+        std::size_t i = 0;
+        for (; i + 4 <= n; i += 4) {
+            s0 += a[i] * b[i];
+            s1 += a[i + 1] * b[i + 1];
+            s2 += a[i + 2] * b[i + 2];
+            s3 += a[i + 3] * b[i + 3];
+        }
+        for (; i < n; ++i)
+            s0 += a[i] * b[i];
+        return (s0 + s1) + (s2 + s3);
+    }
+
+    void refresh() {
+        // Only a demeaned residual is invariant to the offset
+        offset = demean ? buffer[0] : 0.0;
+        tail_sum = 0.0;
+        tail_sum_sq = 0.0;
+        for (std::size_t i = 0; i + 1 < model.size(); ++i) {
+            double d = buffer[i] - offset;
+            tail_sum += d;
+            tail_sum_sq += d * d;
+        }
+        sums_valid = true;
+        since_refresh = 0;
+    }
+
+public:
+    StreamingEvaluator(std::vector<double> model_trace, std::size_t center, bool demean = true)
+        : model(std::move(model_trace)), center(center), demean(demean),
+          nfft(choose_nfft(model.size())), plan(nfft) {
+        if (model.empty())
+            throw std::invalid_argument("StreamingEvaluator: empty model trace");
+        if (center >= model.size())
+            throw std::invalid_argument("StreamingEvaluator: center outside the model trace");
+        if (demean) {
+            double mean = 0.0;
+            for (double m : model)
+                mean += m;
+            mean /= static_cast<double>(model.size());
+            for (double& m : model)
+                m -= mean;
+        }
+        for (double m : model)
+            model_sum_sq += m * m;
+
+        spectrum.assign(nfft, cd(0.0, 0.0));
+        for (std::size_t k = 0; k < model.size(); ++k)
+            spectrum[k] = model[k];
+        plan.forward(spectrum.data());
+        for (cd& s : spectrum)
+            s = std::conj(s);
+        work.resize(nfft);
+
+        // A forward and an inverse transform cost roughly 4 nfft log2(nfft)
+        // multiply-adds against window per direct output
+        std::size_t log2_nfft = 0;
+        while ((std::size_t(1) << log2_nfft) < nfft)
+            ++log2_nfft;
+        direct_limit = 4 * nfft * log2_nfft / model.size();
+        refresh_interval = 64 * model.size();
+        buffer.reserve(nfft);
+    }
+
+    std::size_t window() const { return model.size(); }
+
+    // Sample index (in the whole stream) of the t0 belonging to the next
+    // residual that push() will emit.
+    std::size_t next_t0() const { return consumed + center; }
+
+    // Appends n samples and writes one residual per completed window to out.
+    // Returns the number of residuals written; out must hold at least n.
+    std::size_t push(const double* block, std::size_t n, double* out) {
+        const std::size_t W = model.size();
+        buffer.insert(buffer.end(), block, block + n);
+        if (buffer.size() < W)
+            return 0;
+        if (!sums_valid || since_refresh >= refresh_interval)
+            refresh();
+
+        const std::size_t n_out = buffer.size() - W + 1;
+        const std::size_t hop = nfft - W + 1;
+        const double inv_W = 1.0 / static_cast<double>(W);
+        for (std::size_t start = 0; start < n_out; start += hop) {
+            const std::size_t count = std::min(hop, n_out - start);
+            const bool direct = count < direct_limit;
+            if (!direct) {
+                const std::size_t available = std::min(nfft, buffer.size() - start);
+                for (std::size_t k = 0; k < available; ++k)
+                    work[k] = cd(buffer[start + k], 0.0);
+                std::fill(work.begin() + available, work.end(), cd(0.0, 0.0));
+                plan.forward(work.data());
+                for (std::size_t k = 0; k < nfft; ++k)
+                    work[k] *= spectrum[k];
+                plan.inverse(work.data());
+            }
+            for (std::size_t k = 0; k < count; ++k) {
+                const std::size_t s = start + k;
+                double entering = buffer[s + W - 1] - offset;
+                double sum_d = tail_sum + entering;
+                double sum_dd = tail_sum_sq + entering * entering;
+                double sum_dm = direct ? dot(buffer.data() + s, model.data(), W) : work[k].real();
+                // With a zero-mean model: sum (d - dbar - m)^2 = sum d^2 - W dbar^2 - 2 sum d m + sum m^2
+                double ssr = sum_dd - 2.0 * sum_dm + model_sum_sq;
+                if (demean)
+                    ssr -= sum_d * sum_d * inv_W;
+                out[s] = (ssr > 0.0 ? ssr : 0.0) * inv_W;
+
+                double leaving = buffer[s] - offset;
+                tail_sum = sum_d - leaving;
+                tail_sum_sq = sum_dd - leaving * leaving;
+            }
+        }
+
+        buffer.erase(buffer.begin(), buffer.begin() + n_out);
+        consumed += n_out;
+        since_refresh += n_out;
+        return n_out;
+    }
+
+    std::vector<double> push(const std::vector<double>& block) {
+        std::vector<double> out(block.size());
+        out.resize(push(block.data(), block.size(), out.data()));
+        return out;
+    }
+
+    void reset() {
+        buffer.clear();
+        consumed = 0;
+        sums_valid = false;
+    }
+};
+
+#endif
@@ -0,0 +1,308 @@
+#ifndef TEMPLATE_BANK_HH
+#define TEMPLATE_BANK_HH
+
+#include "CohesiveCrack.hh"
+#include "FFT.hh"
+#include "Parallel.hh"
+
+#include <vector>
+#include <complex>
+#include <cmath>
+#include <cstddef>
+#include <algorithm>
+#include <stdexcept>
+
+struct TemplateParameters {
+    double C_f;
+    double X_c;
+    double y;
+};
+
+// Model waveforms for a grid of (C_f, X_c, y); C_f values at or above the
+// Rayleigh speed are dropped from the grid. Each template is stored with
+// zero mean and unit norm; `norm_*` keeps the norm of the demeaned raw trace so
+// a matched amplitude can be turned back into a Gamma estimate
+// (stress scales with sqrt(Gamma)).
+class TemplateBank {
+public:
+    ModelParameters base;         // material constants and reference Gamma
+    double fs = 0.0;
+    std::size_t length = 0;
+    std::size_t center = 0;
+
+    std::vector<TemplateParameters> parameters;
+    std::vector<double> xy;       // [template][sample]
+    std::vector<double> xx;
+    std::vector<double> norm_xy;
+    std::vector<double> norm_xx;
+
+    std::size_t size() const { return parameters.size(); }
+
+    const double* waveform(StressComponent component, std::size_t i) const {
+        return (component == StressComponent::xy ? xy.data() : xx.data()) + i * length;
+    }
+
+    double norm(StressComponent component, std::size_t i) const {
+        return component == StressComponent::xy ? norm_xy[i] : norm_xx[i];
+    }
+
+    static double normalize(double* w, std::size_t n) {
+        double mean = 0.0;
+        for (std::size_t k = 0; k < n; ++k)
+            mean += w[k];
+        mean /= static_cast<double>(n);
+        double ss = 0.0;
+        for (std::size_t k = 0; k < n; ++k) {
+            w[k] -= mean;
+            ss += w[k] * w[k];
+        }
+        double norm = std::sqrt(ss);
+        if (norm > 0.0)
+            for (std::size_t k = 0; k < n; ++k)
+                w[k] /= norm;
+        return norm;
+    }
+
+    static TemplateBank generate(
+        const ModelParameters& base,
+        const std::vector<double>& C_f_values,
+        const std::vector<double>& X_c_values,
+        const std::vector<double>& y_values,
+        double fs, std::size_t length, std::size_t center,
+        unsigned threads = 0
+    ) {
+        if (length == 0 || center >= length)
+            throw std::invalid_argument("TemplateBank: center must lie inside the template");
+
+        TemplateBank bank;
+        bank.base = base;
+        bank.fs = fs;
+        bank.length = length;
+        bank.center = center;
+        for (double C_f : C_f_values) {
+            // The steady-state solution only exists below the Rayleigh speed (D > 0)
+            if (!(C_f > 0.0 && C_f < base.C_s))
+                continue;
+            double D_value = StressAnalysis::D(StressAnalysis::alpha_s(C_f, base.C_s),
+                                               StressAnalysis::alpha_d(C_f, base.C_d));
+            if (!(D_value > 0.0))
+                continue;
+            for (double X_c : X_c_values)
+                for (double y : y_values)
+                    bank.parameters.push_back({C_f, X_c, y});
+        }
+
+        const std::size_t n = bank.parameters.size();
+        bank.xy.resize(n * length);
+        bank.xx.resize(n * length);
+        bank.norm_xy.resize(n);
+        bank.norm_xx.resize(n);
+
+        parallel_for(n, threads, [&](std::size_t i, unsigned) {
+            ModelParameters p = base;
+            p.C_f = bank.parameters[i].C_f;
+            p.X_c = bank.parameters[i].X_c;
+            p.y = bank.parameters[i].y;
+            auto t_xy = StressAnalysis::model_trace(StressComponent::xy, p, fs, length, center);
+            auto t_xx = StressAnalysis::model_trace(StressComponent::xx, p, fs, length, center);
+            std::copy(t_xy.begin(), t_xy.end(), bank.xy.begin() + i * length);
+            std::copy(t_xx.begin(), t_xx.end(), bank.xx.begin() + i * length);
+            bank.norm_xy[i] = normalize(bank.xy.data() + i * length, length);
+            bank.norm_xx[i] = normalize(bank.xx.data() + i * length, length);
+        });
+        return bank;
+    }
+};
+
+struct Detection {
+    std::size_t t0;               // sample where the tip passes the gauge
+    double score;                 // normalized correlation, in [-1, 1]
+    std::size_t template_index;
+    TemplateParameters parameters;
+    double Gamma;                 // amplitude-matched fracture energy
+};
+
+// Normalized cross-correlation of every template against a continuous record,
+// computed by overlap-save FFT. Segments are processed in bounded batches: the
+// spectra of a batch are computed once, shared by all templates (distributed
+// over threads) and dropped before the next batch, so working memory does not
+// grow with the record length.
+class MatchedFilter {
+private:
+    using cd = std::complex<double>;
+
+    static constexpr std::size_t batch_segments = 16;
+
+    const TemplateBank& bank;
+    StressComponent component;
+    std::size_t nfft;
+    FFTPlan plan;
+    std::vector<cd> spectra;      // conj(FFT(template)), [template][bin]
+
+    static std::size_t choose_nfft(std::size_t length) {
+        return FFTPlan::next_pow2(std::max<std::size_t>(4 * length, 4096));
+    }
+
+public:
+    MatchedFilter(const TemplateBank& bank, StressComponent component)
+        : bank(bank), component(component), nfft(choose_nfft(bank.length)), plan(nfft) {
+        spectra.assign(bank.size() * nfft, cd(0.0, 0.0));
+        for (std::size_t i = 0; i < bank.size(); ++i) {
+            cd* s = spectra.data() + i * nfft;
+            const double* w = bank.waveform(component, i);
+            for (std::size_t k = 0; k < bank.length; ++k)
+                s[k] = w[k];
+            plan.forward(s);
+            for (std::size_t k = 0; k < nfft; ++k)
+                s[k] = std::conj(s[k]);
+        }
+    }
+
+    // Best normalized correlation per window start and the template reaching it.
+    // Windows start at s = 0 .. n - length.
+    void correlate(const double* data, std::size_t n,
+                   std::vector<double>& best_score, std::vector<int>& best_template,
+                   unsigned threads = 0) const {
+        const std::size_t L = bank.length;
+        best_score.clear();
+        best_template.clear();
+        if (n < L)
+            return;
+        const std::size_t n_out = n - L + 1;
+        const std::size_t hop = nfft - L + 1;
+        const std::size_t span = batch_segments * hop;
+        best_score.assign(n_out, 0.0);
+        best_template.assign(n_out, -1);
+
+        const unsigned workers = resolve_threads(threads, bank.size());
+        std::vector<cd> segments(batch_segments * nfft);
+        std::vector<double> inv_norm(span);
+        std::vector<double> prefix(span + L), prefix_sq(span + L);
+        std::vector<std::vector<double>> local_score(workers, std::vector<double>(span));
+        std::vector<std::vector<int>> local_template(workers, std::vector<int>(span));
+        std::vector<std::vector<cd>> scratch(workers, std::vector<cd>(nfft));
+
+        for (std::size_t first = 0; first < n_out; first += span) {
+            const std::size_t count_out = std::min(span, n_out - first);
+            const std::size_t n_segments = (count_out + hop - 1) / hop;
+
+            // Local window norms about the window mean
+            {
+                const std::size_t count_in = count_out + L - 1;
+                const double offset = data[first];
+                prefix[0] = prefix_sq[0] = 0.0;
+                for (std::size_t i = 0; i < count_in; ++i) {
+                    double d = data[first + i] - offset;
+                    prefix[i + 1] = prefix[i] + d;
+                    prefix_sq[i + 1] = prefix_sq[i] + d * d;
+                }
+                for (std::size_t s = 0; s < count_out; ++s) {
+                    double sum = prefix[s + L] - prefix[s];
+                    double ss = prefix_sq[s + L] - prefix_sq[s] - sum * sum / static_cast<double>(L);
+                    inv_norm[s] = ss > 0.0 ? 1.0 / std::sqrt(ss) : 0.0;
+                }
+            }
+
+            // Segment spectra of this batch, shared by all templates
+            parallel_for(n_segments, threads, [&](std::size_t g, unsigned) {
+                cd* seg = segments.data() + g * nfft;
+                const std::size_t start = first + g * hop;
+                for (std::size_t k = 0; k < nfft; ++k)
+                    seg[k] = start + k < n ? cd(data[start + k], 0.0) : cd(0.0, 0.0);
+                plan.forward(seg);
+            });
+
+            for (unsigned w = 0; w < workers; ++w) {
+                std::fill(local_score[w].begin(), local_score[w].begin() + count_out, 0.0);
+                std::fill(local_template[w].begin(), local_template[w].begin() + count_out, -1);
+            }
+
+            // Templates have zero mean, so correlating the raw record equals
+            // correlating the demeaned window.
+            parallel_for(bank.size(), workers, [&](std::size_t i, unsigned w) {
+                const cd* spectrum = spectra.data() + i * nfft;
+                cd* work = scratch[w].data();
+                double* score = local_score[w].data();
+                int* which = local_template[w].data();
+                for (std::size_t g = 0; g < n_segments; ++g) {
+                    const cd* seg = segments.data() + g * nfft;
+                    for (std::size_t k = 0; k < nfft; ++k)
+                        work[k] = seg[k] * spectrum[k];
+                    plan.inverse(work);
+                    const std::size_t start = g * hop;
+                    const std::size_t count = std::min(hop, count_out - start);
+                    for (std::size_t k = 0; k < count; ++k) {
+                        double c = work[k].real() * inv_norm[start + k];
+                        if (which[start + k] < 0 || std::abs(c) > std::abs(score[start + k])) {
+                            score[start + k] = c;
+                            which[start + k] = static_cast<int>(i);
+                        }
+                    }
+                }
+            });
+
+            for (unsigned w = 0; w < workers; ++w)
+                for (std::size_t s = 0; s < count_out; ++s) {
+                    const std::size_t t = first + s;
+                    if (local_template[w][s] >= 0 &&
+                        (best_template[t] < 0 || std::abs(local_score[w][s]) > std::abs(best_score[t]))) {
+                        best_score[t] = local_score[w][s];
+                        best_template[t] = local_template[w][s];
+                    }
+                }
+        }
+    }
+
+    // Peaks of |score| above threshold, at least min_separation samples apart,
+    // strongest first.
+    std::vector<Detection> detect(const double* data, std::size_t n, double threshold,
+                                  std::size_t min_separation, unsigned threads = 0) const {
+        if (!(threshold > 0.0))
+            throw std::invalid_argument("MatchedFilter: threshold must be positive");
+        std::vector<double> score;
+        std::vector<int> which;
+        correlate(data, n, score, which, threads);
+
+        std::vector<std::size_t> candidates;
+        for (std::size_t s = 0; s < score.size(); ++s) {
+            double a = std::abs(score[s]);
+            if (a < threshold || which[s] < 0)
+                continue;
+            bool left = s == 0 || a >= std::abs(score[s - 1]);
+            bool right = s + 1 == score.size() || a > std::abs(score[s + 1]);
+            if (left && right)
+                candidates.push_back(s);
+        }
+        std::sort(candidates.begin(), candidates.end(), [&](std::size_t a, std::size_t b) {
+            return std::abs(score[a]) > std::abs(score[b]);
+        });
+
+        std::vector<Detection> detections;
+        std::vector<std::size_t> accepted;
+        for (std::size_t s : candidates) {
+            bool isolated = std::none_of(accepted.begin(), accepted.end(), [&](std::size_t a) {
+                return (a > s ? a - s : s - a) < min_separation;
+            });
+            if (!isolated)
+                continue;
+            accepted.push_back(s);
+
+            const std::size_t i = static_cast<std::size_t>(which[s]);
+            const double* w = bank.waveform(component, i);
+            double mean = 0.0;
+            for (std::size_t k = 0; k < bank.length; ++k)
+                mean += data[s + k];
+            mean /= static_cast<double>(bank.length);
+            double projection = 0.0;
+            for (std::size_t k = 0; k < bank.length; ++k)
+                projection += (data[s + k] - mean) * w[k];
+            // data ~ a * raw template, raw template ~ sqrt(Gamma)
+            double a = projection / bank.norm(component, i);
+            detections.push_back({s + bank.center, score[s], i, bank.parameters[i],
+                                  bank.base.Gamma * a * a});
+        }
+        return detections;
+    }
+};
+
+#endif
@@ -0,0 +1,261 @@
+#ifndef TEMPLATE_INDEX_HH
+#define TEMPLATE_INDEX_HH
+
+#include "TemplateBank.hh"
+
+#include <vector>
+#include <queue>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+
+struct Neighbour {
+    std::size_t template_index;
+    double distance;              // Euclidean, in PCA feature space
+    int polarity;                 // -1 when the trace matches the inverted template
+};
+
+// Nearest-neighbour search over the normalized waveforms of a TemplateBank.
+// Waveforms are reduced to their leading principal components (block power
+// iteration, no full eigendecomposition) and stored in a k-d tree. A query
+// trace must have the bank length and be aligned so the tip passes at
+// bank.center, e.g. a window cut around a MatchedFilter detection.
+class TemplateIndex {
+private:
+    struct Node {
+        std::size_t begin, end;   // range in order[]
+        int axis;                 // -1 for leaves
+        double split;
+        std::int64_t left, right;
+    };
+
+    static constexpr std::size_t LEAF_SIZE = 8;
+
+    StressComponent component_;
+    std::size_t length = 0;
+    std::size_t n_components = 0;
+    std::vector<double> mean;     // [sample]
+    std::vector<double> basis;    // [component][sample], orthonormal rows
+    std::vector<double> features; // [template][component]
+    std::vector<std::size_t> order;
+    std::vector<Node> nodes;
+
+    static void orthonormalize(std::vector<double>& rows, std::size_t n_rows, std::size_t n_cols) {
+        for (std::size_t r = 0; r < n_rows; ++r) {
+            double* v = rows.data() + r * n_cols;
+            // A rank-deficient bank leaves null directions; retry with unit vectors
+            for (std::size_t attempt = 0; attempt <= n_cols; ++attempt) {
+                for (std::size_t q = 0; q < r; ++q) {
+                    const double* u = rows.data() + q * n_cols;
+                    double d = 0.0;
+                    for (std::size_t c = 0; c < n_cols; ++c)
+                        d += v[c] * u[c];
+                    for (std::size_t c = 0; c < n_cols; ++c)
+                        v[c] -= d * u[c];
+                }
+                double norm = 0.0;
+                for (std::size_t c = 0; c < n_cols; ++c)
+                    norm += v[c] * v[c];
+                norm = std::sqrt(norm);
+                if (norm > 1e-12) {
+                    for (std::size_t c = 0; c < n_cols; ++c)
+                        v[c] /= norm;
+                    break;
+                }
+                std::fill(v, v + n_cols, 0.0);
+                v[(r + attempt) % n_cols] = 1.0;
+            }
+        }
+    }
+
+    std::int64_t build_tree(std::size_t begin, std::size_t end) {
+        Node node{begin, end, -1, 0.0, -1, -1};
+        if (end - begin > LEAF_SIZE) {
+            int axis = 0;
+            double widest = -1.0;
+            for (std::size_t a = 0; a < n_components; ++a) {
+                double lo = features[order[begin] * n_components + a], hi = lo;
+                for (std::size_t i = begin; i < end; ++i) {
+                    double f = features[order[i] * n_components + a];
+                    lo = std::min(lo, f);
+                    hi = std::max(hi, f);
+                }
+                if (hi - lo > widest) {
+                    widest = hi - lo;
+                    axis = static_cast<int>(a);
+                }
+            }
+            if (widest > 0.0) {
+                std::size_t mid = begin + (end - begin) / 2;
+                std::nth_element(order.begin() + begin, order.begin() + mid, order.begin() + end,
+                                 [&](std::size_t a, std::size_t b) {
+                                     return features[a * n_components + axis] < features[b * n_components + axis];
+                                 });
+                node.axis = axis;
+                node.split = features[order[mid] * n_components + axis];
+                std::int64_t id = static_cast<std::int64_t>(nodes.size());
+                nodes.push_back(node);
+                std::int64_t left = build_tree(begin, mid);
+                std::int64_t right = build_tree(mid, end);
+                nodes[id].left = left;
+                nodes[id].right = right;
+                return id;
+            }
+        }
+        nodes.push_back(node);
+        return static_cast<std::int64_t>(nodes.size()) - 1;
+    }
+
+    using HeapEntry = std::pair<double, std::size_t>;   // (squared distance, template)
+
+    void search(std::int64_t id, const double* q, std::size_t k,
+                std::priority_queue<HeapEntry>& heap) const {
+        const Node& node = nodes[id];
+        if (node.axis < 0) {
+            for (std::size_t i = node.begin; i < node.end; ++i) {
+                const double* f = features.data() + order[i] * n_components;
+                double d2 = 0.0;
+                for (std::size_t a = 0; a < n_components; ++a) {
+                    double d = q[a] - f[a];
+                    d2 += d * d;
+                }
+                if (heap.size() < k) {
+                    heap.emplace(d2, order[i]);
+                } else if (d2 < heap.top().first) {
+                    heap.pop();
+                    heap.emplace(d2, order[i]);
+                }
+            }
+            return;
+        }
+        double diff = q[node.axis] - node.split;
+        std::int64_t near = diff < 0.0 ? node.left : node.right;
+        std::int64_t far = diff < 0.0 ? node.right : node.left;
+        search(near, q, k, heap);
+        if (heap.size() < k || diff * diff < heap.top().first)
+            search(far, q, k, heap);
+    }
+
+public:
+    TemplateIndex(const TemplateBank& bank, StressComponent component,
+                  std::size_t n_components = 16, std::size_t iterations = 30)
+        : component_(component), length(bank.length) {
+        const std::size_t N = bank.size();
+        if (N == 0)
+            throw std::invalid_argument("TemplateIndex: empty template bank");
+        if (n_components == 0)
+            throw std::invalid_argument("TemplateIndex: need at least one component");
+        this->n_components = std::min({n_components, N, length});
+
+        mean.assign(length, 0.0);
+        for (std::size_t i = 0; i < N; ++i) {
+            const double* w = bank.waveform(component, i);
+            for (std::size_t s = 0; s < length; ++s)
+                mean[s] += w[s];
+        }
+        for (double& m : mean)
+            m /= static_cast<double>(N);
+
+        std::vector<double> centered(N * length);
+        for (std::size_t i = 0; i < N; ++i) {
+            const double* w = bank.waveform(component, i);
+            for (std::size_t s = 0; s < length; ++s)
+                centered[i * length + s] = w[s] - mean[s];
+        }
+
+        // Subspace iteration: basis <- orthonormalize(X^T X basis)
+        const std::size_t K = this->n_components;
+        basis.assign(K * length, 0.0);
+        std::uint64_t seed = 0x9E3779B97F4A7C15ull;
+        for (double& b : basis) {
+            seed ^= seed << 13;
+            seed ^= seed >> 7;
+            seed ^= seed << 17;
+            b = static_cast<double>(seed >> 11) / 9007199254740992.0 - 0.5;
+        }
+        orthonormalize(basis, K, length);
+        std::vector<double> projected(N * K), next(K * length);
+        for (std::size_t it = 0; it < iterations; ++it) {
+            for (std::size_t i = 0; i < N; ++i)
+                for (std::size_t c = 0; c < K; ++c) {
+                    double d = 0.0;
+                    for (std::size_t s = 0; s < length; ++s)
+                        d += centered[i * length + s] * basis[c * length + s];
+                    projected[i * K + c] = d;
+                }
+            std::fill(next.begin(), next.end(), 0.0);
+            for (std::size_t i = 0; i < N; ++i)
+                for (std::size_t c = 0; c < K; ++c) {
+                    double p = projected[i * K + c];
+                    for (std::size_t s = 0; s < length; ++s)
+                        next[c * length + s] += p * centered[i * length + s];
+                }
+            orthonormalize(next, K, length);
+            basis.swap(next);
+        }
+
+        features.resize(N * K);
+        for (std::size_t i = 0; i < N; ++i)
+            for (std::size_t c = 0; c < K; ++c) {
+                double d = 0.0;
+                for (std::size_t s = 0; s < length; ++s)
+                    d += centered[i * length + s] * basis[c * length + s];
+                features[i * K + c] = d;
+            }
+
+        order.resize(N);
+        std::iota(order.begin(), order.end(), 0);
+        nodes.reserve(2 * N / LEAF_SIZE + 1);
+        build_tree(0, N);
+    }
+
+    std::size_t components() const { return n_components; }
+
+    StressComponent component() const { return component_; }
+
+    // Feature vector of a raw trace (normalized like the bank waveforms).
+    std::vector<double> project(const double* trace, std::size_t n, int polarity = 1) const {
+        if (n != length)
+            throw std::invalid_argument("TemplateIndex: trace length differs from the template length");
+        std::vector<double> w(trace, trace + n);
+        TemplateBank::normalize(w.data(), n);
+        std::vector<double> q(n_components, 0.0);
+        for (std::size_t c = 0; c < n_components; ++c)
+            for (std::size_t s = 0; s < n; ++s)
+                q[c] += (polarity * w[s] - mean[s]) * basis[c * length + s];
+        return q;
+    }
+
+    // k closest templates over both polarities, closest first.
+    std::vector<Neighbour> query(const double* trace, std::size_t n, std::size_t k) const {
+        if (k == 0)
+            throw std::invalid_argument("TemplateIndex: need at least one neighbour");
+        std::vector<Neighbour> hits;
+        for (int polarity : {1, -1}) {
+            std::vector<double> q = project(trace, n, polarity);
+            std::priority_queue<HeapEntry> heap;
+            search(0, q.data(), k, heap);
+            for (; !heap.empty(); heap.pop())
+                hits.push_back({heap.top().second, std::sqrt(heap.top().first), polarity});
+        }
+        std::sort(hits.begin(), hits.end(), [](const Neighbour& a, const Neighbour& b) {
+            return a.distance < b.distance;
+        });
+        std::vector<Neighbour> best;
+        for (const auto& h : hits) {
+            bool seen = std::any_of(best.begin(), best.end(), [&](const Neighbour& b) {
+                return b.template_index == h.template_index;
+            });
+            if (!seen)
+                best.push_back(h);
+            if (best.size() == k)
+                break;
+        }
+        return best;
+    }
+};
+
+#endif
@@ -0,0 +1,259 @@
+#ifndef TRACTION_PROFILE_HH
+#define TRACTION_PROFILE_HH
+
+#include "CohesiveCrack.hh"
+
+#include <vector>
+#include <complex>
+#include <cmath>
+#include <cstddef>
+#include <algorithm>
+#include <stdexcept>
+
+// Cohesive-zone traction tau(s) / tau_p tabulated over s = xi / X_c in [0, 1],
+// xi being the distance behind the tip. Linear interpolation between samples.
+class TractionProfile {
+private:
+    std::vector<double> s;
+    std::vector<double> f;
+
+public:
+    TractionProfile(std::vector<double> s_values, std::vector<double> f_values)
+        : s(std::move(s_values)), f(std::move(f_values)) {
+        if (s.size() < 2 || s.size() != f.size())
+            throw std::invalid_argument("TractionProfile: need at least two (s, tau) samples");
+        for (std::size_t i = 1; i < s.size(); ++i)
+            if (!(s[i] > s[i - 1]))
+                throw std::invalid_argument("TractionProfile: s must be strictly increasing");
+        if (s.front() > 0.0 || s.back() < 1.0)
+            throw std::invalid_argument("TractionProfile: s must cover [0, 1]");
+    }
+
+    // tau = tau_p (1 - s); the profile behind StressAnalysis::M_of_z
+    static TractionProfile linear() {
+        return TractionProfile({0.0, 1.0}, {1.0, 0.0});
+    }
+
+    static TractionProfile constant() {
+        return TractionProfile({0.0, 1.0}, {1.0, 1.0});
+    }
+
+    // tau = tau_p exp(-s / decay), tabulated on n samples
+    static TractionProfile exponential(double decay, std::size_t n = 257) {
+        std::vector<double> s_values(n), f_values(n);
+        for (std::size_t i = 0; i < n; ++i) {
+            s_values[i] = static_cast<double>(i) / static_cast<double>(n - 1);
+            f_values[i] = std::exp(-s_values[i] / decay);
+        }
+        return TractionProfile(std::move(s_values), std::move(f_values));
+    }
+
+    double operator()(double x) const {
+        if (x <= s.front())
+            return f.front();
+        if (x >= s.back())
+            return f.back();
+        std::size_t i = static_cast<std::size_t>(std::upper_bound(s.begin(), s.end(), x) - s.begin());
+        double t = (x - s[i - 1]) / (s[i] - s[i - 1]);
+        return f[i - 1] + t * (f[i] - f[i - 1]);
+    }
+
+    // df/ds of the segment containing x
+    double slope(double x) const {
+        std::size_t i = static_cast<std::size_t>(std::upper_bound(s.begin(), s.end(), x) - s.begin());
+        i = std::min(std::max<std::size_t>(i, 1), s.size() - 1);
+        return (f[i] - f[i - 1]) / (s[i] - s[i - 1]);
+    }
+};
+
+// Evaluates the cohesive-zone kernel for an arbitrary TractionProfile,
+//   M(z) = (sqrt(z) / pi) int_0^X_c tau(xi) / (sqrt(xi) (xi + z)) dxi
+//        = (2 sqrt(r) / pi) tau_p int_0^1 f(u^2) / (u^2 + r) du,   r = z / X_c,
+// which reduces to StressAnalysis::M_of_z for the linear profile. The u
+// integral uses composite 15-point Gauss-Kronrod panels graded toward u = 0.
+// Nodes and profile samples depend only on the profile, so they are built
+// once and shared by every field point and every (X_c, tau_p). Near the
+// cohesive zone the pole of the kernel is removed by singularity subtraction;
+// points whose Gauss/Kronrod difference still exceeds the tolerance fall back
+// to adaptive bisection.
+class ProfileQuadrature {
+private:
+    using cd = std::complex<double>;
+    static constexpr double PI = M_PI;
+
+    static constexpr double XGK[8] = {
+        0.991455371120812639206854697526329, 0.949107912342758524526189684047851,
+        0.864864423359769072789712788640926, 0.741531185599394439863864773280788,
+        0.586087235467691130294144845693013, 0.405845151377397166906606412076961,
+        0.207784955007898467600689403773245, 0.000000000000000000000000000000000};
+    static constexpr double WGK[8] = {
+        0.022935322010529224963732008058970, 0.063092092629978553290700663189204,
+        0.104790010322250183839876322541518, 0.140653259715525918745189590510238,
+        0.169004726639267902826583426598550, 0.190350578064785409913256402421014,
+        0.204432940075298892414161999234649, 0.209482141084727828012999174891714};
+    static constexpr double WG[4] = {
+        0.129484966168869693270611432679082, 0.279705391489276667901467771423780,
+        0.381830050505118944950369775488975, 0.417959183673469387755102040816327};
+
+    TractionProfile profile;
+    double tolerance;
+    std::size_t panels;
+    double intensity_integral;    // int_0^1 f(s) s^(-1/2) ds
+
+    // Flattened nodes over all panels: u^2, Kronrod and Gauss weights, and
+    // the same weights multiplied by f(u^2)
+    std::vector<double> u2;
+    std::vector<double> kronrod_w, gauss_w;
+    std::vector<double> kronrod, gauss;
+
+    template <typename F>
+    static void panel_nodes(double a, double b, F&& emit) {
+        const double c = 0.5 * (a + b), h = 0.5 * (b - a);
+        for (int k = 0; k < 8; ++k) {
+            double wg = (k % 2 == 1) ? WG[k / 2] : 0.0;
+            emit(c - h * XGK[k], h * WGK[k], h * wg);
+            if (k < 7)
+                emit(c + h * XGK[k], h * WGK[k], h * wg);
+        }
+    }
+
+    // 1 / (u^2 + r) in real arithmetic, so node loops vectorize instead of
+    // calling the checked complex division
+    static void reciprocal(double u_sq, double r_re, double r_im, double& v_re, double& v_im) {
+        double a = u_sq + r_re;
+        double inv = 1.0 / (a * a + r_im * r_im);
+        v_re = a * inv;
+        v_im = -r_im * inv;
+    }
+
+    cd adaptive(double a, double b, cd r, cd f0, int depth) const {
+        double k_re = 0.0, k_im = 0.0, g_re = 0.0, g_im = 0.0;
+        panel_nodes(a, b, [&](double u, double wk, double wg) {
+            double v_re, v_im;
+            reciprocal(u * u, r.real(), r.imag(), v_re, v_im);
+            double f_re = profile(u * u) - f0.real(), f_im = -f0.imag();
+            double p_re = f_re * v_re - f_im * v_im, p_im = f_re * v_im + f_im * v_re;
+            k_re += wk * p_re;
+            k_im += wk * p_im;
+            g_re += wg * p_re;
+            g_im += wg * p_im;
+        });
+        cd k_sum(k_re, k_im);
+        if (depth >= 40 || std::hypot(k_re - g_re, k_im - g_im) <= tolerance * std::max(std::abs(k_sum), 1e-300))
+            return k_sum;
+        double m = 0.5 * (a + b);
+        return adaptive(a, m, r, f0, depth + 1) + adaptive(m, b, r, f0, depth + 1);
+    }
+
+    // int_0^1 f(u^2) / (u^2 + r) du. For points in or near the cohesive zone
+    // the pole u^2 = -r sits close to [0, 1]. The profile segment around it,
+    // continued to complex s, is subtracted and integrated in closed form;
+    // the remainder vanishes at the pole and is smooth there.
+    cd integral(cd r) const {
+        const double r_re = r.real(), r_im = r.imag();
+        const double s0 = std::min(std::max(-r_re, 0.0), 1.0);
+        const bool subtract = std::hypot(-r_re - s0, r_im) < 0.25;
+        const cd f0 = subtract ? profile(s0) - profile.slope(s0) * (r + s0) : cd(0.0, 0.0);
+        const double f0_re = f0.real(), f0_im = f0.imag();
+
+        cd sum(0.0, 0.0);
+        double error = 0.0;
+        const std::size_t per_panel = 15;
+        for (std::size_t p = 0; p < panels; ++p) {
+            double k_re = 0.0, k_im = 0.0, g_re = 0.0, g_im = 0.0;
+            for (std::size_t j = p * per_panel; j < (p + 1) * per_panel; ++j) {
+                double v_re, v_im;
+                reciprocal(u2[j], r_re, r_im, v_re, v_im);
+                // (w f(u^2) - w f0) / (u^2 + r), with complex f0
+                double wk_re = kronrod[j] - f0_re * kronrod_w[j], wk_im = -f0_im * kronrod_w[j];
+                double wg_re = gauss[j] - f0_re * gauss_w[j], wg_im = -f0_im * gauss_w[j];
+                k_re += wk_re * v_re - wk_im * v_im;
+                k_im += wk_re * v_im + wk_im * v_re;
+                g_re += wg_re * v_re - wg_im * v_im;
+                g_im += wg_re * v_im + wg_im * v_re;
+            }
+            sum += cd(k_re, k_im);
+            error += std::hypot(k_re - g_re, k_im - g_im);
+        }
+        if (error > tolerance * std::max(std::abs(sum), 1e-300)) {
+            sum = cd(0.0, 0.0);
+            for (std::size_t p = 0; p < panels; ++p)
+                sum += adaptive(edge(p), edge(p + 1), r, f0, 0);
+        }
+        if (subtract) {
+            cd sqrt_r = std::sqrt(r);
+            sum += f0 * std::atan(1.0 / sqrt_r) / sqrt_r;
+        }
+        return sum;
+    }
+
+    double edge(std::size_t p) const {
+        double t = static_cast<double>(p) / static_cast<double>(panels);
+        return t * t;
+    }
+
+public:
+    explicit ProfileQuadrature(TractionProfile profile, std::size_t panels = 8, double tolerance = 1e-10)
+        : profile(std::move(profile)), tolerance(tolerance), panels(std::max<std::size_t>(panels, 1)) {
+        for (std::size_t p = 0; p < this->panels; ++p)
+            panel_nodes(edge(p), edge(p + 1), [&](double u, double wk, double wg) {
+                double f = this->profile(u * u);
+                u2.push_back(u * u);
+                kronrod_w.push_back(wk);
+                gauss_w.push_back(wg);
+                kronrod.push_back(wk * f);
+                gauss.push_back(wg * f);
+            });
+
+        // int_0^1 f(s) s^(-1/2) ds = 2 int_0^1 f(u^2) du
+        intensity_integral = 0.0;
+        for (double w : kronrod)
+            intensity_integral += 2.0 * w;
+    }
+
+    // M(z) for the profile scaled by tau_p
+    cd M_of_z(double tau_p, double X_c, const cd& z) const {
+        cd r = z / X_c;
+        return (2.0 / PI) * tau_p * std::sqrt(r) * integral(r);
+    }
+
+    // Peak traction giving stress intensity K2 with this profile; equals
+    // StressAnalysis::compute_tau_p for the linear profile (integral 4/3).
+    double tau_p(double K2, double X_c) const {
+        return K2 / (std::sqrt(2.0 / PI) * std::sqrt(X_c) * intensity_integral);
+    }
+
+    // Stress component over n field points; the material constants and
+    // tau_p are computed once for the whole batch.
+    void delta_sigma(StressComponent component, const double* x, std::size_t n, double y,
+                     double X_c, double C_f, double C_s, double C_d, double nu,
+                     double Gamma, double E, double* out) const {
+        double alpha_s_value = StressAnalysis::alpha_s(C_f, C_s);
+        double alpha_d_value = StressAnalysis::alpha_d(C_f, C_d);
+        double D_value = StressAnalysis::D(alpha_s_value, alpha_d_value);
+        double A2 = StressAnalysis::compute_A2(C_f, C_s, nu, D_value);
+        double K2 = StressAnalysis::compute_K2(Gamma, E, nu, A2);
+        double tau = tau_p(K2, X_c);
+
+        for (std::size_t i = 0; i < n; ++i) {
+            cd M_z_d = M_of_z(tau, X_c, cd(x[i], alpha_d_value * y));
+            cd M_z_s = M_of_z(tau, X_c, cd(x[i], alpha_s_value * y));
+
+            cd Sxx_tmp, Syy_tmp, Sxy_tmp;
+            StressAnalysis::compute_stress_components(M_z_d, M_z_s, alpha_s_value, alpha_d_value,
+                                                      Sxx_tmp, Syy_tmp, Sxy_tmp);
+            double Sxx, Syy, Sxy;
+            StressAnalysis::compute_stresses(Sxx_tmp, Syy_tmp, Sxy_tmp, alpha_s_value, D_value, Sxx, Syy, Sxy);
+            out[i] = component == StressComponent::xy ? Sxy : Sxx;
+        }
+    }
+
+    double delta_sigma(StressComponent component, double x, double y, double X_c, double C_f,
+                       double C_s, double C_d, double nu, double Gamma, double E) const {
+        double out;
+        delta_sigma(component, &x, 1, y, X_c, C_f, C_s, C_d, nu, Gamma, E, &out);
+        return out;
+    }
+};
+
+#endif
@@ -0,0 +1,157 @@
+#ifndef WORK_STEALING_POOL_HH
+#define WORK_STEALING_POOL_HH
+
+#include "Parallel.hh"
+
+#include <thread>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
+#include <exception>
+#include <cstddef>
+
+// Thread pool for nested, uneven work (files that spawn per-event tasks).
+// Each worker owns a deque: it pushes and pops its own tasks at the back
+// (newest first, cache-warm) and, when empty, steals the oldest task from
+// another worker's front. Tasks may submit further tasks; wait() returns once
+// every task, including those spawned later, has finished, and rethrows the
+// first exception a task threw.
+class WorkStealingPool {
+private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> workers;
+    std::mutex idle_mutex;
+    std::condition_variable wake, done;
+    std::atomic<std::size_t> queued{0};       // in some deque
+    std::atomic<std::size_t> pending{0};      // queued or running
+    std::atomic<std::size_t> round_robin{0};
+    bool stopping = false;
+    std::exception_ptr error;
+
+    struct WorkerSlot {
+        const WorkStealingPool* pool = nullptr;
+        std::size_t index = 0;
+    };
+
+    // Which pool (if any) the calling thread works for
+    static WorkerSlot& current_worker() {
+        thread_local WorkerSlot slot;
+        return slot;
+    }
+
+    // The caller's own deque, or queues.size() when called from outside this pool
+    std::size_t own_queue() const {
+        const WorkerSlot& slot = current_worker();
+        return slot.pool == this ? slot.index : queues.size();
+    }
+
+    bool take(std::size_t self, std::function<void()>& task) {
+        {
+            std::lock_guard<std::mutex> lock(queues[self]->mutex);
+            auto& own = queues[self]->tasks;
+            if (!own.empty()) {
+                task = std::move(own.back());
+                own.pop_back();
+                --queued;
+                return true;
+            }
+        }
+        for (std::size_t k = 1; k < queues.size(); ++k) {
+            Queue& victim = *queues[(self + k) % queues.size()];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (!victim.tasks.empty()) {
+                task = std::move(victim.tasks.front());
+                victim.tasks.pop_front();
+                --queued;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void run(std::size_t self) {
+        current_worker() = {this, self};
+        std::function<void()> task;
+        for (;;) {
+            if (take(self, task)) {
+                try {
+                    task();
+                } catch (...) {
+                    std::lock_guard<std::mutex> lock(idle_mutex);
+                    if (!error)
+                        error = std::current_exception();
+                }
+                task = nullptr;
+                if (--pending == 0) {
+                    std::lock_guard<std::mutex> lock(idle_mutex);
+                    done.notify_all();
+                }
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(idle_mutex);
+            wake.wait(lock, [&] { return stopping || queued.load() > 0; });
+            if (stopping && queued.load() == 0)
+                return;
+        }
+    }
+
+public:
+    explicit WorkStealingPool(unsigned threads = 0) {
+        const unsigned n = threads == 0 ? default_threads() : threads;
+        for (unsigned t = 0; t < n; ++t)
+            queues.push_back(std::make_unique<Queue>());
+        for (unsigned t = 0; t < n; ++t)
+            workers.emplace_back([this, t] { run(t); });
+    }
+
+    ~WorkStealingPool() {
+        {
+            std::lock_guard<std::mutex> lock(idle_mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (auto& w : workers)
+            w.join();
+    }
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    std::size_t size() const { return workers.size(); }
+
+    // From a worker the task goes to its own deque; from outside, round-robin.
+    void submit(std::function<void()> task) {
+        std::size_t target = own_queue();
+        if (target == queues.size())
+            target = round_robin++ % queues.size();
+        ++pending;
+        {
+            std::lock_guard<std::mutex> lock(queues[target]->mutex);
+            queues[target]->tasks.push_back(std::move(task));
+            ++queued;
+        }
+        std::lock_guard<std::mutex> lock(idle_mutex);
+        wake.notify_one();
+    }
+
+    void wait() {
+        std::unique_lock<std::mutex> lock(idle_mutex);
+        done.wait(lock, [&] { return pending.load() == 0; });
+        if (error) {
+            std::exception_ptr e = error;
+            error = nullptr;
+            std::rethrow_exception(e);
+        }
+    }
+};
+
+#endif
@@ -1,8 +1,106 @@
 #include <pybind11/pybind11.h>
-#include "CohesiveCrack.cc"
+#include <pybind11/numpy.h>
+#include <pybind11/stl.h>
+#include "CohesiveCrack.hh"
+#include "StreamingEvaluator.hh"
+#include "TemplateBank.hh"
+#include "TemplateIndex.hh"
+#include "Fitter.hh"
+#include "ModelCache.hh"
+#include "TractionProfile.hh"
+#include "StrainConverter.hh"
+#include "IIRFilter.hh"
+#include "Deconvolution.hh"
+#include "CrossCorrelator.hh"
+#include "NpyReader.hh"
+#include "OutOfCore.hh"
+#include "ExperimentStore.hh"
+#include "EventPicker.hh"
+#include "BatchRunner.hh"
+#include "Resampler.hh"
 
 namespace py = pybind11;
 
+using DoubleArray = py::array_t<double, py::array::c_style | py::array::forcecast>;
+
+static StressComponent parse_component(const std::string& component) {
+    if (component == "xy")
+        return StressComponent::xy;
+    if (component == "xx")
+        return StressComponent::xx;
+    throw std::invalid_argument("component must be 'xy' or 'xx'");
+}
+
+// Butterworth design from scipy-style arguments: cutoff is a float, or a
+// (low, high) pair for btype 'band'
+static SecondOrderSections parse_butterworth(std::size_t order, const py::object& cutoff, double fs,
+                                             const std::string& btype) {
+    if (btype == "low" || btype == "lowpass")
+        return SecondOrderSections::butterworth(order, FilterType::lowpass, fs, cutoff.cast<double>());
+    if (btype == "high" || btype == "highpass")
+        return SecondOrderSections::butterworth(order, FilterType::highpass, fs, cutoff.cast<double>());
+    if (btype == "band" || btype == "bandpass") {
+        auto edges = cutoff.cast<std::vector<double>>();
+        if (edges.size() != 2)
+            throw std::invalid_argument("band-pass cutoff must be (low, high)");
+        return SecondOrderSections::butterworth(order, FilterType::bandpass, fs, edges[0], edges[1]);
+    }
+    throw std::invalid_argument("btype must be 'low', 'high' or 'band'");
+}
+
+// Read-only NumPy view of an NpyArray; the capsule base keeps the mapping or
+// inflated buffer alive for as long as the view (or any slice of it) exists.
+static py::array npy_view(const NpyArray& a) {
+    auto* keep = new std::shared_ptr<const void>(a.keep_alive());
+    py::capsule base(keep, [](void* p) { delete static_cast<std::shared_ptr<const void>*>(p); });
+    std::vector<py::ssize_t> shape(a.shape.begin(), a.shape.end());
+    auto byte_strides = a.strides();
+    std::vector<py::ssize_t> strides(byte_strides.begin(), byte_strides.end());
+    py::array view(py::dtype(a.dtype.descr), shape, strides, a.data(), base);
+    view.attr("setflags")(py::arg("write") = false);
+    return view;
+}
+
+// Scalar or per-channel sequence -> one value per channel
+static std::vector<double> per_channel(const py::object& value, std::size_t channels, const char* name) {
+    if (py::isinstance<py::float_>(value) || py::isinstance<py::int_>(value))
+        return std::vector<double>(channels, value.cast<double>());
+    auto values = value.cast<std::vector<double>>();
+    if (values.size() != channels)
+        throw std::invalid_argument(std::string(name) + " must be a scalar or have one value per channel");
+    return values;
+}
+
+// Picks as a dict of equal-length arrays
+static py::dict pick_dict(const std::vector<Pick>& picks) {
+    const std::size_t n = picks.size();
+    py::array_t<std::size_t> channel(n), trigger(n), onset(n), end(n);
+    py::array_t<int> method(n);
+    DoubleArray ratio(n), amplitude(n), snr(n), aic_contrast(n);
+    for (std::size_t p = 0; p < n; ++p) {
+        channel.mutable_data()[p] = picks[p].channel;
+        trigger.mutable_data()[p] = picks[p].trigger;
+        onset.mutable_data()[p] = picks[p].onset;
+        end.mutable_data()[p] = picks[p].end;
+        method.mutable_data()[p] = static_cast<int>(picks[p].method);
+        ratio.mutable_data()[p] = picks[p].ratio;
+        amplitude.mutable_data()[p] = picks[p].amplitude;
+        snr.mutable_data()[p] = picks[p].snr;
+        aic_contrast.mutable_data()[p] = picks[p].aic_contrast;
+    }
+    py::dict out;
+    out["channel"] = channel;
+    out["trigger"] = trigger;
+    out["onset"] = onset;
+    out["end"] = end;
+    out["method"] = method;
+    out["ratio"] = ratio;
+    out["amplitude"] = amplitude;
+    out["snr"] = snr;
+    out["aic_contrast"] = aic_contrast;
+    return out;
+}
+
 PYBIND11_MODULE(CohesiveCrack, m) {
     m.doc() = "Cohesive crack stress field analysis";
 
@@ -17,4 +115,820 @@ PYBIND11_MODULE(CohesiveCrack, m) {
           py::arg("x"), py::arg("y"), py::arg("X_c"),
           py::arg("C_f"), py::arg("C_s"), py::arg("C_d"),
           py::arg("nu"), py::arg("Gamma"), py::arg("E"));
-}
\ No newline at end of file
+
+    for (auto component : {StressComponent::xy, StressComponent::xx}) {
+        const char* name = component == StressComponent::xy ? "delta_sigma_xy_array" : "delta_sigma_xx_array";
+        m.def(name,
+              [component](DoubleArray x, double y, double X_c, double C_f, double C_s, double C_d,
+                          double nu, double Gamma, double E) {
+                  DoubleArray out(x.size());
+                  {
+                      py::gil_scoped_release release;
+                      ModelCache::instance().delta_sigma(component, x.data(), x.size(), y, X_c, C_f,
+                                                         C_s, C_d, nu, Gamma, E, out.mutable_data());
+                  }
+                  return out;
+              },
+              "Stress component over an array of x, memoized across calls (Gamma/E-only changes rescale a cached trace)",
+              py::arg("x"), py::arg("y"), py::arg("X_c"),
+              py::arg("C_f"), py::arg("C_s"), py::arg("C_d"),
+              py::arg("nu"), py::arg("Gamma"), py::arg("E"));
+    }
+
+    m.def("cache_info", []() {
+        std::size_t constant_hits, constant_misses, trace_hits, trace_misses;
+        ModelCache::instance().stats(constant_hits, constant_misses, trace_hits, trace_misses);
+        py::dict out;
+        out["constant_hits"] = constant_hits;
+        out["constant_misses"] = constant_misses;
+        out["trace_hits"] = trace_hits;
+        out["trace_misses"] = trace_misses;
+        return out;
+    });
+    m.def("cache_clear", []() { ModelCache::instance().clear(); });
+
+    m.def("model_trace",
+          [](const std::string& component, double X_c, double C_f, double C_s, double C_d,
+             double nu, double Gamma, double E, double y,
+             double fs, std::size_t n_samples, std::size_t center) {
+              ModelParameters p{X_c, C_f, C_s, C_d, nu, Gamma, E, y};
+              auto trace = StressAnalysis::model_trace(parse_component(component), p, fs, n_samples, center);
+              return DoubleArray(trace.size(), trace.data());
+          },
+          "Gauge time history of the model with the tip passing at sample `center`",
+          py::arg("component"), py::arg("X_c"), py::arg("C_f"), py::arg("C_s"),
+          py::arg("C_d"), py::arg("nu"), py::arg("Gamma"), py::arg("E"), py::arg("y"),
+          py::arg("fs"), py::arg("n_samples"), py::arg("center"));
+
+    py::class_<StreamingEvaluator>(m, "StreamingEvaluator",
+                                   "Sliding-window model residuals over a continuous record")
+        .def(py::init([](DoubleArray model, std::size_t center, bool demean) {
+                 std::vector<double> trace(model.data(), model.data() + model.size());
+                 return StreamingEvaluator(std::move(trace), center, demean);
+             }),
+             py::arg("model"), py::arg("center"), py::arg("demean") = true)
+        .def("push",
+             [](StreamingEvaluator& self, DoubleArray block) {
+                 DoubleArray out(block.size());
+                 std::size_t n_out;
+                 {
+                     py::gil_scoped_release release;
+                     n_out = self.push(block.data(), block.size(), out.mutable_data());
+                 }
+                 out.resize({static_cast<py::ssize_t>(n_out)});
+                 return out;
+             },
+             "Consume a block and return the residuals of all completed windows",
+             py::arg("block"))
+        .def("reset", &StreamingEvaluator::reset)
+        .def_property_readonly("window", &StreamingEvaluator::window)
+        .def_property_readonly("next_t0", &StreamingEvaluator::next_t0);
+
+    py::class_<TemplateBank>(m, "TemplateBank", "Normalized model waveforms over a (C_f, X_c, y) grid")
+        .def(py::init([](const std::vector<double>& C_f, const std::vector<double>& X_c,
+                         const std::vector<double>& y, double C_s, double C_d, double nu,
+                         double Gamma, double E, double fs, std::size_t length,
+                         std::size_t center, unsigned threads) {
+                 ModelParameters base{0.0, 0.0, C_s, C_d, nu, Gamma, E, 0.0};
+                 py::gil_scoped_release release;
+                 return TemplateBank::generate(base, C_f, X_c, y, fs, length, center, threads);
+             }),
+             py::arg("C_f"), py::arg("X_c"), py::arg("y"), py::arg("C_s"), py::arg("C_d"),
+             py::arg("nu"), py::arg("Gamma"), py::arg("E"), py::arg("fs"), py::arg("length"),
+             py::arg("center"), py::arg("threads") = 0)
+        .def("__len__", &TemplateBank::size)
+        .def_readonly("fs", &TemplateBank::fs)
+        .def_readonly("length", &TemplateBank::length)
+        .def_readonly("center", &TemplateBank::center)
+        .def_property_readonly("parameters", [](const TemplateBank& bank) {
+            py::array_t<double> out({static_cast<py::ssize_t>(bank.size()), py::ssize_t(3)});
+            auto v = out.mutable_unchecked<2>();
+            for (std::size_t i = 0; i < bank.size(); ++i) {
+                v(i, 0) = bank.parameters[i].C_f;
+                v(i, 1) = bank.parameters[i].X_c;
+                v(i, 2) = bank.parameters[i].y;
+            }
+            return out;
+        }, "Template grid as rows of (C_f, X_c, y)")
+        .def("waveforms", [](const TemplateBank& bank, const std::string& component) {
+            const double* w = bank.waveform(parse_component(component), 0);
+            return DoubleArray({static_cast<py::ssize_t>(bank.size()), static_cast<py::ssize_t>(bank.length)}, w);
+        }, py::arg("component") = "xy");
+
+    m.def("match_templates",
+          [](const TemplateBank& bank, DoubleArray data, const std::string& component,
+             double threshold, std::size_t min_separation, unsigned threads) {
+              std::vector<Detection> detections;
+              {
+                  py::gil_scoped_release release;
+                  MatchedFilter filter(bank, parse_component(component));
+                  detections = filter.detect(data.data(), data.size(), threshold, min_separation, threads);
+              }
+              py::list out;
+              for (const auto& d : detections) {
+                  py::dict row;
+                  row["t0"] = d.t0;
+                  row["score"] = d.score;
+                  row["template"] = d.template_index;
+                  row["C_f"] = d.parameters.C_f;
+                  row["X_c"] = d.parameters.X_c;
+                  row["y"] = d.parameters.y;
+                  row["Gamma"] = d.Gamma;
+                  out.append(row);
+              }
+              return out;
+          },
+          "FFT matched-filter detection of rupture arrivals; each hit carries fit initial guesses",
+          py::arg("bank"), py::arg("data"), py::arg("component") = "xy",
+          py::arg("threshold") = 0.7, py::arg("min_separation") = 1000, py::arg("threads") = 0);
+
+    py::class_<TemplateIndex>(m, "TemplateIndex", "PCA + k-d tree nearest-neighbour index over a TemplateBank")
+        .def(py::init([](const TemplateBank& bank, const std::string& component, std::size_t n_components) {
+                 StressComponent c = parse_component(component);
+                 py::gil_scoped_release release;
+                 return TemplateIndex(bank, c, n_components);
+             }),
+             py::arg("bank"), py::arg("component") = "xy", py::arg("n_components") = 16)
+        .def_property_readonly("n_components", &TemplateIndex::components)
+        .def("query", [](const TemplateIndex& index, DoubleArray trace, std::size_t k) {
+            auto hits = index.query(trace.data(), trace.size(), k);
+            py::list out;
+            for (const auto& h : hits) {
+                py::dict row;
+                row["template"] = h.template_index;
+                row["distance"] = h.distance;
+                row["polarity"] = h.polarity;
+                out.append(row);
+            }
+            return out;
+        }, "k closest templates to an aligned trace of the bank length", py::arg("trace"), py::arg("k") = 5);
+
+    m.def("fit_trace",
+          [](const TemplateIndex& index, const TemplateBank& bank, DoubleArray trace, std::size_t k) {
+              FitResult r;
+              {
+                  py::gil_scoped_release release;
+                  r = fit_from_index(index, bank, trace.data(), trace.size(), k);
+              }
+              py::dict out;
+              out["C_f"] = r.C_f;
+              out["X_c"] = r.X_c;
+              out["Gamma"] = r.Gamma;
+              out["y"] = bank.parameters[r.seed_template].y;
+              out["shift"] = r.shift;
+              out["chi2"] = r.chi2;
+              out["evaluations"] = r.evaluations;
+              out["seed_template"] = r.seed_template;
+              out["polarity"] = r.polarity;
+              return out;
+          },
+          "Fit (C_f, X_c, Gamma, t0 shift) to an aligned trace, seeded by the k nearest templates",
+          py::arg("index"), py::arg("bank"), py::arg("trace"), py::arg("k") = 3);
+
+    py::class_<ProfileQuadrature>(m, "TractionProfile",
+                                  "Cohesive-zone traction profile tau(s)/tau_p, s = xi/X_c in [0, 1], with its quadrature rule")
+        .def(py::init([](DoubleArray s, DoubleArray tau, std::size_t panels, double tolerance) {
+                 std::vector<double> s_values(s.data(), s.data() + s.size());
+                 std::vector<double> f_values(tau.data(), tau.data() + tau.size());
+                 return ProfileQuadrature(TractionProfile(std::move(s_values), std::move(f_values)), panels, tolerance);
+             }),
+             py::arg("s"), py::arg("tau"), py::arg("panels") = 8, py::arg("tolerance") = 1e-10)
+        .def_static("linear", []() { return ProfileQuadrature(TractionProfile::linear()); })
+        .def_static("constant", []() { return ProfileQuadrature(TractionProfile::constant()); })
+        .def_static("exponential", [](double decay) { return ProfileQuadrature(TractionProfile::exponential(decay)); },
+                    py::arg("decay"))
+        .def("tau_p", &ProfileQuadrature::tau_p, "Peak traction for stress intensity K2", py::arg("K2"), py::arg("X_c"));
+
+    m.def("delta_sigma_profile",
+          [](const ProfileQuadrature& profile, const std::string& component, DoubleArray x, double y, double X_c,
+             double C_f, double C_s, double C_d, double nu, double Gamma, double E) {
+              StressComponent c = parse_component(component);
+              DoubleArray out(x.size());
+              {
+                  py::gil_scoped_release release;
+                  profile.delta_sigma(c, x.data(), x.size(), y, X_c, C_f, C_s, C_d, nu, Gamma, E, out.mutable_data());
+              }
+              return out;
+          },
+          "Stress component over an array of x for an arbitrary traction profile",
+          py::arg("profile"), py::arg("component"), py::arg("x"), py::arg("y"), py::arg("X_c"),
+          py::arg("C_f"), py::arg("C_s"), py::arg("C_d"),
+          py::arg("nu"), py::arg("Gamma"), py::arg("E"));
+
+    py::class_<StrainConverter>(m, "StrainConverter",
+                                "Fused raw voltage -> shear stress conversion of [channel, sample] blocks")
+        .def(py::init([](std::size_t channels, py::object Vex, py::object GF, py::object Gain,
+                         py::object E, py::object nu) {
+                 auto v = per_channel(Vex, channels, "Vex");
+                 auto gf = per_channel(GF, channels, "GF");
+                 auto gain = per_channel(Gain, channels, "Gain");
+                 auto e = per_channel(E, channels, "E");
+                 auto n = per_channel(nu, channels, "nu");
+                 std::vector<ChannelCalibration> calibration(channels);
+                 for (std::size_t c = 0; c < channels; ++c)
+                     calibration[c] = {v[c], gf[c], gain[c], e[c], n[c]};
+                 return StrainConverter(calibration);
+             }),
+             py::arg("channels"), py::arg("Vex") = 4.98, py::arg("GF") = 2.12, py::arg("Gain") = 1000.0,
+             py::arg("E") = 51e9, py::arg("nu") = 0.25)
+        .def_property_readonly("channels", &StrainConverter::n_channels)
+        .def_property_readonly("factors", [](const StrainConverter& c) {
+            std::vector<double> f(c.n_channels());
+            for (std::size_t i = 0; i < f.size(); ++i)
+                f[i] = c.factor(i);
+            return f;
+        })
+        .def("process", [](const StrainConverter& converter, py::array data, py::object out, unsigned threads) {
+            const std::size_t channels = converter.n_channels();
+            if (data.ndim() > 1 ? static_cast<std::size_t>(data.shape(0)) != channels : channels != 1)
+                throw std::invalid_argument("data must be (channels, samples), or 1-D for a single channel");
+            const std::size_t samples = static_cast<std::size_t>(data.size()) / channels;
+            const bool single = py::isinstance<py::array_t<float>>(data) && (data.flags() & py::array::c_style);
+
+            py::array result;
+            if (out.is_none()) {
+                result = py::array_t<double>(std::vector<py::ssize_t>(data.shape(), data.shape() + data.ndim()));
+            } else {
+                result = out.cast<py::array>();
+                bool float64 = py::isinstance<py::array_t<double>>(result);
+                bool float32 = single && py::isinstance<py::array_t<float>>(result);
+                if (!out.is(result) || !(float64 || float32) || !(result.flags() & py::array::c_style) ||
+                    !result.writeable() || result.size() != data.size())
+                    throw std::invalid_argument("out must be a writable C-contiguous array of the data size, "
+                                                "float64 or (for float32 data) float32");
+            }
+
+            auto run = [&](auto* target) {
+                if (single) {
+                    const float* source = static_cast<const float*>(data.data());
+                    py::gil_scoped_release release;
+                    converter.process(source, samples, target, threads);
+                } else {
+                    auto source = DoubleArray::ensure(data);
+                    const double* p = source.data();
+                    py::gil_scoped_release release;
+                    converter.process(p, samples, target, threads);
+                }
+            };
+            if (py::isinstance<py::array_t<float>>(result))
+                run(static_cast<float*>(result.mutable_data()));
+            else
+                run(static_cast<double*>(result.mutable_data()));
+            return result;
+        },
+        "Convert raw voltages to stress in one pass; pass out=data to convert a float64 or float32 array in place",
+        py::arg("data"), py::arg("out") = py::none(), py::arg("threads") = 1);
+
+    m.def("butter_sos",
+          [](std::size_t order, py::object cutoff, double fs, const std::string& btype) {
+              SecondOrderSections sos = parse_butterworth(order, cutoff, fs, btype);
+              DoubleArray out({static_cast<py::ssize_t>(sos.size()), static_cast<py::ssize_t>(6)});
+              double* p = out.mutable_data();
+              for (const Biquad& q : sos.sections) {
+                  double row[6] = {q.b0, q.b1, q.b2, 1.0, q.a1, q.a2};
+                  p = std::copy(row, row + 6, p);
+              }
+              return out;
+          },
+          "Butterworth design as second-order sections, like scipy.signal.butter(..., output='sos')",
+          py::arg("order"), py::arg("cutoff"), py::arg("fs"), py::arg("btype") = "high");
+
+    m.def("filtfilt",
+          [](DoubleArray data, py::object cutoff, double fs, std::size_t order, const std::string& btype,
+             unsigned threads) {
+              SecondOrderSections sos = parse_butterworth(order, cutoff, fs, btype);
+              if (data.ndim() != 1 && data.ndim() != 2)
+                  throw std::invalid_argument("data must be 1-D or (channels, samples)");
+              const std::size_t samples = static_cast<std::size_t>(data.shape(data.ndim() - 1));
+              const std::size_t channels = data.ndim() == 2 ? static_cast<std::size_t>(data.shape(0)) : 1;
+              DoubleArray out(std::vector<py::ssize_t>(data.shape(), data.shape() + data.ndim()));
+              {
+                  py::gil_scoped_release release;
+                  filtfilt_channels(sos, data.data(), channels, samples, out.mutable_data(), threads);
+              }
+              return out;
+          },
+          "Zero-phase Butterworth filtering along the last axis, as scipy.signal.sosfiltfilt; channels run in parallel",
+          py::arg("data"), py::arg("cutoff"), py::arg("fs"), py::arg("order") = 4, py::arg("btype") = "high",
+          py::arg("threads") = 0);
+
+    m.def("deconvolve",
+          [](DoubleArray signals, DoubleArray reference, double water_level, double damp_ratio,
+             const std::string& stabilizing_type, unsigned threads) {
+              Stabilization type;
+              if (stabilizing_type == "W")
+                  type = Stabilization::water_level;
+              else if (stabilizing_type == "D")
+                  type = Stabilization::damped;
+              else
+                  throw std::invalid_argument("stabilizing_type must be 'W' or 'D'");
+              if (signals.ndim() != 1 && signals.ndim() != 2)
+                  throw std::invalid_argument("signals must be 1-D or (pairs, samples)");
+              const std::size_t n = static_cast<std::size_t>(signals.shape(signals.ndim() - 1));
+              const std::size_t count = signals.ndim() == 2 ? static_cast<std::size_t>(signals.shape(0)) : 1;
+              const bool shared = reference.ndim() == 1;
+              if (static_cast<std::size_t>(reference.shape(reference.ndim() - 1)) != n ||
+                  (!shared && static_cast<std::size_t>(reference.size()) != count * n))
+                  throw std::invalid_argument("reference must have the signal length, one row or one per signal");
+              if (n < 3)
+                  throw std::invalid_argument("signals need at least three samples");
+
+              std::vector<py::ssize_t> shape(signals.shape(), signals.shape() + signals.ndim());
+              shape.back() = static_cast<py::ssize_t>(n - 2);
+              DoubleArray out(shape);
+              {
+                  py::gil_scoped_release release;
+                  if (shared) {
+                      Deconvolver deconvolver(n);
+                      deconvolver.set_reference(reference.data(), type, water_level, damp_ratio);
+                      deconvolver.apply_batch(signals.data(), count, out.mutable_data(), threads);
+                  } else {
+                      deconvolve_pairs(signals.data(), reference.data(), count, n, type, water_level, damp_ratio,
+                                       out.mutable_data(), threads);
+                  }
+              }
+              return out;
+          },
+          "Water-level ('W') or damped ('D') spectral deconvolution of signals by a reference, shifted like "
+          "DataProcessor.do_deconvolution; a single reference row is shared by all signals",
+          py::arg("signals"), py::arg("reference"), py::arg("water_level") = 0.05, py::arg("damp_ratio") = 0.05,
+          py::arg("stabilizing_type") = "W", py::arg("threads") = 0);
+
+    py::class_<CrossCorrelator>(m, "CrossCorrelator",
+                                "Cross-correlations between all channels of a (channels, samples) record from cached spectra")
+        .def(py::init([](DoubleArray data, unsigned threads) {
+                 if (data.ndim() != 2)
+                     throw std::invalid_argument("data must be (channels, samples)");
+                 const std::size_t channels = static_cast<std::size_t>(data.shape(0));
+                 const std::size_t samples = static_cast<std::size_t>(data.shape(1));
+                 py::gil_scoped_release release;
+                 return CrossCorrelator(data.data(), channels, samples, threads);
+             }),
+             py::arg("data"), py::arg("threads") = 0)
+        .def_property_readonly("channels", &CrossCorrelator::n_channels)
+        .def("full", [](const CrossCorrelator& cc, std::size_t i, std::size_t j) {
+            if (i >= cc.n_channels() || j >= cc.n_channels())
+                throw std::out_of_range("channel index out of range");
+            DoubleArray out(cc.full_size());
+            std::vector<std::complex<double>> work;
+            cc.correlate(i, j, out.mutable_data(), work);
+            return out;
+        }, "scipy.signal.correlate(x_i, x_j, 'full') of the detrended channels", py::arg("i"), py::arg("j"))
+        .def("peaks", [](const CrossCorrelator& cc, py::object pairs, std::size_t max_lag, unsigned threads) {
+            auto list = pairs.is_none() ? CrossCorrelator::all_pairs(cc.n_channels())
+                                        : pairs.cast<std::vector<std::pair<std::size_t, std::size_t>>>();
+            std::vector<CorrelationPeak> found;
+            {
+                py::gil_scoped_release release;
+                found = cc.peaks(list, max_lag, threads);
+            }
+            py::array_t<std::size_t> i(found.size()), j(found.size());
+            DoubleArray lag(found.size()), value(found.size()), coefficient(found.size());
+            for (std::size_t p = 0; p < found.size(); ++p) {
+                i.mutable_data()[p] = found[p].i;
+                j.mutable_data()[p] = found[p].j;
+                lag.mutable_data()[p] = found[p].lag;
+                value.mutable_data()[p] = found[p].value;
+                coefficient.mutable_data()[p] = found[p].coefficient;
+            }
+            py::dict out;
+            out["i"] = i;
+            out["j"] = j;
+            out["lag"] = lag;
+            out["value"] = value;
+            out["coefficient"] = coefficient;
+            return out;
+        },
+        "Sub-sample peak lag (samples, > 0 when i lags j) for every pair or the given (i, j) list, "
+        "optionally within |lag| <= max_lag",
+        py::arg("pairs") = py::none(), py::arg("max_lag") = 0, py::arg("threads") = 0);
+
+    m.def("load_npy", [](const std::string& path) { return npy_view(load_npy(path)); },
+          "Memory-map an .npy file as a read-only array", py::arg("path"));
+
+    py::class_<NpzArchive>(m, "NpzFile", "Lazy .npz reader: stored members are memory-mapped, deflated ones streamed")
+        .def(py::init<const std::string&>(), py::arg("path"))
+        .def_property_readonly("names", &NpzArchive::names)
+        .def("compressed", &NpzArchive::compressed, py::arg("name"))
+        .def("shape", [](const NpzArchive& z, const std::string& name) {
+            auto a = z.describe(name);
+            return py::tuple(py::cast(a.shape));
+        }, "Shape of a member without reading its data", py::arg("name"))
+        .def("__contains__", [](const NpzArchive& z, const std::string& name) {
+            auto names = z.names();
+            return std::find(names.begin(), names.end(), name) != names.end();
+        })
+        .def("__getitem__", [](const NpzArchive& z, const std::string& name) {
+            NpyArray a;
+            {
+                py::gil_scoped_release release;
+                a = z.load(name);
+            }
+            return npy_view(a);
+        }, "Whole member as a read-only array (a view into the file for stored members)")
+        .def("window", [](const NpzArchive& z, const std::string& name, std::size_t begin, std::size_t end,
+                          std::size_t axis) {
+            NpyArray a;
+            {
+                py::gil_scoped_release release;
+                a = z.read_window(name, axis, begin, end);
+            }
+            return npy_view(a);
+        }, "Indices [begin, end) along axis without loading the rest of the member",
+        py::arg("name"), py::arg("begin"), py::arg("end"), py::arg("axis") = 0);
+
+    m.def("filter_file",
+          [](const std::string& input, const std::string& output, py::object cutoff, double fs, std::size_t order,
+             const std::string& btype, bool zero_phase, py::object factors, const std::string& member, int time_axis,
+             std::size_t chunk, unsigned threads) {
+              SecondOrderSections sos = parse_butterworth(order, cutoff, fs, btype);
+              ChunkSource source = open_record(input, member, time_axis);
+              if (!factors.is_none())
+                  source = scaled_source(source, per_channel(factors, source.channels, "factors"));
+              py::gil_scoped_release release;
+              filter_out_of_core(source, sos, zero_phase, output, chunk, threads);
+          },
+          "Out-of-core Butterworth filtering of an .npy file (or .npz member) into a (channels, samples) .npy file; "
+          "identical to filtfilt on the whole record when zero_phase is set. factors (e.g. StrainConverter.factors) "
+          "scale each channel while reading",
+          py::arg("input"), py::arg("output"), py::arg("cutoff"), py::arg("fs"), py::arg("order") = 4,
+          py::arg("btype") = "high", py::arg("zero_phase") = true, py::arg("factors") = py::none(),
+          py::arg("member") = "", py::arg("time_axis") = -1, py::arg("chunk") = 1 << 20, py::arg("threads") = 0);
+
+    m.def("correlate_file",
+          [](const std::string& path, std::size_t max_lag, py::object pairs, const std::string& member, int time_axis,
+             std::size_t chunk, unsigned threads) {
+              ChunkSource source = open_record(path, member, time_axis);
+              auto list = pairs.is_none() ? CrossCorrelator::all_pairs(source.channels)
+                                          : pairs.cast<std::vector<std::pair<std::size_t, std::size_t>>>();
+              std::vector<std::vector<double>> full;
+              std::vector<CorrelationPeak> found;
+              {
+                  py::gil_scoped_release release;
+                  found = correlate_out_of_core(source, list, max_lag, full, chunk, threads);
+              }
+              DoubleArray ccf({static_cast<py::ssize_t>(found.size()), static_cast<py::ssize_t>(2 * max_lag + 1)});
+              py::array_t<std::size_t> i(found.size()), j(found.size());
+              DoubleArray lag(found.size()), coefficient(found.size());
+              for (std::size_t p = 0; p < found.size(); ++p) {
+                  std::copy(full[p].begin(), full[p].end(), ccf.mutable_data() + p * (2 * max_lag + 1));
+                  i.mutable_data()[p] = found[p].i;
+                  j.mutable_data()[p] = found[p].j;
+                  lag.mutable_data()[p] = found[p].lag;
+                  coefficient.mutable_data()[p] = found[p].coefficient;
+              }
+              py::dict out;
+              out["i"] = i;
+              out["j"] = j;
+              out["lag"] = lag;
+              out["coefficient"] = coefficient;
+              out["ccf"] = ccf;
+              return out;
+          },
+          "Out-of-core detrended cross-correlation for |lag| <= max_lag (the centre of get_ccf_full) with peak lags",
+          py::arg("path"), py::arg("max_lag"), py::arg("pairs") = py::none(), py::arg("member") = "",
+          py::arg("time_axis") = -1, py::arg("chunk") = 1 << 20, py::arg("threads") = 0);
+
+    py::class_<StoreWriter>(m, "StoreWriter",
+                            "Streaming writer of a columnar experiment store (.ccs); append (channels, n) chunks")
+        .def(py::init<const std::string&, std::size_t, double, std::size_t, const std::vector<std::string>&, int,
+                      unsigned>(),
+             py::arg("path"), py::arg("channels"), py::arg("fs"), py::arg("block") = 4096,
+             py::arg("names") = std::vector<std::string>(), py::arg("level") = 1, py::arg("threads") = 0)
+        .def("append", [](StoreWriter& w, DoubleArray data) {
+            if (data.ndim() != 2 || static_cast<std::size_t>(data.shape(0)) != w.channels())
+                throw std::invalid_argument("data must be (" + std::to_string(w.channels()) + ", samples)");
+            py::gil_scoped_release release;
+            w.append(data.data(), static_cast<std::size_t>(data.shape(1)));
+        }, py::arg("data"))
+        .def_property_readonly("channels", &StoreWriter::channels)
+        .def("close", &StoreWriter::close)
+        .def("__enter__", [](StoreWriter& w) -> StoreWriter& { return w; }, py::return_value_policy::reference)
+        .def("__exit__", [](StoreWriter& w, py::object, py::object, py::object) { w.close(); });
+
+    py::class_<StoreReader>(m, "ExperimentStore",
+                            "Memory-mapped columnar experiment store with per-block min/max/RMS and an event index")
+        .def(py::init<const std::string&>(), py::arg("path"))
+        .def_property_readonly("channels", &StoreReader::n_channels)
+        .def_property_readonly("samples", &StoreReader::n_samples)
+        .def_property_readonly("fs", &StoreReader::sample_rate)
+        .def_property_readonly("block", &StoreReader::block_size)
+        .def_property_readonly("names", &StoreReader::channel_names)
+        .def("read", [](const StoreReader& r, std::size_t begin, std::size_t end, py::object channels,
+                        unsigned threads) {
+            std::vector<std::size_t> which;
+            if (channels.is_none())
+                for (std::size_t c = 0; c < r.n_channels(); ++c)
+                    which.push_back(c);
+            else
+                which = channels.cast<std::vector<std::size_t>>();
+            if (end < begin)
+                throw std::invalid_argument("end must not precede begin");
+            DoubleArray out({static_cast<py::ssize_t>(which.size()), static_cast<py::ssize_t>(end - begin)});
+            double* data = out.mutable_data();
+            py::gil_scoped_release release;
+            r.read(which, begin, end, data, threads);
+            return out;
+        }, "Samples [begin, end) as (channels, n); only the blocks overlapping the window are decompressed",
+        py::arg("begin"), py::arg("end"), py::arg("channels") = py::none(), py::arg("threads") = 0)
+        .def("summary", [](const StoreReader& r) {
+            const auto C = static_cast<py::ssize_t>(r.n_channels()), B = static_cast<py::ssize_t>(r.blocks());
+            DoubleArray lo({C, B}), hi({C, B}), rms({C, B});
+            py::array_t<std::size_t> begin(B);
+            for (py::ssize_t b = 0; b < B; ++b)
+                begin.mutable_data()[b] = static_cast<std::size_t>(b) * r.block_size();
+            for (py::ssize_t c = 0; c < C; ++c)
+                for (py::ssize_t b = 0; b < B; ++b) {
+                    const BlockInfo& info = r.block(static_cast<std::size_t>(c), static_cast<std::size_t>(b));
+                    lo.mutable_data()[c * B + b] = info.min;
+                    hi.mutable_data()[c * B + b] = info.max;
+                    rms.mutable_data()[c * B + b] = info.rms;
+                }
+            py::dict out;
+            out["begin"] = begin;
+            out["min"] = lo;
+            out["max"] = hi;
+            out["rms"] = rms;
+            return out;
+        }, "Per-block min/max/RMS of every channel, (channels, blocks), without decompressing anything");
+
+    m.def("store_file",
+          [](const std::string& input, const std::string& output, double fs, std::size_t block,
+             const std::vector<std::string>& names, py::object factors, const std::string& member, int time_axis,
+             int level, std::size_t chunk, unsigned threads) {
+              ChunkSource source = open_record(input, member, time_axis);
+              if (!factors.is_none())
+                  source = scaled_source(source, per_channel(factors, source.channels, "factors"));
+              py::gil_scoped_release release;
+              write_store(source, output, fs, block, names, level, chunk, threads);
+          },
+          "Convert an .npy file (or .npz member) into an experiment store in one streaming pass",
+          py::arg("input"), py::arg("output"), py::arg("fs"), py::arg("block") = 4096,
+          py::arg("names") = std::vector<std::string>(), py::arg("factors") = py::none(), py::arg("member") = "",
+          py::arg("time_axis") = -1, py::arg("level") = 1, py::arg("chunk") = 1 << 20, py::arg("threads") = 0);
+
+    m.def("add_events",
+          [](const std::string& store, py::array_t<std::uint64_t, py::array::c_style | py::array::forcecast> sample,
+             py::array_t<std::uint32_t, py::array::c_style | py::array::forcecast> channel, DoubleArray amplitude,
+             DoubleArray score, DoubleArray C_f, DoubleArray X_c, DoubleArray Gamma) {
+              const std::size_t n = static_cast<std::size_t>(sample.size());
+              for (const py::array* a : std::initializer_list<const py::array*>{&channel, &amplitude, &score, &C_f,
+                                                                                 &X_c, &Gamma})
+                  if (static_cast<std::size_t>(a->size()) != n)
+                      throw std::invalid_argument("event arrays must have the same length");
+              const std::string path = EventIndex::sidecar(store);
+              EventIndex index = EventIndex::load(path);
+              for (std::size_t e = 0; e < n; ++e)
+                  index.add({sample.data()[e], channel.data()[e], 0, amplitude.data()[e], score.data()[e],
+                             C_f.data()[e], X_c.data()[e], Gamma.data()[e]});
+              index.save(path);
+          },
+          "Merge detected events (onset sample, channel, amplitude, score, fitted C_f, X_c, Gamma) into the "
+          "store's sidecar index",
+          py::arg("store"), py::arg("sample"), py::arg("channel"), py::arg("amplitude"), py::arg("score"),
+          py::arg("C_f"), py::arg("X_c"), py::arg("Gamma"));
+
+    m.def("events",
+          [](const std::string& store, std::uint64_t begin, std::uint64_t end) {
+              EventIndex index = EventIndex::load(EventIndex::sidecar(store));
+              auto range = index.between(begin, end);
+              const std::size_t n = range.second - range.first;
+              py::array_t<std::uint64_t> sample(n);
+              py::array_t<std::uint32_t> channel(n);
+              DoubleArray amplitude(n), score(n), C_f(n), X_c(n), Gamma(n);
+              for (std::size_t e = 0; e < n; ++e) {
+                  const StoredEvent& x = index[range.first + e];
+                  sample.mutable_data()[e] = x.sample;
+                  channel.mutable_data()[e] = x.channel;
+                  amplitude.mutable_data()[e] = x.amplitude;
+                  score.mutable_data()[e] = x.score;
+                  C_f.mutable_data()[e] = x.C_f;
+                  X_c.mutable_data()[e] = x.X_c;
+                  Gamma.mutable_data()[e] = x.Gamma;
+              }
+              py::dict out;
+              out["sample"] = sample;
+              out["channel"] = channel;
+              out["amplitude"] = amplitude;
+              out["score"] = score;
+              out["C_f"] = C_f;
+              out["X_c"] = X_c;
+              out["Gamma"] = Gamma;
+              return out;
+          },
+          "Indexed events with begin <= sample < end, found by binary search in the sidecar index",
+          py::arg("store"), py::arg("begin") = 0, py::arg("end") = std::numeric_limits<std::uint64_t>::max());
+
+    py::class_<PickerSettings>(m, "PickerSettings", "STA/LTA, derivative and AIC picker settings (lengths in samples)")
+        .def(py::init([](std::size_t sta, std::size_t lta, double on, double off, double derivative, std::size_t pre,
+                         std::size_t post, std::size_t dead_time) {
+                 return PickerSettings{sta, lta, on, off, derivative, pre, post, dead_time};
+             }),
+             py::arg("sta") = 20, py::arg("lta") = 1000, py::arg("on") = 4.0, py::arg("off") = 1.5,
+             py::arg("derivative") = 0.0, py::arg("pre") = 200, py::arg("post") = 100, py::arg("dead_time") = 0)
+        .def_readwrite("sta", &PickerSettings::sta)
+        .def_readwrite("lta", &PickerSettings::lta)
+        .def_readwrite("on", &PickerSettings::on)
+        .def_readwrite("off", &PickerSettings::off)
+        .def_readwrite("derivative", &PickerSettings::derivative)
+        .def_readwrite("pre", &PickerSettings::pre)
+        .def_readwrite("post", &PickerSettings::post)
+        .def_readwrite("dead_time", &PickerSettings::dead_time);
+
+    py::class_<EventPicker>(m, "EventPicker", "Streaming multichannel picker; feed (channels, n) chunks in order")
+        .def(py::init<std::size_t, const PickerSettings&>(), py::arg("channels"),
+             py::arg("settings") = PickerSettings())
+        .def("process", [](EventPicker& picker, DoubleArray data, unsigned threads) {
+            if (data.ndim() != 2 || static_cast<std::size_t>(data.shape(0)) != picker.n_channels())
+                throw std::invalid_argument("data must be (channels, samples)");
+            std::vector<Pick> picks;
+            {
+                py::gil_scoped_release release;
+                picks = picker.process(data.data(), static_cast<std::size_t>(data.shape(1)), threads);
+            }
+            return pick_dict(picks);
+        }, "Picks completed within this chunk", py::arg("data"), py::arg("threads") = 0)
+        .def("finish", [](EventPicker& picker) { return pick_dict(picker.finish()); },
+             "Picks still open at the end of the record");
+
+    m.def("pick_events",
+          [](DoubleArray data, const PickerSettings& settings, unsigned threads) {
+              if (data.ndim() != 2)
+                  throw std::invalid_argument("data must be (channels, samples)");
+              std::vector<Pick> picks;
+              {
+                  py::gil_scoped_release release;
+                  EventPicker picker(static_cast<std::size_t>(data.shape(0)), settings);
+                  picks = picker.process(data.data(), static_cast<std::size_t>(data.shape(1)), threads);
+                  auto rest = picker.finish();
+                  picks.insert(picks.end(), rest.begin(), rest.end());
+              }
+              return pick_dict(picks);
+          },
+          "STA/LTA (optionally derivative) triggers with AIC onsets and quality metrics for every channel",
+          py::arg("data"), py::arg("settings") = PickerSettings(), py::arg("threads") = 0);
+
+    m.def("pick_file",
+          [](const std::string& path, const PickerSettings& settings, py::object factors, const std::string& member,
+             int time_axis, std::size_t chunk, unsigned threads) {
+              ChunkSource source = open_record(path, member, time_axis);
+              if (!factors.is_none())
+                  source = scaled_source(source, per_channel(factors, source.channels, "factors"));
+              std::vector<Pick> picks;
+              {
+                  py::gil_scoped_release release;
+                  picks = pick_out_of_core(source, settings, chunk, threads);
+              }
+              return pick_dict(picks);
+          },
+          "Streaming pick of an .npy/.npz record or an experiment store (.ccs) without loading it",
+          py::arg("path"), py::arg("settings") = PickerSettings(), py::arg("factors") = py::none(),
+          py::arg("member") = "", py::arg("time_axis") = -1, py::arg("chunk") = 1 << 20, py::arg("threads") = 0);
+
+    m.def("run_campaign",
+          [](const std::vector<std::string>& paths, const std::string& checkpoint, const std::string& summary,
+             py::object factors, py::object cutoff, double fs, std::size_t order, const std::string& btype,
+             const PickerSettings& picker, py::object index, py::object bank, std::size_t neighbours,
+             std::ptrdiff_t fit_offset, double min_snr, const std::string& member, int time_axis,
+             std::size_t memory_budget, unsigned threads, const std::string& fingerprint) {
+              CampaignSettings settings;
+              if (!factors.is_none())
+                  settings.factors = factors.cast<std::vector<double>>();
+              if (!cutoff.is_none())
+                  settings.filter = parse_butterworth(order, cutoff, fs, btype);
+              settings.picker = picker;
+              if (index.is_none() != bank.is_none())
+                  throw std::invalid_argument("fitting needs both index and bank");
+              if (!index.is_none()) {
+                  settings.index = &index.cast<const TemplateIndex&>();
+                  settings.bank = &bank.cast<const TemplateBank&>();
+              }
+              settings.neighbours = neighbours;
+              settings.fit_offset = fit_offset;
+              settings.min_snr = min_snr;
+              settings.member = member;
+              settings.time_axis = time_axis;
+              settings.memory_budget = memory_budget;
+              settings.threads = threads;
+              settings.checkpoint = checkpoint;
+              settings.fingerprint = fingerprint;
+
+              CampaignResult result;
+              {
+                  py::gil_scoped_release release;
+                  result = run_campaign(paths, settings);
+                  if (!summary.empty())
+                      write_summary(result, summary);
+              }
+
+              py::list files;
+              for (const FileSummary& f : result.files) {
+                  py::dict row;
+                  row["path"] = f.path;
+                  row["status"] = f.status;
+                  row["channels"] = f.channels;
+                  row["samples"] = f.samples;
+                  row["events"] = f.events;
+                  row["seconds"] = f.seconds;
+                  row["resumed"] = f.resumed;
+                  files.append(row);
+              }
+              std::vector<Pick> picks;
+              const std::size_t n = result.events.size();
+              py::array_t<std::size_t> file(n);
+              py::array_t<bool> fitted(n);
+              DoubleArray C_f(n), X_c(n), Gamma(n), y(n), shift(n), chi2(n);
+              for (std::size_t e = 0; e < n; ++e) {
+                  const EventRow& row = result.events[e];
+                  picks.push_back(row.pick);
+                  file.mutable_data()[e] = row.file;
+                  fitted.mutable_data()[e] = row.fitted;
+                  C_f.mutable_data()[e] = row.fit.C_f;
+                  X_c.mutable_data()[e] = row.fit.X_c;
+                  Gamma.mutable_data()[e] = row.fit.Gamma;
+                  y.mutable_data()[e] = row.y;
+                  shift.mutable_data()[e] = row.fit.shift;
+                  chi2.mutable_data()[e] = row.fit.chi2;
+              }
+              py::dict events = pick_dict(picks);
+              events["file"] = file;
+              events["fitted"] = fitted;
+              events["C_f"] = C_f;
+              events["X_c"] = X_c;
+              events["Gamma"] = Gamma;
+              events["y"] = y;
+              events["shift"] = shift;
+              events["chi2"] = chi2;
+              py::dict out;
+              out["files"] = files;
+              out["events"] = events;
+              return out;
+          },
+          "Load -> scale -> filter -> pick -> fit over many .npy/.npz/.ccs files on a work-stealing pool with a "
+          "memory budget. Finished files are logged to `checkpoint` and skipped when the same settings run again; "
+          "`summary` receives a TSV table of every event",
+          py::arg("paths"), py::arg("checkpoint") = "", py::arg("summary") = "", py::arg("factors") = py::none(),
+          py::arg("cutoff") = py::none(), py::arg("fs") = 0.0, py::arg("order") = 4, py::arg("btype") = "high",
+          py::arg("picker") = PickerSettings(), py::arg("index") = py::none(), py::arg("bank") = py::none(),
+          py::arg("neighbours") = 3, py::arg("fit_offset") = 0, py::arg("min_snr") = 0.0, py::arg("member") = "",
+          py::arg("time_axis") = -1, py::arg("memory_budget") = std::size_t(4) << 30, py::arg("threads") = 0,
+          py::arg("fingerprint") = "");
+
+    m.def("resample_poly",
+          [](DoubleArray data, std::size_t up, std::size_t down, unsigned threads) {
+              if (data.ndim() != 1 && data.ndim() != 2)
+                  throw std::invalid_argument("data must be (samples,) or (channels, samples)");
+              const std::size_t channels = data.ndim() == 2 ? static_cast<std::size_t>(data.shape(0)) : 1;
+              const std::size_t n = static_cast<std::size_t>(data.shape(data.ndim() - 1));
+              std::vector<double> y;
+              {
+                  py::gil_scoped_release release;
+                  y = Resampler::resample(data.data(), channels, n, up, down, threads);
+              }
+              const auto m = static_cast<py::ssize_t>(y.size() / channels);
+              DoubleArray out = data.ndim() == 2 ? DoubleArray({static_cast<py::ssize_t>(channels), m})
+                                                 : DoubleArray(m);
+              std::copy(y.begin(), y.end(), out.mutable_data());
+              return out;
+          },
+          "Polyphase rational resampling by up/down along the last axis; same output as "
+          "scipy.signal.resample_poly (Kaiser beta 5 anti-aliasing filter)",
+          py::arg("data"), py::arg("up"), py::arg("down"), py::arg("threads") = 0);
+
+    py::class_<Resampler>(m, "Resampler", "Streaming polyphase resampler; feed (channels, n) blocks in order")
+        .def(py::init([](std::size_t channels, std::size_t up, std::size_t down, py::object filter) {
+                 std::vector<double> taps;
+                 if (!filter.is_none())
+                     taps = filter.cast<std::vector<double>>();
+                 return new Resampler(channels, up, down, std::move(taps));
+             }),
+             py::arg("channels"), py::arg("up"), py::arg("down"), py::arg("filter") = py::none())
+        .def_property_readonly("up", &Resampler::up)
+        .def_property_readonly("down", &Resampler::down)
+        .def_property_readonly("filter", [](const Resampler& r) {
+            DoubleArray h(r.filter().size());
+            std::copy(r.filter().begin(), r.filter().end(), h.mutable_data());
+            return h;
+        })
+        .def("process", [](Resampler& r, DoubleArray data, unsigned threads) {
+            if (data.ndim() != 2 || static_cast<std::size_t>(data.shape(0)) != r.n_channels())
+                throw std::invalid_argument("data must be (channels, samples)");
+            std::vector<double> y;
+            {
+                py::gil_scoped_release release;
+                y = r.process(data.data(), static_cast<std::size_t>(data.shape(1)), threads);
+            }
+            DoubleArray out({static_cast<py::ssize_t>(r.n_channels()),
+                             static_cast<py::ssize_t>(y.size() / r.n_channels())});
+            std::copy(y.begin(), y.end(), out.mutable_data());
+            return out;
+        }, "Outputs completed by this block, (channels, m)", py::arg("data"), py::arg("threads") = 0)
+        .def("finish", [](Resampler& r) {
+            std::vector<double> y = r.finish();
+            DoubleArray out({static_cast<py::ssize_t>(r.n_channels()),
+                             static_cast<py::ssize_t>(y.size() / r.n_channels())});
+            std::copy(y.begin(), y.end(), out.mutable_data());
+            return out;
+        }, "Remaining outputs, zero-extending the record like resample_poly")
+        .def("reset", &Resampler::reset);
+}